@@ -0,0 +1,79 @@
+/* ============================================================================
+** Copyright (c) 2021 Infineon Technologies AG
+**               All rights reserved.
+**               www.infineon.com
+** ============================================================================
+**
+** ============================================================================
+** Redistribution and use of this software only permitted to the extent
+** expressly agreed with Infineon Technologies AG.
+** ============================================================================
+*
+*/
+
+/**
+ * @file     core_cm0.h
+ *
+ * @brief    Host replacement of the CMSIS Cortex-M0 core header.
+ *
+ *           The host build finds this file before the CMSIS header of the ROM library. It provides the part of the
+ *           core API used by the firmware: the intrinsics are mapped to the simulation (host_sim.h), and the NVIC
+ *           functions to the emulated interrupt controller. The peripheral definitions of smack.h are included as on
+ *           the target.
+ *
+ * @version  v1.0
+ * @date     2021-08-01
+ *
+ */
+
+#ifndef __CORE_CM0_H_GENERIC
+#define __CORE_CM0_H_GENERIC
+
+#include <stdint.h>
+#include <stdbool.h>
+
+
+/* IO type qualifiers and compiler abstraction, as in core_cm0.h and cmsis_gcc.h */
+#define __I                 volatile const
+#define __O                 volatile
+#define __IO                volatile
+#define __IM                volatile const
+#define __OM                volatile
+#define __IOM               volatile
+
+#define __ASM               __asm
+#define __INLINE            inline
+#define __STATIC_INLINE     static inline
+#define __STATIC_FORCEINLINE static inline __attribute__((always_inline))
+#define __NO_RETURN         __attribute__((__noreturn__))
+#define __USED              __attribute__((used))
+#define __WEAK              __attribute__((weak))
+#define __PACKED            __attribute__((packed, aligned(1)))
+#define __ALIGNED(x)        __attribute__((aligned(x)))
+
+// interrupt numbers and peripherals of Smack; smack.h includes this file again, which is a no-op then
+#include "smack.h"
+
+#include "host_sim.h"
+
+
+/* Core intrinsics */
+#define __WFI()             host_wfi()
+#define __WFE()             host_wfi()
+#define __NOP()             ((void)0)
+#define __DMB()             __sync_synchronize()
+#define __DSB()             __sync_synchronize()
+#define __ISB()             __sync_synchronize()
+#define __disable_irq()     host_irq_mask(true)
+#define __enable_irq()      host_irq_mask(false)
+
+
+/* NVIC, handled by the emulated interrupt controller */
+#define NVIC_EnableIRQ(irq)         host_nvic_enable((irq), true)
+#define NVIC_DisableIRQ(irq)        host_nvic_enable((irq), false)
+#define NVIC_ClearPendingIRQ(irq)   host_nvic_clear_pending(irq)
+#define NVIC_SetPendingIRQ(irq)     host_irq_raise(irq)
+#define NVIC_SetPriority(irq, prio) ((void)(irq), (void)(prio))
+#define NVIC_SystemReset()          host_exit(1)
+
+#endif /* __CORE_CM0_H_GENERIC */
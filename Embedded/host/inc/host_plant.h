@@ -0,0 +1,154 @@
+/* ============================================================================
+** Copyright (c) 2021 Infineon Technologies AG
+**               All rights reserved.
+**               www.infineon.com
+** ============================================================================
+**
+** ============================================================================
+** Redistribution and use of this software only permitted to the extent
+** expressly agreed with Infineon Technologies AG.
+** ============================================================================
+*
+*/
+
+/**
+ * @file     host_plant.h
+ *
+ * @brief    Model of the electrical system seen by the firmware in the host build.
+ *
+ * @version  v1.0
+ * @date     2021-08-01
+ *
+ */
+
+#ifndef _HOST_PLANT_H_
+#define _HOST_PLANT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Smack NVM lib
+#include "shc_lib.h"
+
+struct host_trace_s;            // see host_trace.h
+
+
+/** @addtogroup Infineon
+ * @{
+ */
+
+/** @addtogroup Smack_stepwise
+ * @{
+ */
+
+/** @addtogroup host_plant
+ * @{
+ */
+
+
+/**
+ * @brief parameters of the model
+ */
+typedef struct host_plant_params_s
+{
+    // harvester
+    double field;               //!< field strength relative to the nominal field (1.0)
+    double harvest_ua;          //!< short circuit current of the harvester at the nominal field, microamperes
+    double harvest_voc;         //!< open circuit voltage of the harvester at the nominal field, volts
+    // HB cap and H bridge
+    double cap_uf;              //!< capacitance of the HB cap, microfarads
+    double esr_ohm;             //!< equivalent series resistance of the HB cap, ohms
+    double switch_ohm;          //!< on resistance of each switch of the H bridge, ohms
+    double diode_v;             //!< forward voltage of the body diodes of the H bridge switches, volts
+    // DC motor, values at 25degC
+    double motor_ohm;           //!< resistance of the motor winding, ohms
+    double motor_uh;            //!< inductance of the motor winding, microhenries
+    double motor_k;             //!< torque constant (= back EMF constant), Nm/A (= Vs/rad)
+    double inertia;             //!< inertia of rotor and load, referred to the motor shaft, kgm^2
+    double friction_unm;        //!< constant load and friction torque, micronewton meters
+    double viscous;             //!< viscous friction, Nm/(rad/s)
+    // mechanism
+    double pulses_per_rev;      //!< pulses of the encoder per revolution of the motor, 0: no encoder
+    double travel_rev;          //!< travel between the end stops in revolutions of the motor, 0: no end stops
+    double start_rev;           //!< position at the reset, revolutions from the backward end stop
+    // device
+    double temperature;         //!< temperature of device and motor, degC
+    double i2v_digits_per_ma;   //!< ADC result of the current sense path (I2V) per milliampere
+    // replay
+    const struct host_trace_s* trace;   //!< recorded VCCHB and motor current replayed instead of the model, NULL: none
+} host_plant_params_t;
+
+/**
+ * @brief state of the model, for reports
+ */
+typedef struct host_plant_state_s
+{
+    double time;                //!< time since the reset, seconds
+    double vcap;                //!< voltage of the HB cap without its ESR, volts
+    double vcchb;               //!< voltage of VCCHB, volts
+    double harvest_current;     //!< current delivered by the harvester, amperes
+    double motor_current;       //!< current through the motor, amperes (positive: forward)
+    double speed;               //!< speed of the motor, rad/s (positive: forward)
+    double position;            //!< position, revolutions from the backward end stop
+    uint32_t pulses;            //!< encoder pulses since the reset
+    bool   endstop_forward;     //!< the forward end stop is reached
+    bool   endstop_backward;    //!< the backward end stop is reached
+    double motor_energy;        //!< energy taken from VCCHB by the motor since the reset, joules
+    double clamp_energy;        //!< harvested energy dumped by the clamp since the reset, joules
+    double loss_energy;         //!< energy lost in ESR, switches and diodes since the reset, joules
+} host_plant_state_t;
+
+
+extern host_plant_params_t host_plant_params;
+extern host_plant_state_t host_plant_state;
+
+
+/**
+ * @brief Set the default parameters (host_plant_params)
+ */
+extern void host_plant_defaults(void);
+
+/**
+ * @brief Reset the model to an empty HB cap and a motor at rest at start_rev, with the parameters in host_plant_params
+ */
+extern void host_plant_reset(void);
+
+/**
+ * @brief Advance the model
+ * @param seconds   time step
+ */
+extern void host_plant_advance(const double seconds);
+
+/**
+ * @brief Voltage of VCCHB
+ * @return          volts
+ */
+extern double host_plant_vcchb(void);
+
+/**
+ * @brief Voltage of an output of the H bridge
+ * @param channel   output MA or MB
+ * @return          volts
+ */
+extern double host_plant_pin(const shc_channel_t channel);
+
+/**
+ * @brief Current through the motor, as seen by the current sense path
+ * @return          amperes, positive: forward
+ */
+extern double host_plant_motor_current(void);
+
+/**
+ * @brief Power available from the field, as seen by the RSSI reading
+ * @return          watts
+ */
+extern double host_plant_field_power(void);
+
+
+/** @} */ /* End of group host_plant */
+
+/** @} */ /* End of group Smack_stepwise */
+
+/** @} */ /* End of group Infineon */
+
+#endif /* _HOST_PLANT_H_ */
@@ -0,0 +1,231 @@
+/* ============================================================================
+** Copyright (c) 2021 Infineon Technologies AG
+**               All rights reserved.
+**               www.infineon.com
+** ============================================================================
+**
+** ============================================================================
+** Redistribution and use of this software only permitted to the extent
+** expressly agreed with Infineon Technologies AG.
+** ============================================================================
+*
+*/
+
+/**
+ * @file     host_sim.h
+ *
+ * @brief    Simulated time, interrupts and peripheral state of the host build.
+ *
+ * @version  v1.0
+ * @date     2021-08-01
+ *
+ */
+
+#ifndef _HOST_SIM_H_
+#define _HOST_SIM_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "smack.h"
+
+
+/** @addtogroup Infineon
+ * @{
+ */
+
+/** @addtogroup Smack_stepwise
+ * @{
+ */
+
+/** @addtogroup host_sim
+ * @{
+ */
+
+
+// simulated time runs in clock cycles of the CPU and the system timer
+#define HOST_TICKS_PER_SECOND   (XTAL)
+
+// clock of the standby timer (slow clock) in Hz (example value, check the slow clock frequency)
+#define HOST_STBTM_HZ           32768
+
+// largest time step of the plant simulation, clock cycles (about 36us)
+#define HOST_STEP_TICKS         1024
+
+// number of channels of the system timer
+#define HOST_SYS_TIM_CHANNELS   8
+
+/* Time taken by the emulated library functions in clock cycles (example values, to be measured). The firmware
+ * itself runs in zero time, so these costs make up the duration of each iteration of the control loop.
+ */
+#define HOST_COST_CALL          28      // any call of the ROM or NVM library, about 1us
+#define HOST_COST_CONVERSION    560     // a conversion of the sense unit ADC, e.g. shc_compare(), about 20us
+#define HOST_COST_NVM_PAGE      112000  // programming of a NVM page, about 4ms
+
+// exit codes of host_run()
+#define HOST_EXIT_IDLE          0       // the firmware waits for a command, and the idle hook had none
+#define HOST_EXIT_RESET         1       // the firmware has requested a reset
+#define HOST_EXIT_TIMEOUT       2       // the simulated time has exceeded the limit
+
+/**
+ * @brief state of the emulated peripherals, as set by the firmware through the libraries
+ */
+typedef struct host_periph_s
+{
+    bool     hs1, ls1, hs2, ls2;    //!< switches of the H bridge
+    bool     hb_eventctrl;          //!< H bridge switches controlled by the event bus
+    bool     nvm_on;                //!< NVM powered
+    bool     sense_on;              //!< sense unit powered
+    bool     ts_on;                 //!< temperature sensor and its sample & hold stage powered (sense_ctrl_config())
+    bool     shc_on;                //!< comparator initialized
+    bool     clock_running;         //!< cascaded timer pair running
+    uint32_t clock_value;           //!< value of the cascaded timer pair when stopped
+    uint64_t clock_start;           //!< simulated time when the cascaded timer pair has been started
+    uint8_t  vclamp;                //!< level of the clamping voltage (0...2)
+    bool     stbtm_on;              //!< standby timer enabled
+    uint32_t stbtm;                 //!< period of the standby timer, slow clock cycles
+    uint8_t  wakeup;                //!< source of the last wake up (wakeup_source_t)
+    uint8_t  gpio_in;               //!< levels of the GPIO inputs, bit n: GPIO n
+    uint32_t conversions;           //!< number of ADC conversions so far
+    uint32_t unpowered;             //!< number of conversions with the sense unit or the sensed part off (result 0)
+    uint32_t hb_changes;            //!< number of calls of set_hb_switch() and direct changes of the switches so far
+    uint32_t motor_starts;          //!< number of times the motor has been switched on so far (steps)
+    uint8_t  tim_running;           //!< system timer channels started by sys_tim_chn_control(), bit n: channel n
+    uint8_t  tim_adc_event[HOST_SYS_TIM_CHANNELS];  //!< ADC event of the channels (sys_tim_chn_evnt_cfg())
+    uint32_t tim_period[HOST_SYS_TIM_CHANNELS];     //!< periods of the channels, clock cycles
+    uint64_t tim_next[HOST_SYS_TIM_CHANNELS];       //!< simulated time of the next wraparound of a running channel
+} host_periph_t;
+
+/**
+ * @brief hook called when the firmware is idle (WFI), e.g. to write the next motion command
+ * @return false to end the simulation
+ */
+typedef bool (*host_idle_t)(void);
+
+/**
+ * @brief decisions of the firmware, as seen at the emulated peripherals
+ */
+typedef enum host_event_e
+{
+    host_event_hb         = 0,      //!< H bridge switches set, value: bit 0 HS1, bit 1 LS1, bit 2 HS2, bit 3 LS2
+    host_event_vclamp     = 1,      //!< clamping voltage set, value: level
+    host_event_sleep      = 2,      //!< power saving mode entered, value: standby time in slow clock cycles
+    host_event_conversion = 3       //!< comparator conversion, value: ADC result
+} host_event_t;
+
+/**
+ * @brief hook called on each decision of the firmware, e.g. to log it
+ */
+typedef void (*host_event_hook_t)(const host_event_t event, const uint32_t value);
+
+struct data_point_entry_e;      // see smack_exchange.h
+
+
+extern uint64_t host_now;               //!< simulated time in clock cycles
+extern host_periph_t host_periph;
+extern host_event_hook_t host_event_hook;  //!< hook for the decisions of the firmware, NULL: none
+
+
+/**
+ * @brief Run the firmware from _nvm_start() until it is idle and the idle hook ends the simulation, or the time limit
+ *        is reached. The plant has to be reset by the caller.
+ * @param idle      idle hook, NULL: end when idle
+ * @param limit     limit of the simulated time in clock cycles, 0: none
+ * @return          HOST_EXIT_IDLE, HOST_EXIT_RESET or HOST_EXIT_TIMEOUT
+ */
+extern int host_run(const host_idle_t idle, const uint64_t limit);
+
+/**
+ * @brief Map plain memory at the addresses of the peripheral registers, or clear it for the next run. Done by
+ *        host_run(); to be called first by tests which call firmware functions directly.
+ */
+extern void host_map_registers(void);
+
+/**
+ * @brief Let simulated time pass. The plant is advanced and pending interrupts are served.
+ * @param ticks     clock cycles
+ */
+extern void host_advance(const uint64_t ticks);
+
+/**
+ * @brief Convert both sample & hold stages of the sense unit as triggered by the event bus (EV_ADC_TRIG_SH0_SH1): the
+ *        results and the done status are written to the sense registers, and the interrupt configured for SH1 is
+ *        raised (see adc_capture.h). Called by host_advance() on each wraparound of a triggering timer channel.
+ */
+extern void host_sense_trigger(void);
+
+/**
+ * @brief Apply a change of the H bridge switch register written directly by the firmware (HB_DIRECT_ENABLE, see
+ *        hb_switch.h). Called by host_advance(): the firmware runs in zero time, so the change takes effect before any
+ *        time passes.
+ */
+extern void host_hb_sync(void);
+
+/**
+ * @brief Wait for an interrupt. In the background loop of the firmware this calls the idle hook.
+ */
+extern void host_wfi(void);
+
+/**
+ * @brief End the simulation, returning from host_run().
+ * @param code      exit code returned by host_run()
+ */
+extern void host_exit(const int code) __attribute__((__noreturn__));
+
+/**
+ * @brief Report a decision of the firmware to the event hook, if any
+ * @param event     decision
+ * @param value     its value
+ */
+extern void host_event(const host_event_t event, const uint32_t value);
+
+/**
+ * @brief Request an interrupt, e.g. from the plant. It is served right away if enabled and not masked.
+ * @param irq       interrupt number
+ */
+extern void host_irq_raise(const IRQn_Type irq);
+
+/**
+ * @brief Mask or unmask all interrupts (__disable_irq(), __enable_irq())
+ * @param masked    true: masked
+ */
+extern void host_irq_mask(const bool masked);
+
+/**
+ * @brief Enable or disable an interrupt in the emulated NVIC
+ * @param irq       interrupt number
+ * @param enable    true: enabled
+ */
+extern void host_nvic_enable(const IRQn_Type irq, const bool enable);
+
+/**
+ * @brief Clear a pending interrupt in the emulated NVIC
+ * @param irq       interrupt number
+ */
+extern void host_nvic_clear_pending(const IRQn_Type irq);
+
+/**
+ * @brief Look up a data point registered by the firmware with smack_exchange_init()
+ * @param id        ID of the data point (see datapoints.h)
+ * @return          entry of the data point table, NULL if not registered
+ */
+extern const struct data_point_entry_e* host_datapoint(const uint16_t id);
+
+/**
+ * @brief Write a data point like the NFC reader does: only if registered with data_point_write, and with the
+ *        length of the entry. The notify function of the entry, if any, is called afterwards.
+ * @param id        ID of the data point (see datapoints.h)
+ * @param value     value to write
+ * @param length    length of the value in bytes
+ * @return          true if written, false if not registered, not writable, or of another length
+ */
+extern bool host_datapoint_write(const uint16_t id, const void* const value, const uint8_t length);
+
+
+/** @} */ /* End of group host_sim */
+
+/** @} */ /* End of group Smack_stepwise */
+
+/** @} */ /* End of group Infineon */
+
+#endif /* _HOST_SIM_H_ */
@@ -0,0 +1,102 @@
+/* ============================================================================
+** Copyright (c) 2021 Infineon Technologies AG
+**               All rights reserved.
+**               www.infineon.com
+** ============================================================================
+**
+** ============================================================================
+** Redistribution and use of this software only permitted to the extent
+** expressly agreed with Infineon Technologies AG.
+** ============================================================================
+*
+*/
+
+/**
+ * @file     host_trace.h
+ *
+ * @brief    Recorded waveforms of VCCHB and the motor current, replayed instead of the plant model in the host build.
+ *
+ * @version  v1.0
+ * @date     2021-08-01
+ *
+ */
+
+#ifndef _HOST_TRACE_H_
+#define _HOST_TRACE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+
+/** @addtogroup Infineon
+ * @{
+ */
+
+/** @addtogroup Smack_stepwise
+ * @{
+ */
+
+/** @addtogroup host_trace
+ * @{
+ */
+
+
+/**
+ * @brief a recorded waveform
+ *
+ * Formats of the files:
+ * - CSV (any other extension than .bin): one sample per line, "time,vcchb[,current]" in seconds, volts and amperes,
+ *   separated by commas, semicolons or blanks. Lines which do not start with a number (headers) are skipped.
+ * - binary (.bin): records of three little endian IEEE 754 floats: time, vcchb, current.
+ * The time is taken relative to the first sample, as scopes often start their captures at a negative time.
+ */
+typedef struct host_trace_s
+{
+    size_t  count;              //!< number of samples
+    double* time;               //!< time of each sample, seconds from the first sample, ascending
+    double* vcchb;              //!< VCCHB, volts
+    double* current;            //!< motor current, amperes; 0 if not recorded
+    bool    has_current;        //!< the motor current has been recorded
+} host_trace_t;
+
+
+/**
+ * @brief Load a waveform from a file
+ * @param trace     returns the waveform
+ * @param path      file, CSV or binary (.bin)
+ * @return          true if at least two samples have been loaded
+ */
+extern bool host_trace_load(host_trace_t* const trace, const char* const path);
+
+/**
+ * @brief Free the samples of a waveform
+ * @param trace     waveform
+ */
+extern void host_trace_free(host_trace_t* const trace);
+
+/**
+ * @brief Duration of a waveform
+ * @param trace     waveform
+ * @return          seconds
+ */
+extern double host_trace_duration(const host_trace_t* const trace);
+
+/**
+ * @brief Interpolate a waveform; before the first and after the last sample, the first and the last sample are held
+ * @param trace     waveform
+ * @param time      seconds from the first sample
+ * @param vcchb     returns VCCHB, volts
+ * @param current   returns the motor current, amperes
+ */
+extern void host_trace_sample(const host_trace_t* const trace, const double time, double* const vcchb,
+                              double* const current);
+
+
+/** @} */ /* End of group host_trace */
+
+/** @} */ /* End of group Smack_stepwise */
+
+/** @} */ /* End of group Infineon */
+
+#endif /* _HOST_TRACE_H_ */
@@ -0,0 +1,240 @@
+/* ============================================================================
+** Copyright (c) 2021 Infineon Technologies AG
+**               All rights reserved.
+**               www.infineon.com
+** ============================================================================
+**
+** ============================================================================
+** Redistribution and use of this software only permitted to the extent
+** expressly agreed with Infineon Technologies AG.
+** ============================================================================
+*
+*/
+
+/** @file     host_lib.c
+ *  @brief    Emulation of the Smack NVM library in the host build
+ *
+ *  The functions of libsmack.a used by the firmware, implemented on the simulated peripherals (host_sim.h) and the
+ *  plant (host_plant.h). The comparator converts the selected H bridge pin and compares the result in software, as
+ *  on the device (see voltage_measure.c), on the voltage of the H bridge output given by the plant. As in the library,
+ *  shc_init() switches the sense unit on and shc_close() switches it off; a conversion with the sense unit off gives
+ *  0 and is counted in host_periph.unpowered.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+// Smack ROM lib
+#include "rom_lib.h"
+
+// Smack NVM lib
+#include "nvm_lib.h"
+#include "sys_tim_lib.h"
+#include "shc_lib.h"
+#include "system_lib.h"
+#include "smack_exchange.h"
+
+// Smack stepwise project
+#include "settings.h"
+
+// host build
+#include "host_sim.h"
+#include "host_plant.h"
+
+
+static const data_point_entry_t* lib_datapoints;
+static uint16_t lib_datapoint_count;
+
+
+// ---- comparator
+
+/** @brief Conversion of an H bridge pin, as used by shc_compare() (see voltage_measure.c)
+ *  @param channel  H bridge pin
+ *  @return         ADC result, 1000mV ~ 1024 digits
+ */
+uint16_t get_nfc_value_ext(const shc_channel_t channel)
+{
+    const double digits = host_plant_pin(channel) * 1024.0;
+    const uint16_t result = (digits <= 0.0) ? 0 : ((digits >= 8191.0) ? 8191 : (uint16_t)digits);
+
+    host_advance(HOST_COST_CONVERSION);
+    host_periph.conversions++;
+    if (!host_periph.sense_on)
+    {
+        host_periph.unpowered++;
+        host_event(host_event_conversion, 0);
+        return 0;
+    }
+    host_event(host_event_conversion, result);
+
+    return result;
+}
+
+
+void shc_init(void)
+{
+    host_advance(HOST_COST_CALL);
+    host_periph.shc_on = true;
+    host_periph.sense_on = true;
+}
+
+
+void shc_close(void)
+{
+    host_advance(HOST_COST_CALL);
+    host_periph.shc_on = false;
+    host_periph.sense_on = false;
+}
+
+
+bool shc_compare(const shc_channel_t channel, const uint16_t threshold)
+{
+    return get_nfc_value_ext(channel) >= threshold;
+}
+
+
+// ---- system timer
+
+void sys_tim_singleshot(const uint8_t channel, const uint16_t period, const uint8_t irq_number)
+{
+    (void)channel;
+    (void)irq_number;
+    host_advance(period);
+}
+
+
+void sys_tim_singleshot_32(const uint8_t channel, const uint32_t period, const uint8_t irq_number)
+{
+    (void)channel;
+    (void)irq_number;
+    host_advance(period);
+}
+
+
+void sys_tim_cyclic_cascaded(uint8_t channel, uint16_t period_prescaler, uint16_t period_counter)
+{
+    (void)channel;
+    (void)period_prescaler;
+    (void)period_counter;
+    host_advance(HOST_COST_CALL);
+    host_periph.clock_running = true;
+    host_periph.clock_start = host_now;
+}
+
+
+void sys_tim_cyclic_cascaded_stop(uint8_t channel)
+{
+    host_periph.clock_value = sys_tim_cyclic_cascaded_get_combined(channel);
+    host_periph.clock_running = false;
+}
+
+
+uint16_t sys_tim_cyclic_cascaded_get_upper(uint8_t channel)
+{
+    return (uint16_t)(sys_tim_cyclic_cascaded_get_combined(channel) >> 16);
+}
+
+
+uint32_t sys_tim_cyclic_cascaded_get_combined(uint8_t channel)
+{
+    (void)channel;
+    host_advance(HOST_COST_CALL);
+    return host_periph.clock_running ? (uint32_t)(host_now - host_periph.clock_start) : host_periph.clock_value;
+}
+
+
+void sys_tim_close(void)
+{
+    host_advance(HOST_COST_CALL);
+    host_periph.clock_running = false;
+}
+
+
+// ---- system
+
+bool check_rf_field(void)
+{
+    return true;
+}
+
+
+uint8_t vclamp_get(void)
+{
+    host_advance(HOST_COST_CALL);
+    return host_periph.vclamp;
+}
+
+
+void vclamp_set(uint8_t value)
+{
+    host_advance(HOST_COST_CALL);
+    host_periph.vclamp = value;
+    host_event(host_event_vclamp, value);
+}
+
+
+wakeup_source_t get_wakeup_source_lib(void)
+{
+    return (wakeup_source_t)host_periph.wakeup;
+}
+
+
+// ---- NVM
+
+void switch_on_nvm_lib(void)
+{
+    host_advance(HOST_COST_CALL);
+    host_periph.nvm_on = true;
+}
+
+
+void switch_off_nvm_lib(void)
+{
+    host_advance(HOST_COST_CALL);
+    host_periph.nvm_on = false;
+}
+
+
+// ---- data exchange
+
+void smack_exchange_init(const data_point_entry_t* const data_point_table, const uint16_t count)
+{
+    lib_datapoints = data_point_table;
+    lib_datapoint_count = count;
+}
+
+
+const struct data_point_entry_e* host_datapoint(const uint16_t id)
+{
+    uint16_t i;
+
+    for (i = 0; i < lib_datapoint_count; i++)
+    {
+        if (lib_datapoints[i].data_point_id == id)
+        {
+            return &lib_datapoints[i];
+        }
+    }
+
+    return NULL;
+}
+
+
+bool host_datapoint_write(const uint16_t id, const void* const value, const uint8_t length)
+{
+    const data_point_entry_t* const entry = host_datapoint(id);
+
+    if ((entry == NULL) || ((entry->data_type & data_point_write) == 0) || (entry->length != length))
+    {
+        return false;
+    }
+    memcpy(entry->value, value, length);
+    if (entry->notify_rx != NULL)
+    {
+        entry->notify_rx(id);
+    }
+
+    return true;
+}
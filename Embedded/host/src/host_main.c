@@ -0,0 +1,142 @@
+/* ============================================================================
+** Copyright (c) 2021 Infineon Technologies AG
+**               All rights reserved.
+**               www.infineon.com
+** ============================================================================
+**
+** ============================================================================
+** Redistribution and use of this software only permitted to the extent
+** expressly agreed with Infineon Technologies AG.
+** ============================================================================
+*
+*/
+
+/** @file     host_main.c
+ *  @brief    Command line front end of the host build
+ *
+ *  Runs the firmware from _nvm_start() against the plant: the movement configured for power up
+ *  (MOTION_STARTUP_COMMAND), followed by further movements written to DP_MOTION_COMMAND whenever the firmware is idle.
+ *  One line is printed per movement.
+ *
+ *  usage: smack_host [-n movements] [-b] [-f field] [-a harvest_ua] [-c cap_uf] [-e esr_ohm] [-r motor_ohm]
+ *                    [-j inertia] [-L friction_unm] [-s travel_rev] [-t temperature] [-l limit_s]
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+// Smack stepwise project
+#include "settings.h"
+#include "smack_stepwise.h"
+#include "datapoints.h"
+
+// host build
+#include "host_sim.h"
+#include "host_plant.h"
+
+
+static const char* const main_end_names[] = { "none", "time", "stall", "endstop", "pulses", "profile" };
+
+static unsigned main_movements = 1;     // movements to perform
+static unsigned main_done;              // movements done
+static uint8_t main_command = motion_cmd_forward;     // motion_cmd_t, as written by the NFC reader
+static uint64_t main_start;             // simulated time at the start of the movement
+static host_periph_t main_periph;       // peripheral counters at the start of the movement
+static host_plant_state_t main_plant;   // energies at the start of the movement
+
+
+/** @brief Print the result of the movement just ended
+ */
+static void main_report(void)
+{
+    const uint8_t end = stepwise_status.end;
+
+    printf("%u,%s,%s,%lu,%.1f,%u,%u,%u,%.3f,%.6f,%.6f\n", main_done,
+           (stepwise_status.direction == motion_forward) ? "forward" : "backward",
+           (end < sizeof(main_end_names) / sizeof(main_end_names[0])) ? main_end_names[end] : "?",
+           (unsigned long)stepwise_status.runtime,
+           (double)(host_now - main_start) * 1000.0 / (HOST_TICKS_PER_SECOND),
+           host_periph.hb_changes - main_periph.hb_changes, host_periph.conversions - main_periph.conversions,
+           host_plant_state.pulses - main_plant.pulses, host_plant_state.position - main_plant.position,
+           host_plant_state.motor_energy - main_plant.motor_energy,
+           host_plant_state.clamp_energy - main_plant.clamp_energy);
+}
+
+
+/** @brief Idle hook: report the movement just ended, and start the next one
+ */
+static bool main_idle(void)
+{
+    main_done++;
+    main_report();
+    if (main_done >= main_movements)
+    {
+        return false;
+    }
+
+    main_start = host_now;
+    main_periph = host_periph;
+    main_plant = host_plant_state;
+    if (!host_datapoint_write(DP_MOTION_COMMAND, &main_command, sizeof(main_command)))
+    {
+        fprintf(stderr, "data point DP_MOTION_COMMAND is not writable\n");
+        exit(EXIT_FAILURE);
+    }
+    return true;
+}
+
+
+int main(int argc, char* argv[])
+{
+    double limit = 600.0;
+    int opt;
+    int code;
+
+    host_plant_defaults();
+    while ((opt = getopt(argc, argv, "n:bf:a:c:e:r:j:L:s:t:l:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n': main_movements = (unsigned)strtoul(optarg, NULL, 0); break;
+            case 'b': main_command = motion_cmd_backward; break;
+            case 'f': host_plant_params.field = strtod(optarg, NULL); break;
+            case 'a': host_plant_params.harvest_ua = strtod(optarg, NULL); break;
+            case 'c': host_plant_params.cap_uf = strtod(optarg, NULL); break;
+            case 'e': host_plant_params.esr_ohm = strtod(optarg, NULL); break;
+            case 'r': host_plant_params.motor_ohm = strtod(optarg, NULL); break;
+            case 'j': host_plant_params.inertia = strtod(optarg, NULL); break;
+            case 'L': host_plant_params.friction_unm = strtod(optarg, NULL); break;
+            case 's':
+                host_plant_params.travel_rev = strtod(optarg, NULL);
+                host_plant_params.start_rev = host_plant_params.travel_rev / 2.0;
+                break;
+            case 't': host_plant_params.temperature = strtod(optarg, NULL); break;
+            case 'l': limit = strtod(optarg, NULL); break;
+            default:
+                fprintf(stderr, "usage: %s [-n movements] [-b] [-f field] [-a harvest_ua] [-c cap_uf] [-e esr_ohm] "
+                                "[-r motor_ohm] [-j inertia] [-L friction_unm] [-s travel_rev] [-t temperature] "
+                                "[-l limit_s]\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    printf("movement,direction,end,runtime_ms,duration_ms,hb_changes,conversions,pulses,revolutions,motor_j,clamp_j\n");
+    host_plant_reset();
+    main_plant = host_plant_state;
+    code = host_run(main_idle, (uint64_t)(limit * (HOST_TICKS_PER_SECOND)));
+    if (code == HOST_EXIT_TIMEOUT)
+    {
+        fprintf(stderr, "time limit of %.1fs reached in movement %u\n", limit, main_done + 1);
+    }
+    if (host_periph.unpowered != 0)
+    {
+        fprintf(stderr, "%lu conversions with the sense unit or the sensed part switched off\n",
+                (unsigned long)host_periph.unpowered);
+        code = HOST_EXIT_TIMEOUT;
+    }
+
+    return (code == HOST_EXIT_IDLE) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,315 @@
+/* ============================================================================
+** Copyright (c) 2021 Infineon Technologies AG
+**               All rights reserved.
+**               www.infineon.com
+** ============================================================================
+**
+** ============================================================================
+** Redistribution and use of this software only permitted to the extent
+** expressly agreed with Infineon Technologies AG.
+** ============================================================================
+*
+*/
+
+/** @file     host_plant.c
+ *  @brief    Model of the electrical system seen by the firmware in the host build
+ *
+ *  Harvester: the rectified output of the antenna is a source with a short circuit current and an open circuit
+ *  voltage, both proportional to the field strength, and a linear characteristic in between. The clamp limits
+ *  VCCHB to the level set by vclamp_set() and dumps the surplus.
+ *  HB cap: a capacitor with ESR at VCCHB.
+ *  H bridge: four switches with on resistance, and their body diodes, which take over the motor current when the
+ *  switches in its path are opened.
+ *  Motor: a DC motor with winding resistance (copper, follows the temperature) and inductance, back EMF, the
+ *  inertia of rotor and load, constant friction and viscous friction. The mechanism may have end stops, which block
+ *  the motor, and the motor may have an encoder.
+ *
+ *  With a recorded waveform (host_plant_params.trace), VCCHB and the motor current follow the recording instead, and
+ *  the motor stands still: the firmware runs open loop on the recorded comparator input.
+ *
+ *  host_plant_advance() integrates in sub steps of at most PLANT_SUBSTEP; the motor current and the speed are
+ *  integrated semi implicitly, so the sub step may be longer than the electrical time constant of the motor. While
+ *  the motor is at rest and not driven, only the HB cap charges, and the step is taken at once.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+
+// Smack stepwise project
+#include "settings.h"
+
+// host build
+#include "host_sim.h"
+#include "host_plant.h"
+#include "host_trace.h"
+
+
+#define PLANT_SUBSTEP           4e-6        // longest sub step of the integration, seconds
+#define PLANT_COPPER_TC         0.00393     // temperature coefficient of copper, 1/K
+
+// clamping voltage of each level of vclamp_set() in millivolts
+static const double plant_clamp_mv[] = { VCLAMP_LEVELS };
+
+host_plant_params_t host_plant_params;
+host_plant_state_t host_plant_state;
+
+static int32_t plant_pulse_index;   // encoder pulse at the current position
+
+
+void host_plant_defaults(void)
+{
+    host_plant_params.field = 1.0;
+    host_plant_params.harvest_ua = 3000.0;
+    host_plant_params.harvest_voc = 6.0;
+    host_plant_params.cap_uf = VCCHB_CAPACITANCE_UF;
+    host_plant_params.esr_ohm = 0.5;
+    host_plant_params.switch_ohm = 2.0;
+    host_plant_params.diode_v = 0.7;
+    host_plant_params.motor_ohm = 40.0;
+    host_plant_params.motor_uh = 500.0;
+    host_plant_params.motor_k = 2.8e-3;
+    host_plant_params.inertia = 5e-9;
+    host_plant_params.friction_unm = 50.0;
+    host_plant_params.viscous = 1e-8;
+    host_plant_params.pulses_per_rev = 12.0;
+    host_plant_params.travel_rev = 0.0;
+    host_plant_params.start_rev = 0.0;
+    host_plant_params.temperature = 25.0;
+    host_plant_params.i2v_digits_per_ma = 10.0;
+}
+
+
+void host_plant_reset(void)
+{
+    host_plant_state = (host_plant_state_t){ .position = host_plant_params.start_rev };
+    if (host_plant_params.trace != NULL)
+    {
+        host_trace_sample(host_plant_params.trace, 0.0, &host_plant_state.vcchb, &host_plant_state.motor_current);
+        host_plant_state.vcap = host_plant_state.vcchb;
+    }
+    plant_pulse_index = (int32_t)floor(host_plant_state.position * host_plant_params.pulses_per_rev);
+}
+
+
+/** @brief Voltages of the H bridge outputs for the direction of the motor current
+ *  @param vcchb    voltage of VCCHB
+ *  @param positive direction of the current: from MA through the motor to MB
+ *  @param ma       returns the voltage of MA
+ *  @param mb       returns the voltage of MB
+ *  @param drawn    returns the factor of the motor current drawn from VCCHB (-1, 0, 1)
+ *
+ *  The current enters the motor at one output and leaves it at the other. Where the switches of an output are open,
+ *  the body diodes conduct: the diode to ground at the entering output, the diode to VCCHB at the leaving one.
+ */
+static void plant_outputs(const double vcchb, const bool positive, double* const ma, double* const mb, int* const drawn)
+{
+    const double vd = host_plant_params.diode_v;
+    const bool in_high = positive ? host_periph.hs1 : host_periph.hs2;
+    const bool in_low = positive ? host_periph.ls1 : host_periph.ls2;
+    const bool out_high = positive ? host_periph.hs2 : host_periph.hs1;
+    const bool out_low = positive ? host_periph.ls2 : host_periph.ls1;
+    const double vin = in_low ? 0.0 : (in_high ? vcchb : -vd);
+    const double vout = out_low ? 0.0 : (out_high ? vcchb : vcchb + vd);
+
+    *drawn = ((!in_low && in_high) ? 1 : 0) - (!out_low ? 1 : 0);
+    *ma = positive ? vin : vout;
+    *mb = positive ? vout : vin;
+}
+
+
+/** @brief Advance the motor current by one sub step
+ *  @param dt       sub step, seconds
+ *  @param vcchb    voltage of VCCHB
+ *  @param emf      back EMF, volts
+ *  @return         current drawn from VCCHB by the H bridge, amperes
+ */
+static double plant_motor_current(const double dt, const double vcchb, const double emf)
+{
+    const double l = host_plant_params.motor_uh * 1e-6;
+    const double r = host_plant_params.motor_ohm * (1.0 + PLANT_COPPER_TC * (host_plant_params.temperature - 25.0)) +
+                     2.0 * host_plant_params.switch_ohm;
+    double i = host_plant_state.motor_current;
+    double ma, mb;
+    int drawn;
+    bool positive = (i >= 0.0);
+
+    plant_outputs(vcchb, positive, &ma, &mb, &drawn);
+    if ((i == 0.0) && ((ma - mb - emf) <= 0.0))
+    {
+        // no current yet: it starts in the direction in which the voltage across the motor exceeds the back EMF
+        positive = false;
+        plant_outputs(vcchb, positive, &ma, &mb, &drawn);
+        if ((ma - mb - emf) >= 0.0)
+        {
+            return 0.0;
+        }
+    }
+
+    i = (i + dt / l * (ma - mb - emf)) / (1.0 + dt * r / l);
+    if ((i >= 0.0) != positive)
+    {
+        // the diodes block the reversal of the current
+        i = 0.0;
+    }
+    host_plant_state.motor_current = i;
+    host_plant_state.loss_energy += i * i * 2.0 * host_plant_params.switch_ohm * dt;
+
+    return (positive ? i : -i) * drawn;
+}
+
+
+/** @brief Advance the mechanics by one sub step
+ *  @param dt       sub step, seconds
+ */
+static void plant_mechanics(const double dt)
+{
+    const double travel = host_plant_params.travel_rev;
+    const double torque = host_plant_params.motor_k * host_plant_state.motor_current;
+    const double friction = host_plant_params.friction_unm * 1e-6;
+    double w = host_plant_state.speed;
+    double index;
+
+    if (w == 0.0)
+    {
+        // static friction holds the motor until the torque exceeds it
+        if (fabs(torque) > friction)
+        {
+            w = dt / host_plant_params.inertia * (torque - copysign(friction, torque));
+        }
+    }
+    else
+    {
+        w = (w + dt / host_plant_params.inertia * (torque - copysign(friction, w))) /
+            (1.0 + dt * host_plant_params.viscous / host_plant_params.inertia);
+        if ((w > 0.0) != (host_plant_state.speed > 0.0))
+        {
+            w = 0.0;
+        }
+    }
+
+    host_plant_state.position += w * dt / (2.0 * M_PI);
+    if (travel > 0.0)
+    {
+        if ((host_plant_state.position >= travel) && (w >= 0.0))
+        {
+            host_plant_state.position = travel;
+            w = 0.0;
+        }
+        else if ((host_plant_state.position <= 0.0) && (w <= 0.0))
+        {
+            host_plant_state.position = 0.0;
+            w = 0.0;
+        }
+        host_plant_state.endstop_forward = (host_plant_state.position >= travel);
+        host_plant_state.endstop_backward = (host_plant_state.position <= 0.0);
+    }
+    host_plant_state.speed = w;
+
+    index = floor(host_plant_state.position * host_plant_params.pulses_per_rev);
+    host_plant_state.pulses += (uint32_t)fabs(index - plant_pulse_index);
+    plant_pulse_index = (int32_t)index;
+}
+
+
+void host_plant_advance(const double seconds)
+{
+    const double cap = host_plant_params.cap_uf * 1e-6;
+    const double esr = (host_plant_params.esr_ohm > 1e-3) ? host_plant_params.esr_ohm : 1e-3;
+    const double isc = host_plant_params.harvest_ua * 1e-6 * host_plant_params.field;
+    const double voc = host_plant_params.harvest_voc * host_plant_params.field;
+    const double g = (voc > 0.0) ? (isc / voc) : 0.0;
+    const uint8_t level = host_periph.vclamp;
+    const double clamp = plant_clamp_mv[(level < sizeof(plant_clamp_mv) / sizeof(plant_clamp_mv[0])) ? level : 0] * 1e-3;
+    const bool rest = (host_plant_state.motor_current == 0.0) && (host_plant_state.speed == 0.0) &&
+                      !(host_periph.hs1 && host_periph.ls2) && !(host_periph.hs2 && host_periph.ls1);
+    const unsigned steps = rest ? 1 : (unsigned)ceil(seconds / PLANT_SUBSTEP);
+    const double dt = seconds / (double)((steps != 0) ? steps : 1);
+    double drawn;
+    double v;
+    double ic;
+    unsigned n;
+
+    host_plant_state.time += seconds;
+    if (host_plant_params.trace != NULL)
+    {
+        host_trace_sample(host_plant_params.trace, host_plant_state.time, &v, &ic);
+        host_plant_state.vcap = v;
+        host_plant_state.vcchb = v;
+        host_plant_state.motor_current = ic;
+        host_plant_state.motor_energy += fabs(ic) * v * seconds;
+        return;
+    }
+
+    for (n = 0; n < steps; n++)
+    {
+        drawn = plant_motor_current(dt, host_plant_state.vcchb,
+                                    host_plant_params.motor_k * host_plant_state.speed);
+        plant_mechanics(dt);
+
+        // VCCHB node: harvester, HB cap through its ESR, H bridge; the clamp takes what exceeds its voltage
+        v = (host_plant_state.vcap / esr + isc - drawn) / (1.0 / esr + g);
+        if (v > clamp)
+        {
+            v = clamp;
+            host_plant_state.clamp_energy += (isc - g * v - drawn - (v - host_plant_state.vcap) / esr) * v * dt;
+        }
+        v = (v > 0.0) ? v : 0.0;
+        ic = (v - host_plant_state.vcap) / esr;
+
+        host_plant_state.vcap += ic * dt / cap;
+        host_plant_state.vcchb = v;
+        host_plant_state.harvest_current = (isc > g * v) ? (isc - g * v) : 0.0;
+        host_plant_state.motor_energy += drawn * v * dt;
+        host_plant_state.loss_energy += ic * ic * esr * dt;
+    }
+}
+
+
+double host_plant_vcchb(void)
+{
+    return host_plant_state.vcchb;
+}
+
+
+double host_plant_pin(const shc_channel_t channel)
+{
+    const bool ma = (channel == shc_channel_ma);
+    const bool high = ma ? host_periph.hs1 : host_periph.hs2;
+    const bool low = ma ? host_periph.ls1 : host_periph.ls2;
+    const bool other_high = ma ? host_periph.hs2 : host_periph.hs1;
+    const bool other_low = ma ? host_periph.ls2 : host_periph.ls1;
+    const double current = ma ? host_plant_state.motor_current : -host_plant_state.motor_current;
+    const double emf = host_plant_params.motor_k * (ma ? host_plant_state.speed : -host_plant_state.speed);
+    const double vd = host_plant_params.diode_v;
+    const double vcchb = host_plant_state.vcchb;
+    double v;
+
+    if (low || high)
+    {
+        return low ? 0.0 : vcchb;
+    }
+    if (current != 0.0)
+    {
+        // the motor current flows through a body diode of this output
+        return (current > 0.0) ? -vd : (vcchb + vd);
+    }
+
+    // no current: the output follows the other one by the back EMF, within the diodes
+    v = (other_low ? 0.0 : (other_high ? vcchb : 0.0)) + emf;
+    return (v < -vd) ? -vd : ((v > vcchb + vd) ? (vcchb + vd) : v);
+}
+
+
+double host_plant_motor_current(void)
+{
+    return host_plant_state.motor_current;
+}
+
+
+// the maximum power the harvester can deliver, at half its open circuit voltage
+double host_plant_field_power(void)
+{
+    return host_plant_params.harvest_ua * 1e-6 * host_plant_params.harvest_voc *
+           host_plant_params.field * host_plant_params.field / 4.0;
+}
@@ -0,0 +1,180 @@
+/* ============================================================================
+** Copyright (c) 2021 Infineon Technologies AG
+**               All rights reserved.
+**               www.infineon.com
+** ============================================================================
+**
+** ============================================================================
+** Redistribution and use of this software only permitted to the extent
+** expressly agreed with Infineon Technologies AG.
+** ============================================================================
+*
+*/
+
+/** @file     host_replay.c
+ *  @brief    Replay of a recorded VCCHB waveform through the control loop in the host build
+ *
+ *  The firmware runs from power up at the start of the recording (see host_trace.h for the formats), with VCCHB and
+ *  the motor current taken from the recording instead of the plant model. Every decision of the firmware is printed
+ *  with its time: the switching of the H bridge, changes of the clamping voltage, the power saving mode, and with -v
+ *  every comparator conversion; the end of the movement closes the list. The replay is deterministic, so the output
+ *  for a corpus of recordings can be kept and compared after each change of the control loop.
+ *
+ *  If no movement is configured for power up (MOTION_STARTUP_COMMAND), a movement is started when the firmware is
+ *  idle the first time. The replay ends with the movement, or extra_s after the end of the recording.
+ *
+ *  usage: smack_replay [-b] [-v] [-x extra_s] trace.csv|trace.bin
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+// Smack stepwise project
+#include "settings.h"
+#include "smack_stepwise.h"
+#include "datapoints.h"
+
+// host build
+#include "host_sim.h"
+#include "host_plant.h"
+#include "host_trace.h"
+
+
+static const char* const replay_end_names[] = { "none", "time", "stall", "endstop", "pulses", "profile" };
+
+static uint8_t replay_command = motion_cmd_forward;     // motion_cmd_t, as written by the NFC reader
+static bool replay_conversions;     // print every comparator conversion
+static bool replay_started;         // a movement has been started
+
+
+/** @brief Print a decision of the firmware
+ */
+static void replay_print(const char* const event, const char* const value)
+{
+    printf("%.3f,%s,%s,%.3f\n", (double)host_now * 1000.0 / (HOST_TICKS_PER_SECOND), event, value,
+           host_plant_vcchb());
+}
+
+
+/** @brief Event hook: print the decisions of the firmware
+ */
+static void replay_event(const host_event_t event, const uint32_t value)
+{
+    static const char* const switch_names[] = { "HS1", "LS1", "HS2", "LS2" };
+    char text[32];
+    int length = 0;
+    unsigned i;
+
+    switch (event)
+    {
+        case host_event_hb:
+            for (i = 0; i < 4; i++)
+            {
+                if ((value & (1UL << i)) != 0)
+                {
+                    length += snprintf(text + length, sizeof(text) - (size_t)length, "%s%s",
+                                       (length != 0) ? "+" : "", switch_names[i]);
+                }
+            }
+            replay_print("hb", (length != 0) ? text : "open");
+            break;
+        case host_event_vclamp:
+            snprintf(text, sizeof(text), "%lu", (unsigned long)value);
+            replay_print("vclamp", text);
+            break;
+        case host_event_sleep:
+            snprintf(text, sizeof(text), "%.1fms", (double)value * 1000.0 / (HOST_STBTM_HZ));
+            replay_print("sleep", text);
+            break;
+        case host_event_conversion:
+            if (replay_conversions)
+            {
+                snprintf(text, sizeof(text), "%lu", (unsigned long)value);
+                replay_print("adc", text);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+
+/** @brief Idle hook: report the end of the movement, or start one if none has been done at power up
+ */
+static bool replay_idle(void)
+{
+    char text[48];
+    const uint8_t end = stepwise_status.end;
+
+    if (!replay_started && (end == stepwise_end_none))
+    {
+        replay_started = true;
+        if (!host_datapoint_write(DP_MOTION_COMMAND, &replay_command, sizeof(replay_command)))
+        {
+            fprintf(stderr, "data point DP_MOTION_COMMAND is not writable\n");
+            exit(EXIT_FAILURE);
+        }
+        return true;
+    }
+
+    snprintf(text, sizeof(text), "%s %lums", (end < sizeof(replay_end_names) / sizeof(replay_end_names[0])) ?
+             replay_end_names[end] : "?", (unsigned long)stepwise_status.runtime);
+    replay_print("end", text);
+    return false;
+}
+
+
+int main(int argc, char* argv[])
+{
+    host_trace_t trace;
+    double extra = 1.0;
+    int opt;
+    int code;
+
+    while ((opt = getopt(argc, argv, "bvx:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'b': replay_command = motion_cmd_backward; break;
+            case 'v': replay_conversions = true; break;
+            case 'x': extra = strtod(optarg, NULL); break;
+            default:
+                optind = argc + 1;
+                break;
+        }
+    }
+    if (optind != argc - 1)
+    {
+        fprintf(stderr, "usage: %s [-b] [-v] [-x extra_s] trace.csv|trace.bin\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (!host_trace_load(&trace, argv[optind]))
+    {
+        fprintf(stderr, "%s: cannot load the recording, or less than two samples\n", argv[optind]);
+        return EXIT_FAILURE;
+    }
+
+    host_plant_defaults();
+    host_plant_params.trace = &trace;
+    host_plant_reset();
+    host_event_hook = replay_event;
+
+    printf("time_ms,event,value,vcchb_v\n");
+    code = host_run(replay_idle, (uint64_t)((host_trace_duration(&trace) + extra) * (HOST_TICKS_PER_SECOND)));
+    if (code == HOST_EXIT_TIMEOUT)
+    {
+        replay_print("timeout", "recording ended");
+    }
+    if (host_periph.unpowered != 0)
+    {
+        fprintf(stderr, "%lu conversions with the sense unit or the sensed part switched off\n",
+                (unsigned long)host_periph.unpowered);
+        code = HOST_EXIT_TIMEOUT;
+    }
+
+    host_trace_free(&trace);
+    return (code == HOST_EXIT_IDLE) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
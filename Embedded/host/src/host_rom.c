@@ -0,0 +1,477 @@
+/* ============================================================================
+** Copyright (c) 2021 Infineon Technologies AG
+**               All rights reserved.
+**               www.infineon.com
+** ============================================================================
+**
+** ============================================================================
+** Redistribution and use of this software only permitted to the extent
+** expressly agreed with Infineon Technologies AG.
+** ============================================================================
+*
+*/
+
+/** @file     host_rom.c
+ *  @brief    Emulation of the ROM library in the host build
+ *
+ *  On the device, the firmware calls the ROM library through the jump table rom_func_table (see rom_lib.h), whose
+ *  address is taken from image_rom.elf. Here the table is defined with the emulated functions. Only the functions
+ *  used by the firmware are emulated; the other entries are NULL, so a call of a function not emulated yet ends
+ *  with a segmentation fault at a NULL function pointer.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// Smack ROM lib
+#include "rom_lib.h"
+#include "hal_api.h"
+
+// Smack stepwise project
+#include "settings.h"
+#include "hb_switch.h"
+#include "adc_capture.h"
+
+// host build
+#include "host_sim.h"
+#include "host_plant.h"
+
+
+/** @brief Conversion result of the sense unit for a voltage
+ *  @param volts    voltage
+ *  @return         ADC result, 1000mV ~ 1024 digits (see shc_compare())
+ */
+static uint16_t rom_adc_digits(const double volts)
+{
+    const double digits = volts * 1024.0;
+
+    return (digits <= 0.0) ? 0 : ((digits >= 8191.0) ? 8191 : (uint16_t)digits);
+}
+
+
+// ---- H bridge
+
+/** @brief Apply a setting of the H bridge switches to the emulated peripherals
+ */
+static void rom_hb_apply(const bool hs1, const bool ls1, const bool hs2, const bool ls2)
+{
+    const bool driving = (host_periph.hs1 && host_periph.ls2) || (host_periph.hs2 && host_periph.ls1);
+
+    if (!driving && ((hs1 && ls2) || (hs2 && ls1)))
+    {
+        host_periph.motor_starts++;
+    }
+    host_periph.hs1 = hs1;
+    host_periph.ls1 = ls1;
+    host_periph.hs2 = hs2;
+    host_periph.ls2 = ls2;
+    host_periph.hb_changes++;
+    host_event(host_event_hb, (hs1 ? 1U : 0U) | (ls1 ? 2U : 0U) | (hs2 ? 4U : 0U) | (ls2 ? 8U : 0U));
+}
+
+
+/* Like the ROM function, the switch register is written, with a high side switch taking precedence over the low side
+ * switch of its half bridge. So host_hb_sync() sees no change.
+ */
+static void rom_set_hb_switch(bool hs1_set, bool ls1_set, bool hs2_set, bool ls2_set)
+{
+    host_advance(HOST_COST_CALL);
+    ls1_set = ls1_set && !hs1_set;
+    ls2_set = ls2_set && !hs2_set;
+    HAL_SET32(HB_SWITCH_REG, (hs1_set ? HB_SWITCH_HS1 : 0UL) | (ls1_set ? HB_SWITCH_LS1 : 0UL) |
+                             (hs2_set ? HB_SWITCH_HS2 : 0UL) | (ls2_set ? HB_SWITCH_LS2 : 0UL));
+    rom_hb_apply(hs1_set, ls1_set, hs2_set, ls2_set);
+}
+
+
+void host_hb_sync(void)
+{
+    const uint32_t reg = HAL_GET32(HB_SWITCH_REG);
+    const bool hs1 = (reg & HB_SWITCH_HS1) != 0;
+    const bool ls1 = (reg & HB_SWITCH_LS1) != 0;
+    const bool hs2 = (reg & HB_SWITCH_HS2) != 0;
+    const bool ls2 = (reg & HB_SWITCH_LS2) != 0;
+
+    if ((hs1 != host_periph.hs1) || (ls1 != host_periph.ls1) || (hs2 != host_periph.hs2) || (ls2 != host_periph.ls2))
+    {
+        rom_hb_apply(hs1, ls1, hs2, ls2);
+    }
+}
+
+
+static void rom_set_hb_eventctrl(bool control_switches_by_eventbus)
+{
+    host_advance(HOST_COST_CALL);
+    host_periph.hb_eventctrl = control_switches_by_eventbus;
+}
+
+
+static void rom_set_hb_config(const hb_config_struct_t* hb_config)
+{
+    (void)hb_config;
+    host_advance(HOST_COST_CALL);
+}
+
+
+// ---- divider
+
+static uint32_t rom_calc_div(uint32_t op1, uint32_t op2, op_type_t op_formats, calc_type_t calc_res)
+{
+    int64_t num = ((op_formats == div_s_u) || (op_formats == div_s_s)) ? (int64_t)(int32_t)op1 : (int64_t)op1;
+    int64_t den = ((op_formats == div_u_s) || (op_formats == div_s_s)) ? (int64_t)(int32_t)op2 : (int64_t)op2;
+
+    host_advance(HOST_COST_CALL);
+    if (den == 0)
+    {
+        return 0;
+    }
+    return (uint32_t)((calc_res == division) ? (num / den) : (num % den));
+}
+
+
+// ---- GPIO and interrupts
+
+static uint8_t rom_single_gpio_iocfg(const bool out_enable, const bool in_enable, const bool outtype, const bool pup,
+                                     const bool pdown, uint8_t gpio)
+{
+    (void)out_enable;
+    (void)in_enable;
+    (void)outtype;
+    (void)pup;
+    (void)pdown;
+    (void)gpio;
+    host_advance(HOST_COST_CALL);
+    return 0;
+}
+
+
+static uint8_t rom_get_singlegpio_in(uint8_t gpio)
+{
+    host_advance(HOST_COST_CALL);
+    return (uint8_t)((host_periph.gpio_in >> gpio) & 1U);
+}
+
+
+static void rom_set_singlegpio_alt(uint8_t gpio, uint8_t ain_en, uint8_t outsel)
+{
+    (void)gpio;
+    (void)ain_en;
+    (void)outsel;
+    host_advance(HOST_COST_CALL);
+}
+
+
+static void rom_config_irq_hp_matrix(void)
+{
+    host_advance(HOST_COST_CALL);
+}
+
+
+static uint8_t rom_get_adc_irq(void)
+{
+    return Event_Bus1_IRQn;
+}
+
+
+// ---- NVM
+
+static void rom_switch_on_nvm(void)
+{
+    host_advance(HOST_COST_CALL);
+    host_periph.nvm_on = true;
+}
+
+
+static void rom_switch_off_nvm(void)
+{
+    host_advance(HOST_COST_CALL);
+    host_periph.nvm_on = false;
+}
+
+
+static void rom_nvm_config(void)
+{
+    host_advance(HOST_COST_CALL);
+}
+
+
+/* The assembly buffer overlays the page on the device: the firmware writes the new contents to the addresses of the
+ * page. Here the page itself is made writable, as the linker has placed it with the constants.
+ */
+static uint8_t rom_nvm_open_assembly_buffer(uint32_t cpu_address)
+{
+    const uintptr_t page = (uintptr_t)sysconf(_SC_PAGESIZE);
+    const uintptr_t start = (uintptr_t)cpu_address & ~(page - 1);
+
+    host_advance(HOST_COST_CALL);
+    return (mprotect((void*)start, page, PROT_READ | PROT_WRITE) == 0) ? 0 : 1;
+}
+
+
+static uint8_t rom_nvm_program_page(void)
+{
+    host_advance(HOST_COST_NVM_PAGE);
+    return 0;
+}
+
+
+// ---- PMU
+
+static void rom_config_stbtm(bool on_off, uint32_t standby_time)
+{
+    host_advance(HOST_COST_CALL);
+    host_periph.stbtm_on = on_off;
+    host_periph.stbtm = standby_time;
+}
+
+
+static uint32_t rom_get_standby_time(void)
+{
+    host_advance(HOST_COST_CALL);
+    return host_periph.stbtm;
+}
+
+
+static wakeup_source_t rom_get_wakeup_source(void)
+{
+    host_advance(HOST_COST_CALL);
+    return (wakeup_source_t)host_periph.wakeup;
+}
+
+
+// only the standby timer wakes up in the simulation, the field stays on
+static void rom_request_power_saving_mode(bool wake_by_nfc, bool wake_by_stbtim, bool wake_by_wakeuppin,
+                                          wakeup_pol_t wakeup_polarity)
+{
+    (void)wake_by_nfc;
+    (void)wake_by_wakeuppin;
+    (void)wakeup_polarity;
+    if (wake_by_stbtim && host_periph.stbtm_on)
+    {
+        host_event(host_event_sleep, host_periph.stbtm);
+        host_advance((uint64_t)host_periph.stbtm * (HOST_TICKS_PER_SECOND) / (HOST_STBTM_HZ));
+        host_periph.wakeup = wakeup_stb_tim;
+    }
+}
+
+
+static void rom_single_shot_systick(uint32_t time)
+{
+    host_advance(time);
+}
+
+
+// ---- sense unit
+
+static void rom_sense_ctrl_config(sense_power_state_t adc_state, sense_power_state_t sh0_state,
+                                  sense_power_state_t sh1_state, sense_power_state_t dac_state,
+                                  sense_power_state_t i2v_state, sense_power_state_t comp_state,
+                                  sense_power_state_t ts_state, sense_power_state_t shts_state,
+                                  sense_en_dis_t attn_en_dis)
+{
+    (void)adc_state;
+    (void)sh0_state;
+    (void)sh1_state;
+    (void)dac_state;
+    (void)i2v_state;
+    (void)comp_state;
+    (void)attn_en_dis;
+    host_advance(HOST_COST_CALL);
+    host_periph.ts_on = (ts_state == sense_power_up) && (shts_state == sense_power_up);
+}
+
+
+static void rom_switch_on_sense(void)
+{
+    host_advance(HOST_COST_CALL);
+    host_periph.sense_on = true;
+}
+
+
+static void rom_switch_off_sense(void)
+{
+    host_advance(HOST_COST_CALL);
+    host_periph.sense_on = false;
+    host_periph.ts_on = false;
+}
+
+
+static void rom_sense_sh_config(s_h_type sample_hold, ain_sel_t ain_sel, i2v_sel_t i2v_sel, sense_en_dis_t auto_arm)
+{
+    (void)sample_hold;
+    (void)ain_sel;
+    (void)i2v_sel;
+    (void)auto_arm;
+    host_advance(HOST_COST_CALL);
+}
+
+
+/** @brief Conversion of the sample & hold stages, counted in host_periph
+ *
+ *  SH1 samples the motor current through the I2V converter, the temperature sensor is reported in sh_result[0] with
+ *  the calibration of settings.h. The ADC and SH0/SH1 are powered up by sense_sh() itself, the temperature sensor and
+ *  its sample & hold stage have to be powered up by sense_ctrl_config() before.
+ */
+static sh_result_t rom_sh_convert(const bool sh0_sense, const bool sh1_sense, const bool ts_sense)
+{
+    sh_result_t result = { { 0, 0 } };
+    double current;
+
+    host_periph.conversions++;
+    if (!host_periph.sense_on || (ts_sense && !host_periph.ts_on))
+    {
+        host_periph.unpowered++;
+        return result;
+    }
+    if (sh0_sense)
+    {
+        result.sh_result[0] = rom_adc_digits(host_plant_vcchb());
+    }
+    if (sh1_sense)
+    {
+        current = host_plant_motor_current();
+        current = (current < 0.0) ? -current : current;
+        result.sh_result[1] = (uint16_t)(current * 1000.0 * host_plant_params.i2v_digits_per_ma);
+    }
+    if (ts_sense)
+    {
+        result.sh_result[0] = (uint16_t)((TEMP_SENSE_RAW_25C) +
+                                         (host_plant_params.temperature - 25.0) * (TEMP_SENSE_SLOPE_Q8) / 256.0);
+    }
+
+    return result;
+}
+
+
+static sh_result_t rom_sense_sh(bool sh0_sense, bool sh1_sense, bool ts_sense)
+{
+    host_advance(HOST_COST_CONVERSION);
+    return rom_sh_convert(sh0_sense, sh1_sense, ts_sense);
+}
+
+
+// the conversions run in hardware, no time of the firmware is taken
+void host_sense_trigger(void)
+{
+    const sh_result_t result = rom_sh_convert(true, true, false);
+    const uint32_t evt_cfg = HAL_GET32(SENSE_SH1_EVT_CFG);
+
+    HAL_SET32(SENSE_SH0_RESULT, result.sh_result[0]);
+    HAL_SET32(SENSE_SH1_RESULT, result.sh_result[1]);
+    HAL_SET32(SENSE_SH1_STATUS, HAL_GET32(SENSE_SH1_STATUS) | SENSE_STATUS_DONE);
+    if ((evt_cfg & SENSE_EVT_IRQ_EN) != 0)
+    {
+        host_irq_raise((IRQn_Type)(evt_cfg & 0xffUL));
+    }
+}
+
+
+// the RSSI follows the harvested power with the default factor of the field estimation
+static uint16_t rom_get_nfc_value(sense_nfc_sel_t value)
+{
+    host_advance(HOST_COST_CONVERSION);
+    host_periph.conversions++;
+    if (!host_periph.sense_on)
+    {
+        host_periph.unpowered++;
+        return 0;
+    }
+    if (value == nfc_sel_rssi)
+    {
+        return (uint16_t)(host_plant_field_power() * 1e6 * 256.0 / (FIELD_POWER_PER_RSSI_Q8));
+    }
+    return rom_adc_digits(host_plant_vcchb());
+}
+
+
+// ---- system timer
+
+/* The channels count the clock cycles of the simulated time. Only their wraparound is modelled, for the trigger of the
+ * sense unit (see host_advance()); the configuration and the other events are ignored.
+ */
+static void rom_sys_tim_chn_cfg(const sys_tim_config_struct_t* sys_tim_config, const uint32_t channel)
+{
+    (void)sys_tim_config;
+    (void)channel;
+    host_advance(HOST_COST_CALL);
+}
+
+
+static void rom_sys_tim_chn_control(const enum sys_tim_control_E start_stop, const uint32_t channel)
+{
+    host_advance(HOST_COST_CALL);
+    if (channel >= HOST_SYS_TIM_CHANNELS)
+    {
+        return;
+    }
+    if (start_stop == sys_tim_start)
+    {
+        host_periph.tim_running |= (uint8_t)(1U << channel);
+        host_periph.tim_next[channel] = host_now + host_periph.tim_period[channel];
+    }
+    else
+    {
+        host_periph.tim_running &= (uint8_t)~(1U << channel);
+    }
+}
+
+
+static void rom_set_sys_tim_chn_period(const uint32_t period, const uint32_t channel)
+{
+    host_advance(HOST_COST_CALL);
+    if (channel < HOST_SYS_TIM_CHANNELS)
+    {
+        host_periph.tim_period[channel] = period;
+    }
+}
+
+
+static void rom_sys_tim_chn_evnt_cfg(const uint8_t en_hprio, const uint8_t irq_event, const uint8_t adc_event,
+                                     const uint32_t event_code, const uint32_t channel)
+{
+    (void)en_hprio;
+    (void)irq_event;
+    (void)event_code;
+    host_advance(HOST_COST_CALL);
+    if (channel < HOST_SYS_TIM_CHANNELS)
+    {
+        host_periph.tim_adc_event[channel] = adc_event;
+    }
+}
+
+
+const rom_func_table_t rom_func_table =
+{
+    .m_single_gpio_iocfg = rom_single_gpio_iocfg,
+    .m_get_singlegpio_in = rom_get_singlegpio_in,
+    .m_set_singlegpio_alt = rom_set_singlegpio_alt,
+    .m_get_adc_irq = rom_get_adc_irq,
+    .m_config_irq_hp_matrix = rom_config_irq_hp_matrix,
+    .m_set_hb_switch = rom_set_hb_switch,
+    .m_set_hb_eventctrl = rom_set_hb_eventctrl,
+    .m_set_hb_config = rom_set_hb_config,
+    .m_calc_div = rom_calc_div,
+    .m_switch_on_nvm = rom_switch_on_nvm,
+    .m_switch_off_nvm = rom_switch_off_nvm,
+    .m_nvm_config = rom_nvm_config,
+    .m_nvm_open_assembly_buffer = rom_nvm_open_assembly_buffer,
+    .m_nvm_program_page = rom_nvm_program_page,
+    .m_config_stbtm = rom_config_stbtm,
+    .m_get_standby_time = rom_get_standby_time,
+    .m_get_wakeup_source = rom_get_wakeup_source,
+    .m_request_power_saving_mode = rom_request_power_saving_mode,
+    .m_single_shot_systick = rom_single_shot_systick,
+    .m_sense_ctrl_config = rom_sense_ctrl_config,
+    .m_switch_on_sense = rom_switch_on_sense,
+    .m_switch_off_sense = rom_switch_off_sense,
+    .m_sense_sh_config = rom_sense_sh_config,
+    .m_sense_sh = rom_sense_sh,
+    .m_get_nfc_value = rom_get_nfc_value,
+    .m_sys_tim_chn_cfg = rom_sys_tim_chn_cfg,
+    .m_sys_tim_chn_control = rom_sys_tim_chn_control,
+    .m_set_sys_tim_chn_period = rom_set_sys_tim_chn_period,
+    .m_sys_tim_chn_evnt_cfg = rom_sys_tim_chn_evnt_cfg,
+};
@@ -0,0 +1,307 @@
+/* ============================================================================
+** Copyright (c) 2021 Infineon Technologies AG
+**               All rights reserved.
+**               www.infineon.com
+** ============================================================================
+**
+** ============================================================================
+** Redistribution and use of this software only permitted to the extent
+** expressly agreed with Infineon Technologies AG.
+** ============================================================================
+*
+*/
+
+/** @file     host_sim.c
+ *  @brief    Simulated time and interrupts of the host build
+ *
+ *  The firmware runs natively and in zero time. Time passes only in the emulated library functions: the waits
+ *  (sys_tim_singleshot_32(), single_shot_systick(), the power saving mode) take their duration, every other call its
+ *  cost (HOST_COST_...). While time passes, the plant is advanced in steps of at most HOST_STEP_TICKS, so the
+ *  firmware sees the same VCCHB voltage and timer values as on the device, only many times faster.
+ *
+ *  The interrupts are dispatched to the firmware handlers which the aparams install on the device (sl_aparam.c). The
+ *  peripheral registers accessed directly by the firmware are backed by plain memory mapped at their addresses; the
+ *  results of the timer triggered conversions (adc_capture.c) are written there by the model of the sense unit.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+// Smack ROM lib
+#include "pmu.h"
+#include "sys_tim_drv.h"
+
+// Smack stepwise project
+#include "settings.h"
+#include "encoder.h"
+#include "endstop.h"
+#include "adc_capture.h"
+
+// host build
+#include "host_sim.h"
+#include "host_plant.h"
+
+
+#define HOST_IRQ_COUNT      32
+
+// firmware entry point (smack_stepwise.c)
+extern void _nvm_start(void);
+
+// address windows of the peripheral registers accessed directly by the firmware
+static const struct
+{
+    uintptr_t base;
+    size_t    size;
+} host_register_windows[] =
+{
+    { 0x20010000UL, 0x10000UL },    // system control unit
+    { 0x40000000UL, 0x10000UL },    // H bridge, sense unit
+};
+
+// interrupt handlers as installed by the aparams; serve_adc_irq() of the ROM library calls the custom ADC handler
+static void (* const host_vectors[HOST_IRQ_COUNT])(void) =
+{
+    [Event_Bus1_IRQn] = adc_capture_irq,
+    [Event_Bus6_IRQn] = encoder_irq,
+    [HPrio_Matrix4_IRQn] = endstop_irq,
+    [HPrio_Matrix5_IRQn] = endstop_irq,
+};
+
+uint64_t host_now;
+host_periph_t host_periph;
+host_event_hook_t host_event_hook;
+
+static jmp_buf  host_jump;
+static host_idle_t host_idle;
+static uint64_t host_limit;
+static uint32_t host_enabled;       // NVIC enable bits
+static uint32_t host_pending;       // NVIC pending bits
+static bool     host_masked;        // PRIMASK
+static bool     host_in_irq;
+static uint32_t host_pulses;        // encoder pulses of the plant passed to the firmware
+
+
+void host_map_registers(void)
+{
+    static bool mapped = false;
+    size_t i;
+
+    if (mapped)
+    {
+        for (i = 0; i < sizeof(host_register_windows) / sizeof(host_register_windows[0]); i++)
+        {
+            memset((void*)host_register_windows[i].base, 0, host_register_windows[i].size);
+        }
+        return;
+    }
+    for (i = 0; i < sizeof(host_register_windows) / sizeof(host_register_windows[0]); i++)
+    {
+        if (mmap((void*)host_register_windows[i].base, host_register_windows[i].size, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0) == MAP_FAILED)
+        {
+            fprintf(stderr, "host_sim: cannot map the registers at 0x%08lx\n", (unsigned long)host_register_windows[i].base);
+            exit(EXIT_FAILURE);
+        }
+    }
+    mapped = true;
+}
+
+
+/** @brief Serve the pending interrupts which are enabled, unless masked
+ */
+static void host_irq_serve(void)
+{
+    uint32_t irq;
+
+    while (!host_masked && !host_in_irq && ((host_pending & host_enabled) != 0))
+    {
+        for (irq = 0; (host_pending & host_enabled & (1UL << irq)) == 0; irq++)
+        {
+        }
+        host_pending &= ~(1UL << irq);
+        if (host_vectors[irq] != NULL)
+        {
+            host_in_irq = true;
+            host_vectors[irq]();
+            host_in_irq = false;
+        }
+    }
+}
+
+
+/** @brief Pass the events of the plant to the firmware: encoder pulses and end stop switches
+ */
+static void host_plant_events(void)
+{
+    const uint32_t gpio = ((uint32_t)host_plant_state.endstop_forward << (ENDSTOP_GPIO_FORWARD)) |
+                          ((uint32_t)host_plant_state.endstop_backward << (ENDSTOP_GPIO_BACKWARD));
+    const uint32_t rising = gpio & ~host_periph.gpio_in;
+
+    host_periph.gpio_in = (uint8_t)gpio;
+    if ((rising & (1UL << (ENDSTOP_GPIO_FORWARD))) != 0)
+    {
+        host_pending |= 1UL << HPrio_Matrix4_IRQn;
+    }
+    if ((rising & (1UL << (ENDSTOP_GPIO_BACKWARD))) != 0)
+    {
+        host_pending |= 1UL << HPrio_Matrix5_IRQn;
+    }
+
+    // one interrupt per pulse; at a few kHz there is rarely more than one pulse per step
+    if (host_plant_state.pulses < host_pulses)
+    {
+        // the plant has been reset
+        host_pulses = host_plant_state.pulses;
+    }
+    while (host_pulses != host_plant_state.pulses)
+    {
+        host_pulses++;
+        host_irq_raise(Event_Bus6_IRQn);
+    }
+}
+
+
+/** @brief Trigger the sense unit on each wraparound of a system timer channel configured for it (adc_capture.c)
+ */
+static void host_timer_events(void)
+{
+    uint32_t channel;
+
+    for (channel = 0; channel < HOST_SYS_TIM_CHANNELS; channel++)
+    {
+        if (((host_periph.tim_running & (1U << channel)) == 0) ||
+            (host_periph.tim_adc_event[channel] != EV_ADC_TRIG_SH0_SH1) || (host_periph.tim_period[channel] == 0))
+        {
+            continue;
+        }
+        while (host_now >= host_periph.tim_next[channel])
+        {
+            host_periph.tim_next[channel] += host_periph.tim_period[channel];
+            host_sense_trigger();
+        }
+    }
+}
+
+
+int host_run(const host_idle_t idle, const uint64_t limit)
+{
+    int code;
+
+    host_map_registers();
+
+    host_now = 0;
+    host_periph = (host_periph_t){ .nvm_on = true, .wakeup = wakeup_nfc };
+    host_idle = idle;
+    host_limit = limit;
+    host_enabled = 0;
+    host_pending = 0;
+    host_masked = false;
+    host_in_irq = false;
+    host_pulses = host_plant_state.pulses;
+
+    code = setjmp(host_jump);
+    if (code == 0)
+    {
+        _nvm_start();
+    }
+
+    return (code == HOST_EXIT_IDLE + 0x100) ? HOST_EXIT_IDLE : code;
+}
+
+
+void host_advance(const uint64_t ticks)
+{
+    uint64_t left = ticks;
+    uint64_t step;
+
+    host_hb_sync();
+    while (left != 0)
+    {
+        step = (left < HOST_STEP_TICKS) ? left : HOST_STEP_TICKS;
+        host_plant_advance((double)step / (HOST_TICKS_PER_SECOND));
+        host_now += step;
+        left -= step;
+        host_plant_events();
+        host_timer_events();
+        host_irq_serve();
+
+        if ((host_limit != 0) && (host_now >= host_limit))
+        {
+            host_exit(HOST_EXIT_TIMEOUT);
+        }
+    }
+}
+
+
+void host_wfi(void)
+{
+    if ((host_idle == NULL) || !host_idle())
+    {
+        host_exit(HOST_EXIT_IDLE);
+    }
+}
+
+
+void host_exit(const int code)
+{
+    // longjmp() cannot pass 0
+    longjmp(host_jump, (code == HOST_EXIT_IDLE) ? HOST_EXIT_IDLE + 0x100 : code);
+}
+
+
+void host_event(const host_event_t event, const uint32_t value)
+{
+    if (host_event_hook != NULL)
+    {
+        host_event_hook(event, value);
+    }
+}
+
+
+void host_irq_raise(const IRQn_Type irq)
+{
+    if ((irq >= 0) && (irq < HOST_IRQ_COUNT))
+    {
+        host_pending |= 1UL << irq;
+        host_irq_serve();
+    }
+}
+
+
+void host_irq_mask(const bool masked)
+{
+    host_masked = masked;
+    host_irq_serve();
+}
+
+
+void host_nvic_enable(const IRQn_Type irq, const bool enable)
+{
+    if ((irq >= 0) && (irq < HOST_IRQ_COUNT))
+    {
+        if (enable)
+        {
+            host_enabled |= 1UL << irq;
+        }
+        else
+        {
+            host_enabled &= ~(1UL << irq);
+        }
+        host_irq_serve();
+    }
+}
+
+
+void host_nvic_clear_pending(const IRQn_Type irq)
+{
+    if ((irq >= 0) && (irq < HOST_IRQ_COUNT))
+    {
+        host_pending &= ~(1UL << irq);
+    }
+}
@@ -0,0 +1,432 @@
+/* ============================================================================
+** Copyright (c) 2021 Infineon Technologies AG
+**               All rights reserved.
+**               www.infineon.com
+** ============================================================================
+**
+** ============================================================================
+** Redistribution and use of this software only permitted to the extent
+** expressly agreed with Infineon Technologies AG.
+** ============================================================================
+*
+*/
+
+/** @file     host_sweep.c
+ *  @brief    Parameter sweep of the stepwise settings in the host build
+ *
+ *  Runs one movement for each combination of the settings swept (VOLTAGE_ON, VOLTAGE_OFF, DELAY_ADDITIONAL_CHARGE,
+ *  POLL_PERIOD, given as ranges min:max:step) and each sample of the plant. The samples cover the production spread:
+ *  field strength, tolerance of the HB cap, load (friction) and temperature, drawn at random (-N) or on a grid (-G).
+ *  All settings are run on the same samples, so their results can be compared directly.
+ *
+ *  The firmware keeps its state in static variables, so each run is done in a child process of its own; the runs
+ *  are distributed over all CPU cores. The movement at power up (MOTION_STARTUP_COMMAND), if any, is not counted: the
+ *  plant is reset after it, and the movement is started with the swept settings.
+ *
+ *  One line is printed per setting: runs, failures (time limit reached, or stalled), actuation time (mean, 95th
+ *  percentile, maximum), steps (motor starts) and the movement in motor revolutions (mean, standard deviation).
+ *
+ *  usage: smack_sweep [-V on] [-O off] [-D charge] [-P poll] [-N samples | -G points] [-f field] [-c cap_tol_pct]
+ *                     [-L friction_unm] [-t temperature] [-b] [-l limit_s] [-s seed] [-j jobs]
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+// Smack stepwise project
+#include "settings.h"
+#include "smack_stepwise.h"
+
+// host build
+#include "host_sim.h"
+#include "host_plant.h"
+
+
+/**
+ * @brief range of a swept setting or of a spread of the plant
+ */
+typedef struct sweep_range_s
+{
+    double min;
+    double max;
+    double step;                // for the settings: 0 means a single value
+} sweep_range_t;
+
+/**
+ * @brief plant of one sample of the production spread
+ */
+typedef struct sweep_sample_s
+{
+    double field;
+    double cap_uf;
+    double friction_unm;
+    double temperature;
+} sweep_sample_t;
+
+/**
+ * @brief settings of one point of the sweep
+ */
+typedef struct sweep_setting_s
+{
+    uint16_t voltage_on;
+    uint16_t voltage_off;
+    uint16_t additional_charge;
+    uint16_t poll_period;
+} sweep_setting_t;
+
+/**
+ * @brief result of one run, passed from the child process through a pipe
+ */
+typedef struct sweep_result_s
+{
+    int      code;              // exit code of host_run()
+    uint8_t  end;               // stepwise_end_t
+    double   duration_ms;       // actuation time
+    uint32_t steps;             // motor starts
+    double   revolutions;       // movement of the motor
+} sweep_result_t;
+
+
+static motion_dir_t sweep_direction = motion_forward;
+static const sweep_setting_t* sweep_current;    // setting of the run in this process
+static sweep_result_t sweep_run_result;
+
+
+/** @brief Parse a range "min:max:step", "min:max" or "value"
+ */
+static sweep_range_t sweep_parse(const char* text)
+{
+    sweep_range_t range = { 0.0, 0.0, 0.0 };
+    char* end;
+
+    range.min = strtod(text, &end);
+    range.max = (*end == ':') ? strtod(end + 1, &end) : range.min;
+    range.step = (*end == ':') ? strtod(end + 1, &end) : 0.0;
+
+    return range;
+}
+
+
+/** @brief Number of values of a swept setting
+ */
+static unsigned sweep_count(const sweep_range_t* range)
+{
+    return ((range->step > 0.0) && (range->max > range->min)) ?
+           (unsigned)floor((range->max - range->min) / range->step + 1e-9) + 1U : 1U;
+}
+
+
+/** @brief Value number n of a swept setting
+ */
+static uint16_t sweep_value(const sweep_range_t* range, const unsigned n)
+{
+    return (uint16_t)lround(range->min + range->step * n);
+}
+
+
+/** @brief Pseudo random number in [0, 1) (xorshift64*), reproducible from the seed
+ */
+static double sweep_random(uint64_t* state)
+{
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return (double)((*state * 0x2545F4914F6CDD1DULL) >> 11) / 9007199254740992.0;
+}
+
+
+/** @brief Point of a range: at random, or point n of k on a grid
+ */
+static double sweep_spread(const sweep_range_t* range, uint64_t* state, const unsigned n, const unsigned k)
+{
+    const double f = (state != NULL) ? sweep_random(state) : ((k > 1) ? (double)n / (double)(k - 1) : 0.5);
+
+    return range->min + (range->max - range->min) * f;
+}
+
+
+/** @brief Idle hook: start the movement with the swept settings, or end the run when it is done
+ */
+static bool sweep_idle(void)
+{
+    stepwise_params_t profile;
+    const uint64_t start = host_now;
+    const uint32_t steps = host_periph.motor_starts;
+    double position;
+
+    // the movement at power up only brings the firmware into its background loop
+    host_plant_reset();
+    position = host_plant_state.position;
+
+    motion_profile_default(sweep_direction, &profile);
+    profile.voltage_on = sweep_current->voltage_on;
+    profile.voltage_off = sweep_current->voltage_off;
+    profile.additional_charge = sweep_current->additional_charge;
+    profile.poll_period = sweep_current->poll_period;
+    motion_run(sweep_direction, &profile);
+
+    sweep_run_result.end = stepwise_status.end;
+    sweep_run_result.duration_ms = (double)(host_now - start) * 1000.0 / (HOST_TICKS_PER_SECOND);
+    sweep_run_result.steps = host_periph.motor_starts - steps;
+    sweep_run_result.revolutions = host_plant_state.position - position;
+
+    return false;
+}
+
+
+/** @brief Run one movement in this (child) process
+ */
+static sweep_result_t sweep_run(const sweep_setting_t* setting, const sweep_sample_t* sample, const double limit)
+{
+    sweep_current = setting;
+    memset(&sweep_run_result, 0, sizeof(sweep_run_result));
+
+    host_plant_defaults();
+    host_plant_params.field = sample->field;
+    host_plant_params.cap_uf = sample->cap_uf;
+    host_plant_params.friction_unm = sample->friction_unm;
+    host_plant_params.temperature = sample->temperature;
+    host_plant_reset();
+
+    sweep_run_result.code = host_run(sweep_idle, (uint64_t)(limit * (HOST_TICKS_PER_SECOND)));
+
+    return sweep_run_result;
+}
+
+
+static int sweep_compare(const void* a, const void* b)
+{
+    const double x = *(const double*)a;
+    const double y = *(const double*)b;
+
+    return (x > y) - (x < y);
+}
+
+
+/** @brief Print the statistics of one setting
+ */
+static void sweep_report(const sweep_setting_t* setting, const sweep_result_t* results, const unsigned count)
+{
+    double* durations = malloc(count * sizeof(double));
+    unsigned ok = 0;
+    double time_sum = 0.0, steps_sum = 0.0, rev_sum = 0.0, rev_sq = 0.0;
+    double rev_mean = 0.0, rev_std = 0.0;
+    unsigned i;
+
+    for (i = 0; i < count; i++)
+    {
+        if ((results[i].code != HOST_EXIT_IDLE) || (results[i].end == stepwise_end_stall) ||
+            (results[i].end == stepwise_end_none))
+        {
+            continue;
+        }
+        durations[ok++] = results[i].duration_ms;
+        time_sum += results[i].duration_ms;
+        steps_sum += results[i].steps;
+        rev_sum += results[i].revolutions;
+        rev_sq += results[i].revolutions * results[i].revolutions;
+    }
+
+    if (ok != 0)
+    {
+        qsort(durations, ok, sizeof(double), sweep_compare);
+        rev_mean = rev_sum / ok;
+        rev_std = sqrt(fmax(rev_sq / ok - rev_mean * rev_mean, 0.0));
+    }
+    printf("%u,%u,%u,%u,%u,%u,%.3f,%.1f,%.1f,%.1f,%.1f,%.3f,%.3f\n", setting->voltage_on, setting->voltage_off,
+           setting->additional_charge, setting->poll_period, count, count - ok, (double)(count - ok) / count,
+           (ok != 0) ? time_sum / ok : 0.0, (ok != 0) ? durations[(unsigned)ceil(0.95 * ok) - 1] : 0.0,
+           (ok != 0) ? durations[ok - 1] : 0.0, (ok != 0) ? steps_sum / ok : 0.0, rev_mean, rev_std);
+    free(durations);
+}
+
+
+int main(int argc, char* argv[])
+{
+    sweep_range_t on = { VOLTAGE_ON, VOLTAGE_ON, 0.0 };
+    sweep_range_t off = { VOLTAGE_OFF, VOLTAGE_OFF, 0.0 };
+    sweep_range_t charge = { DELAY_ADDITIONAL_CHARGE, DELAY_ADDITIONAL_CHARGE, 0.0 };
+    sweep_range_t poll = { POLL_PERIOD, POLL_PERIOD, 0.0 };
+    sweep_range_t field = { 0.8, 1.5, 0.0 };
+    sweep_range_t friction = { 30.0, 80.0, 0.0 };
+    sweep_range_t temperature = { 25.0, 25.0, 0.0 };
+    double cap_tolerance = 20.0;
+    unsigned samples = 32;
+    unsigned grid = 0;
+    uint64_t seed = 1;
+    double limit = 300.0;
+    long jobs = sysconf(_SC_NPROCESSORS_ONLN);
+    sweep_setting_t* settings;
+    sweep_sample_t* plants;
+    sweep_result_t* results;
+    unsigned setting_count = 0;
+    unsigned total, next, running, done;
+    unsigned i, a, b, c, d;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "V:O:D:P:N:G:f:c:L:t:bl:s:j:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'V': on = sweep_parse(optarg); break;
+            case 'O': off = sweep_parse(optarg); break;
+            case 'D': charge = sweep_parse(optarg); break;
+            case 'P': poll = sweep_parse(optarg); break;
+            case 'N': samples = (unsigned)strtoul(optarg, NULL, 0); break;
+            case 'G': grid = (unsigned)strtoul(optarg, NULL, 0); break;
+            case 'f': field = sweep_parse(optarg); break;
+            case 'c': cap_tolerance = strtod(optarg, NULL); break;
+            case 'L': friction = sweep_parse(optarg); break;
+            case 't': temperature = sweep_parse(optarg); break;
+            case 'b': sweep_direction = motion_backward; break;
+            case 'l': limit = strtod(optarg, NULL); break;
+            case 's': seed = strtoull(optarg, NULL, 0); break;
+            case 'j': jobs = strtol(optarg, NULL, 0); break;
+            default:
+                fprintf(stderr, "usage: %s [-V on] [-O off] [-D charge] [-P poll] [-N samples | -G points] [-f field] "
+                                "[-c cap_tol_pct] [-L friction_unm] [-t temperature] [-b] [-l limit_s] [-s seed] "
+                                "[-j jobs]\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    jobs = (jobs > 0) ? jobs : 1;
+    seed = (seed != 0) ? seed : 1;
+
+    // settings: all combinations, the ones with VOLTAGE_OFF not below VOLTAGE_ON are left out
+    settings = malloc(sweep_count(&on) * sweep_count(&off) * sweep_count(&charge) * sweep_count(&poll) *
+                      sizeof(sweep_setting_t));
+    for (a = 0; a < sweep_count(&on); a++)
+    {
+        for (b = 0; b < sweep_count(&off); b++)
+        {
+            for (c = 0; c < sweep_count(&charge); c++)
+            {
+                for (d = 0; d < sweep_count(&poll); d++)
+                {
+                    const sweep_setting_t s = { sweep_value(&on, a), sweep_value(&off, b), sweep_value(&charge, c),
+                                                sweep_value(&poll, d) };
+
+                    if ((s.voltage_off < s.voltage_on) && (s.poll_period != 0))
+                    {
+                        settings[setting_count++] = s;
+                    }
+                }
+            }
+        }
+    }
+
+    // samples of the production spread, the same for all settings
+    samples = (grid != 0) ? grid * grid * grid : samples;
+    plants = malloc(samples * sizeof(sweep_sample_t));
+    for (i = 0; i < samples; i++)
+    {
+        const sweep_range_t cap = { VCCHB_CAPACITANCE_UF * (1.0 - cap_tolerance / 100.0),
+                                    VCCHB_CAPACITANCE_UF * (1.0 + cap_tolerance / 100.0), 0.0 };
+        uint64_t* const random = (grid != 0) ? NULL : &seed;
+
+        plants[i].field = sweep_spread(&field, random, i % (grid ? grid : 1), grid);
+        plants[i].cap_uf = sweep_spread(&cap, random, (i / (grid ? grid : 1)) % (grid ? grid : 1), grid);
+        plants[i].friction_unm = sweep_spread(&friction, random, (i / (grid ? grid * grid : 1)) % (grid ? grid : 1), grid);
+        plants[i].temperature = sweep_spread(&temperature, random, 0, 1);
+    }
+
+    total = setting_count * samples;
+    results = calloc((total != 0) ? total : 1, sizeof(sweep_result_t));
+    if ((settings == NULL) || (plants == NULL) || (results == NULL))
+    {
+        fprintf(stderr, "out of memory\n");
+        return EXIT_FAILURE;
+    }
+
+    // one child process per run, at most jobs at a time
+    {
+        pid_t* pids = calloc((size_t)jobs, sizeof(pid_t));
+        int* pipes = calloc((size_t)jobs, sizeof(int));
+        unsigned* run_of = calloc((size_t)jobs, sizeof(unsigned));
+        int status;
+        long slot;
+
+        next = 0;
+        running = 0;
+        done = 0;
+        while (done < total)
+        {
+            while ((next < total) && (running < (unsigned)jobs))
+            {
+                int fd[2];
+                pid_t pid;
+
+                for (slot = 0; pids[slot] != 0; slot++)
+                {
+                }
+                if (pipe(fd) != 0)
+                {
+                    perror("pipe");
+                    return EXIT_FAILURE;
+                }
+                fflush(stdout);
+                pid = fork();
+                if (pid == 0)
+                {
+                    const sweep_result_t result = sweep_run(&settings[next / samples], &plants[next % samples], limit);
+
+                    close(fd[0]);
+                    _exit((write(fd[1], &result, sizeof(result)) == (ssize_t)sizeof(result)) ? 0 : 1);
+                }
+                if (pid < 0)
+                {
+                    perror("fork");
+                    return EXIT_FAILURE;
+                }
+                close(fd[1]);
+                pids[slot] = pid;
+                pipes[slot] = fd[0];
+                run_of[slot] = next++;
+                running++;
+            }
+
+            {
+                const pid_t pid = wait(&status);
+
+                for (slot = 0; (slot < jobs) && (pids[slot] != pid); slot++)
+                {
+                }
+                if (slot == jobs)
+                {
+                    continue;
+                }
+                if (read(pipes[slot], &results[run_of[slot]], sizeof(sweep_result_t)) != (ssize_t)sizeof(sweep_result_t))
+                {
+                    // the run has crashed
+                    results[run_of[slot]].code = -1;
+                }
+                close(pipes[slot]);
+                pids[slot] = 0;
+                running--;
+                done++;
+            }
+        }
+        free(pids);
+        free(pipes);
+        free(run_of);
+    }
+
+    printf("voltage_on,voltage_off,additional_charge,poll_period,runs,failures,failure_rate,"
+           "time_mean_ms,time_p95_ms,time_max_ms,steps_mean,revolutions_mean,revolutions_std\n");
+    for (i = 0; i < setting_count; i++)
+    {
+        sweep_report(&settings[i], &results[i * samples], samples);
+    }
+
+    free(settings);
+    free(plants);
+    free(results);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,240 @@
+/* ============================================================================
+** Copyright (c) 2021 Infineon Technologies AG
+**               All rights reserved.
+**               www.infineon.com
+** ============================================================================
+**
+** ============================================================================
+** Redistribution and use of this software only permitted to the extent
+** expressly agreed with Infineon Technologies AG.
+** ============================================================================
+*
+*/
+
+/** @file     host_test_adc.c
+ *  @brief    Test of the timer triggered ADC capture in the host build
+ *
+ *  The capture is run against the model of the sense unit: each wraparound of the trigger channel converts both
+ *  sample & hold stages and raises the ADC interrupt, which is dispatched to adc_capture_irq() like serve_adc_irq()
+ *  does on the device. The samples are checked as they come out of the ring buffer:
+ *  - capture:  one sample per period, with the VCCHB voltage and the motor current of the plant at the trigger, while
+ *              the motor is switched on and off
+ *  - overrun:  the buffer is not read for more periods than it holds; the first ADC_CAPTURE_BUFFER_SIZE samples must
+ *              be kept, the rest counted by adc_capture_overruns() and seen as a gap of the sequence numbers
+ *  - wrap:     read in bursts of half the buffer across the wraparound of the 16 bit indices, no sample may get lost
+ *  - stop:     no more samples after adc_capture_stop()
+ *
+ *  usage: smack_test_adc [-n samples] [-p period]
+ *  The exit code is EXIT_FAILURE if a check fails in any test, or a conversion has been done with the sense unit off.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+// Smack ROM lib
+#include "rom_lib.h"
+
+// Smack stepwise project
+#include "settings.h"
+#include "power_domain.h"
+#include "adc_capture.h"
+
+// host build
+#include "host_sim.h"
+#include "host_plant.h"
+
+
+static uint16_t test_period = ADC_CAPTURE_PERIOD;  // sample period, clock cycles
+
+
+/** @brief Start the capture on a reset plant
+ */
+static void test_start(void)
+{
+    host_plant_reset();
+    host_map_registers();
+    host_now = 0;
+    host_periph = (host_periph_t){ .nvm_on = true };
+#if defined POWER_MANAGER_ENABLE && POWER_MANAGER_ENABLE
+    power_init();
+#endif
+    adc_capture_start(test_period);
+}
+
+
+/** @brief Print a result line
+ *  @param name     name of the test
+ *  @param samples  number of samples checked
+ *  @param errors   number of failed checks
+ *  @return         true if no check has failed, and no conversion has been done with the sense unit off
+ */
+static bool test_report(const char* const name, const uint32_t samples, const uint32_t errors)
+{
+    printf("%s,%lu,%lu,%lu,%lu\n", name, (unsigned long)samples, (unsigned long)errors,
+           (unsigned long)adc_capture_overruns(), (unsigned long)host_periph.unpowered);
+    return (errors == 0) && (host_periph.unpowered == 0);
+}
+
+
+/** @brief One sample per period, compared with the plant at the trigger
+ *  @param count    number of samples
+ *  @return         true if all checks passed
+ */
+static bool test_capture(const uint32_t count)
+{
+    uint32_t errors = 0;
+    adc_sample_t sample;
+    double vcchb, current;
+    uint16_t digits;
+    uint32_t i;
+
+    test_start();
+    for (i = 0; i < count; i++)
+    {
+        // the motor is switched on for 16 periods every 64 periods, VCCHB drops and recovers
+        if ((i % 64) == 0)
+        {
+            set_hb_switch(true, false, false, true);
+        }
+        else if ((i % 64) == 16)
+        {
+            set_hb_switch(false, false, false, false);
+        }
+
+        // up to the next trigger, which falls on the end of the last plant step
+        host_advance(host_periph.tim_next[TIMER_ADC_TRIGGER] - host_now);
+        vcchb = host_plant_vcchb() * 1024.0;
+        digits = (vcchb <= 0.0) ? 0 : ((vcchb >= 8191.0) ? 8191 : (uint16_t)vcchb);
+        current = host_plant_motor_current();
+        current = (current < 0.0) ? -current : current;
+
+        if (!adc_capture_read(&sample) ||
+            (sample.seq != (uint16_t)(i + 1)) ||
+            (sample.vcchb != (uint16_t)(((uint32_t)digits * (ADC_CAPTURE_VCCHB_SCALE)) >> 10)) ||
+            (sample.current != (uint16_t)(current * 1000.0 * host_plant_params.i2v_digits_per_ma)) ||
+            adc_capture_read(&sample))
+        {
+            errors++;
+        }
+    }
+    set_hb_switch(false, false, false, false);
+    errors += (adc_capture_overruns() == 0) ? 0 : 1;
+    adc_capture_stop();
+
+    return test_report("capture", count, errors);
+}
+
+
+/** @brief The buffer is left full for some periods
+ *  @param extra    number of samples beyond the size of the buffer
+ *  @return         true if all checks passed
+ */
+static bool test_overrun(const uint32_t extra)
+{
+    uint32_t errors = 0;
+    adc_sample_t sample;
+    uint32_t i;
+
+    test_start();
+    host_advance((uint64_t)test_period * ((ADC_CAPTURE_BUFFER_SIZE) + extra));
+    for (i = 0; i < (ADC_CAPTURE_BUFFER_SIZE); i++)
+    {
+        errors += (adc_capture_read(&sample) && (sample.seq == (uint16_t)(i + 1))) ? 0 : 1;
+    }
+    errors += adc_capture_read(&sample) ? 1 : 0;
+    errors += (adc_capture_overruns() == extra) ? 0 : 1;
+
+    // the buffer takes samples again, after a gap of the sequence number
+    host_advance(test_period);
+    errors += (adc_capture_read(&sample) && (sample.seq == (uint16_t)((ADC_CAPTURE_BUFFER_SIZE) + extra + 1))) ? 0 : 1;
+    errors += (adc_capture_overruns() == extra) ? 0 : 1;
+    adc_capture_stop();
+
+    return test_report("overrun", (ADC_CAPTURE_BUFFER_SIZE) + extra + 1, errors);
+}
+
+
+/** @brief Reading in bursts until the indices have wrapped around
+ *  @param count    number of samples, more than 65536 to cover the wraparound
+ *  @return         true if all checks passed
+ */
+static bool test_wrap(const uint32_t count)
+{
+    const uint32_t burst = (ADC_CAPTURE_BUFFER_SIZE) / 2;
+    uint32_t errors = 0;
+    uint32_t read = 0;
+    adc_sample_t sample;
+
+    test_start();
+    while (read < count)
+    {
+        host_advance((uint64_t)test_period * burst);
+        while (adc_capture_read(&sample))
+        {
+            read++;
+            errors += (sample.seq == (uint16_t)read) ? 0 : 1;
+        }
+    }
+    errors += (adc_capture_overruns() == 0) ? 0 : 1;
+    adc_capture_stop();
+
+    return test_report("wrap", read, errors);
+}
+
+
+/** @brief No samples after the capture has been stopped
+ *  @return         true if all checks passed
+ */
+static bool test_stop(void)
+{
+    uint32_t errors = 0;
+    adc_sample_t sample;
+
+    test_start();
+    host_advance(test_period);
+    adc_capture_stop();
+    errors += (adc_capture_read(&sample) && (sample.seq == 1)) ? 0 : 1;
+    host_advance((uint64_t)test_period * 4);
+    errors += adc_capture_read(&sample) ? 1 : 0;
+    errors += ((host_periph.tim_running & (1U << (TIMER_ADC_TRIGGER))) == 0) ? 0 : 1;
+
+    return test_report("stop", 1, errors);
+}
+
+
+int main(int argc, char* argv[])
+{
+    uint32_t count = 1000;
+    bool ok = true;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:p:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n': count = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'p': test_period = (uint16_t)strtoul(optarg, NULL, 0); break;
+            default:
+                fprintf(stderr, "usage: %s [-n samples] [-p period]\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    if ((count == 0) || (test_period <= HOST_COST_CALL))
+    {
+        fprintf(stderr, "%s: at least one sample needed, and a period longer than a library call\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    host_plant_defaults();
+
+    printf("test,samples,errors,overruns,unpowered\n");
+    ok = test_capture(count) && ok;
+    ok = test_overrun(5) && ok;
+    ok = test_wrap(70000) && ok;
+    ok = test_stop() && ok;
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
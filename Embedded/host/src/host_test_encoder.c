@@ -0,0 +1,250 @@
+/* ============================================================================
+** Copyright (c) 2021 Infineon Technologies AG
+**               All rights reserved.
+**               www.infineon.com
+** ============================================================================
+**
+** ============================================================================
+** Redistribution and use of this software only permitted to the extent
+** expressly agreed with Infineon Technologies AG.
+** ============================================================================
+*
+*/
+
+/** @file     host_test_encoder.c
+ *  @brief    Test of the encoder pulse counting at high pulse rates in the host build
+ *
+ *  Pulse trains are fed through the emulated GPIO event unit: each pulse raises the event bus interrupt, which is
+ *  dispatched to encoder_irq() like the ROM handler does on the device. The count of the firmware (encoder_pulses)
+ *  must match the number of pulses fed.
+ *  The NVIC keeps a single pending bit per interrupt, so pulses get lost when two of them arrive while the interrupt
+ *  cannot be served. This is modelled by masking the interrupts periodically for the duration of the longest critical
+ *  section of the control loop (mask_ticks, by default one call of the ROM or NVM library, HOST_COST_CALL).
+ *
+ *  The trains are built for the maximum motor speed, the no-load speed at the open circuit voltage of the harvester,
+ *  times the factor given with -x:
+ *  - constant: pulses at the maximum rate
+ *  - jitter:   intervals varying by +-30% around the maximum rate, e.g. an unequal duty of the hall sensor
+ *  - ramp:     from standstill up to the maximum rate
+ *  - the recordings given on the command line: text files with the time of one pulse per line, in seconds
+ *
+ *  usage: smack_test_encoder [-x factor] [-n pulses] [-m mask_ticks] [-p mask_period_us] [-s seed] [pulses.txt ...]
+ *  The exit code is EXIT_FAILURE if a pulse has been lost in any train.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <unistd.h>
+
+// Smack stepwise project
+#include "settings.h"
+#include "encoder.h"
+
+// host build
+#include "host_sim.h"
+#include "host_plant.h"
+
+
+static uint32_t test_mask_ticks = HOST_COST_CALL;   // duration of the critical sections
+static uint64_t test_mask_period;                   // period of the critical sections, clock cycles
+static uint64_t test_mask_edge;                     // next start or end of a critical section
+static bool     test_masked;                        // in a critical section
+
+
+/** @brief Let time pass until a point in time, entering and leaving the critical sections on the way
+ *  @param until    simulated time in clock cycles
+ */
+static void test_advance_to(const uint64_t until)
+{
+    while (host_now < until)
+    {
+        if (host_now >= test_mask_edge)
+        {
+            test_masked = !test_masked;
+            host_irq_mask(test_masked);
+            test_mask_edge += test_masked ? test_mask_ticks : (test_mask_period - test_mask_ticks);
+            continue;
+        }
+        host_advance(((until < test_mask_edge) ? until : test_mask_edge) - host_now);
+    }
+}
+
+
+/** @brief Feed a pulse train to the firmware and check the count
+ *  @param name     name of the train for the report
+ *  @param times    time of each pulse in seconds, ascending
+ *  @param count    number of pulses
+ *  @return         true if all pulses have been counted
+ */
+static bool test_train(const char* const name, const double* const times, const uint32_t count)
+{
+    double min_interval = INFINITY;
+    uint64_t at;
+    uint32_t i;
+
+    host_plant_reset();
+    host_map_registers();
+    host_now = 0;
+    test_mask_edge = test_mask_period / 2;
+    test_masked = false;
+    encoder_init();
+
+    for (i = 0; i < count; i++)
+    {
+        if ((i != 0) && (times[i] - times[i - 1] < min_interval))
+        {
+            min_interval = times[i] - times[i - 1];
+        }
+        // the pulse is passed to the firmware at the end of the first plant step after it
+        at = (uint64_t)(times[i] * (HOST_TICKS_PER_SECOND));
+        test_advance_to((at > host_now) ? at - 1 : host_now);
+        host_plant_state.pulses++;
+        test_advance_to(host_now + 1);
+    }
+    test_advance_to(host_now + test_mask_period);
+    if (test_masked)
+    {
+        test_masked = false;
+        host_irq_mask(false);
+    }
+    encoder_close();
+
+    printf("%s,%lu,%lu,%lu,%.1f\n", name, (unsigned long)count, (unsigned long)encoder_pulses,
+           (unsigned long)(count - encoder_pulses), min_interval * 1e6);
+    return encoder_pulses == count;
+}
+
+
+/** @brief Load a recorded pulse train
+ *  @param path     text file, time of one pulse per line in seconds
+ *  @param count    returns the number of pulses
+ *  @return         times of the pulses (malloc()), NULL on error
+ */
+static double* test_load(const char* const path, uint32_t* const count)
+{
+    FILE* file = fopen(path, "r");
+    double* times = NULL;
+    double* grown;
+    uint32_t size = 0;
+    double t;
+
+    *count = 0;
+    if (file == NULL)
+    {
+        return NULL;
+    }
+    while (fscanf(file, "%lf", &t) == 1)
+    {
+        if ((*count != 0) && (t < times[*count - 1]))
+        {
+            break;
+        }
+        if (*count == size)
+        {
+            size = (size == 0) ? 1024 : 2 * size;
+            grown = realloc(times, size * sizeof(double));
+            if (grown == NULL)
+            {
+                break;
+            }
+            times = grown;
+        }
+        times[(*count)++] = t;
+    }
+    fclose(file);
+
+    return times;
+}
+
+
+int main(int argc, char* argv[])
+{
+    double factor = 1.0;
+    double mask_period_us = 1000.0;
+    uint32_t count = 20000;
+    unsigned seed = 1;
+    double rate, speed, t;
+    double* times;
+    uint32_t loaded;
+    uint32_t i;
+    bool ok = true;
+    int opt;
+
+    host_plant_defaults();
+    while ((opt = getopt(argc, argv, "x:n:m:p:s:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'x': factor = strtod(optarg, NULL); break;
+            case 'n': count = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'm': test_mask_ticks = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'p': mask_period_us = strtod(optarg, NULL); break;
+            case 's': seed = (unsigned)strtoul(optarg, NULL, 0); break;
+            default:
+                fprintf(stderr, "usage: %s [-x factor] [-n pulses] [-m mask_ticks] [-p mask_period_us] [-s seed] "
+                                "[pulses.txt ...]\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    test_mask_period = (uint64_t)(mask_period_us * 1e-6 * (HOST_TICKS_PER_SECOND));
+    if ((count < 2) || (test_mask_period <= test_mask_ticks))
+    {
+        fprintf(stderr, "%s: at least two pulses needed, and a mask period longer than the critical section\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    srand(seed);
+
+    // no-load speed: the back EMF equals the highest voltage VCCHB can reach
+    speed = host_plant_params.harvest_voc / host_plant_params.motor_k;
+    rate = factor * speed / (2.0 * M_PI) * host_plant_params.pulses_per_rev;
+
+    times = malloc(count * sizeof(double));
+    if (times == NULL)
+    {
+        return EXIT_FAILURE;
+    }
+    printf("# maximum rate %.0f pulses/s, critical section of %lu cycles every %.0fus\n", rate,
+           (unsigned long)test_mask_ticks, mask_period_us);
+    printf("train,pulses,counted,lost,min_interval_us\n");
+
+    for (i = 0; i < count; i++)
+    {
+        times[i] = (i + 1) / rate;
+    }
+    ok = test_train("constant", times, count) && ok;
+
+    for (i = 0, t = 0.0; i < count; i++)
+    {
+        t += (0.7 + 0.6 * rand() / (double)RAND_MAX) / rate;
+        times[i] = t;
+    }
+    ok = test_train("jitter", times, count) && ok;
+
+    // uniform acceleration reaching the maximum rate at the last pulse: pulse i at sqrt(i / count) * T
+    for (i = 0; i < count; i++)
+    {
+        times[i] = sqrt((i + 1) / (double)count) * 2.0 * count / rate;
+    }
+    ok = test_train("ramp", times, count) && ok;
+    free(times);
+
+    for (; optind < argc; optind++)
+    {
+        times = test_load(argv[optind], &loaded);
+        if ((times == NULL) || (loaded == 0))
+        {
+            fprintf(stderr, "%s: cannot load the pulse train\n", argv[optind]);
+            ok = false;
+        }
+        else
+        {
+            ok = test_train(argv[optind], times, loaded) && ok;
+        }
+        free(times);
+    }
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
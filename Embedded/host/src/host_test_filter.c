@@ -0,0 +1,382 @@
+/* ============================================================================
+** Copyright (c) 2021 Infineon Technologies AG
+**               All rights reserved.
+**               www.infineon.com
+** ============================================================================
+**
+** ============================================================================
+** Redistribution and use of this software only permitted to the extent
+** expressly agreed with Infineon Technologies AG.
+** ============================================================================
+*
+*/
+
+/** @file     host_test_filter.c
+ *  @brief    Test of the fixed point filters against hand computed results in the host build
+ *
+ *  Each filter is fed a short sequence whose results have been worked out by hand from the definition of the filter
+ *  (see filter.h), including the rounding:
+ *  - div, udiv:    rounding towards zero for all signs, the extremes of the range
+ *  - debounce:     changes of the state after exactly "limit" contradicting samples, limit 0 taken as 1
+ *  - median:       the upper median while the window fills, single spikes removed, the window sizes
+ *  - iir:          the rounding of the output, no dead band of the state, arithmetic shift of negative differences
+ *  - slope:        the window filling up and sliding, the wraparound of the timer, truncation of dt to 1/256ms,
+ *                  negative slopes, two samples at the same time
+ *
+ *  Both variants of filter.c are checked: the firmware one, which divides through calc_div() of the emulated ROM
+ *  library, and the host reference (FILTER_HOST_REFERENCE, C division operator), which is compiled a second time into
+ *  this file with the functions renamed to ref_filter_*().
+ *  The cycles taken by the filters on the device are not measured here, the host build only charges the library
+ *  calls; see the cycle profile of the NVM image (make profile) for the filters used by the control loop.
+ *
+ *  usage: smack_test_filter
+ *  The exit code is EXIT_FAILURE if a result differs from the expected one in any filter.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Smack stepwise project
+#include "settings.h"
+#include "filter.h"
+
+// host build
+#include "host_sim.h"
+#include "host_plant.h"
+
+// the reference variant of filter.c under other names; filter.h is not included again (include guard)
+#define FILTER_HOST_REFERENCE
+#define filter_div              ref_filter_div
+#define filter_udiv             ref_filter_udiv
+#define filter_debounce_init    ref_filter_debounce_init
+#define filter_debounce         ref_filter_debounce
+#define filter_median_init      ref_filter_median_init
+#define filter_median           ref_filter_median
+#define filter_iir_init         ref_filter_iir_init
+#define filter_iir              ref_filter_iir
+#define filter_slope_init       ref_filter_slope_init
+#define filter_slope            ref_filter_slope
+#include "../../src/filter.c"
+#undef filter_div
+#undef filter_udiv
+#undef filter_debounce_init
+#undef filter_debounce
+#undef filter_median_init
+#undef filter_median
+#undef filter_iir_init
+#undef filter_iir
+#undef filter_slope_init
+#undef filter_slope
+
+// system timer ticks per millisecond
+#define TEST_MS                 (WAIT_ABOUT_1MS)
+
+
+/** @brief Compare a result of both variants with the expected one
+ *  @param name     name of the filter
+ *  @param index    number of the case
+ *  @param fw       result of the firmware variant
+ *  @param ref      result of the host reference
+ *  @param expected hand computed result
+ *  @return         number of differing results (0...2)
+ */
+static uint32_t test_check(const char* const name, const uint32_t index, const int64_t fw, const int64_t ref,
+                           const int64_t expected)
+{
+    uint32_t failures = 0;
+
+    if (fw != expected)
+    {
+        fprintf(stderr, "%s: case %lu: firmware %lld, expected %lld\n", name, (unsigned long)index, (long long)fw,
+                (long long)expected);
+        failures++;
+    }
+    if (ref != expected)
+    {
+        fprintf(stderr, "%s: case %lu: reference %lld, expected %lld\n", name, (unsigned long)index, (long long)ref,
+                (long long)expected);
+        failures++;
+    }
+
+    return failures;
+}
+
+
+/** @brief Print a result line
+ *  @param name     name of the filter
+ *  @param cases    number of cases
+ *  @param failures number of differing results
+ *  @return         true if all results are as expected
+ */
+static bool test_report(const char* const name, const uint32_t cases, const uint32_t failures)
+{
+    printf("%s,%lu,%lu\n", name, (unsigned long)cases, (unsigned long)failures);
+    return failures == 0;
+}
+
+
+/** @brief Check filter_div() and filter_udiv()
+ *  @return         true if all results are as expected
+ */
+static bool test_div(void)
+{
+    static const struct { int32_t num, den, quotient; } sdiv[] =
+    {
+        { 7, 2, 3 },
+        { -7, 2, -3 },
+        { 7, -2, -3 },
+        { -7, -2, 3 },
+        { 0, 5, 0 },
+        { 1, 1000, 0 },
+        { -1000, 3, -333 },
+        { INT32_MAX, 1, INT32_MAX },
+        { INT32_MAX, -1, -INT32_MAX },
+        { INT32_MIN, 1, INT32_MIN },
+        { INT32_MIN, 2, -1073741824 },
+        { INT32_MIN, INT32_MAX, -1 },
+    };
+    static const struct { uint32_t num, den, quotient; } udiv[] =
+    {
+        { 7, 2, 3 },
+        { 5, 7, 0 },
+        { 0xffffffffUL, 1, 0xffffffffUL },
+        { 0xffffffffUL, 0x10000UL, 0xffff },
+        { 0x80000000UL, 3, 715827882UL },
+        { 0xfffffffeUL, 0xffffffffUL, 0 },
+    };
+    const uint32_t scount = sizeof(sdiv) / sizeof(sdiv[0]);
+    const uint32_t ucount = sizeof(udiv) / sizeof(udiv[0]);
+    uint32_t failures = 0;
+    uint32_t i;
+    bool ok;
+
+    for (i = 0; i < scount; i++)
+    {
+        failures += test_check("div", i, filter_div(sdiv[i].num, sdiv[i].den),
+                               ref_filter_div(sdiv[i].num, sdiv[i].den), sdiv[i].quotient);
+    }
+    ok = test_report("div", scount, failures);
+
+    failures = 0;
+    for (i = 0; i < ucount; i++)
+    {
+        failures += test_check("udiv", i, filter_udiv(udiv[i].num, udiv[i].den),
+                               ref_filter_udiv(udiv[i].num, udiv[i].den), udiv[i].quotient);
+    }
+
+    return test_report("udiv", ucount, failures) && ok;
+}
+
+
+/** @brief Check filter_debounce()
+ *  @return         true if all results are as expected
+ */
+static bool test_debounce(void)
+{
+    // limit 3, starting in the true state: single and double dips are ignored, the third one changes the state
+    static const bool in3[]  = { false, false, true, false, false, false, true, true, true };
+    static const bool out3[] = { true,  true,  true, true,  true,  false, false, false, true };
+    // limit 0 is taken as 1: each sample is passed through
+    static const bool in0[]  = { true, false, false, true };
+    const uint32_t count3 = sizeof(in3) / sizeof(in3[0]);
+    const uint32_t count0 = sizeof(in0) / sizeof(in0[0]);
+    filter_debounce_t fw, ref;
+    uint32_t failures = 0;
+    uint32_t i;
+
+    filter_debounce_init(&fw, true, 3);
+    ref_filter_debounce_init(&ref, true, 3);
+    for (i = 0; i < count3; i++)
+    {
+        failures += test_check("debounce", i, filter_debounce(&fw, in3[i]), ref_filter_debounce(&ref, in3[i]),
+                               out3[i]);
+    }
+
+    filter_debounce_init(&fw, false, 0);
+    ref_filter_debounce_init(&ref, false, 0);
+    for (i = 0; i < count0; i++)
+    {
+        failures += test_check("debounce", count3 + i, filter_debounce(&fw, in0[i]),
+                               ref_filter_debounce(&ref, in0[i]), in0[i]);
+    }
+
+    return test_report("debounce", count3 + count0, failures);
+}
+
+
+/** @brief Check filter_median()
+ *  @return         true if all results are as expected
+ */
+static bool test_median(void)
+{
+    // window 3: the upper median of two samples, then the median of the last three
+    static const uint16_t in3[]  = { 100, 300, 200, 900, 150, 150 };
+    static const uint16_t out3[] = { 100, 300, 200, 300, 200, 150 };
+    // window 4 is taken as 5: spikes of one and two samples are removed
+    static const uint16_t in5[]  = { 3000, 3000, 3000, 3000, 3000, 5000, 3010, 0, 0, 3020, 3020 };
+    static const uint16_t out5[] = { 3000, 3000, 3000, 3000, 3000, 3000, 3000, 3000, 3000, 3010, 3010 };
+    // window sizes as initialized: 0 -> 1, 4 -> 5, 9 -> FILTER_MEDIAN_MAX
+    static const uint8_t window[][2] = { { 0, 1 }, { 4, 5 }, { 9, FILTER_MEDIAN_MAX } };
+    const uint32_t count3 = sizeof(in3) / sizeof(in3[0]);
+    const uint32_t count5 = sizeof(in5) / sizeof(in5[0]);
+    const uint32_t windows = sizeof(window) / sizeof(window[0]);
+    filter_median_t fw, ref;
+    uint32_t failures = 0;
+    uint32_t i;
+
+    filter_median_init(&fw, 3);
+    ref_filter_median_init(&ref, 3);
+    for (i = 0; i < count3; i++)
+    {
+        failures += test_check("median", i, filter_median(&fw, in3[i]), ref_filter_median(&ref, in3[i]), out3[i]);
+    }
+
+    filter_median_init(&fw, 4);
+    ref_filter_median_init(&ref, 4);
+    for (i = 0; i < count5; i++)
+    {
+        failures += test_check("median", count3 + i, filter_median(&fw, in5[i]), ref_filter_median(&ref, in5[i]),
+                               out5[i]);
+    }
+
+    for (i = 0; i < windows; i++)
+    {
+        filter_median_init(&fw, window[i][0]);
+        ref_filter_median_init(&ref, window[i][0]);
+        failures += test_check("median", count3 + count5 + i, fw.window, ref.window, window[i][1]);
+    }
+
+    return test_report("median", count3 + count5 + windows, failures);
+}
+
+
+/** @brief Check filter_iir()
+ *  @return         true if all results are as expected
+ */
+static bool test_iir(void)
+{
+    static const struct
+    {
+        uint8_t  shift;
+        uint8_t  count;
+        uint16_t in[13];
+        uint16_t out[13];
+    } seq[] =
+    {
+        // the first sample initializes the output; 1250.0, 1437.5 (rounded up), 1578.1, 1183.6
+        { 2, 5, { 1000, 2000, 2000, 2000, 0 }, { 1000, 1250, 1438, 1578, 1184 } },
+        // no filtering
+        { 0, 3, { 500, 3000, 7 }, { 500, 3000, 7 } },
+        // a step of a single digit gets through: the state has 8 fractional bits, Q8 state 16, 31, 45, ... 135
+        { 4, 13, { 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1 }, { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1 } },
+        // falling: -256000 >> 3 = -32000, then -28000, i.e. 875.0 and 765.6
+        { 3, 3, { 1000, 0, 0 }, { 1000, 875, 766 } },
+    };
+    const uint32_t seqs = sizeof(seq) / sizeof(seq[0]);
+    filter_iir_t fw, ref;
+    uint32_t failures = 0;
+    uint32_t cases = 0;
+    uint32_t s, i;
+
+    for (s = 0; s < seqs; s++)
+    {
+        filter_iir_init(&fw, seq[s].shift);
+        ref_filter_iir_init(&ref, seq[s].shift);
+        for (i = 0; i < seq[s].count; i++, cases++)
+        {
+            failures += test_check("iir", cases, filter_iir(&fw, seq[s].in[i]), ref_filter_iir(&ref, seq[s].in[i]),
+                                   seq[s].out[i]);
+        }
+    }
+
+    return test_report("iir", cases, failures);
+}
+
+
+/** @brief Check filter_slope()
+ *  @return         true if all results are as expected
+ */
+static bool test_slope(void)
+{
+    // the timer wraps around at the third sample
+    static const uint32_t start = 0xffff0000UL;
+    // window 4, one sample per millisecond; dt in Q8 ms: 256, 512, then 768 when the window is full
+    static const struct { uint16_t in; uint32_t ms; int32_t slope; } seq[] =
+    {
+        { 1000, 0, 0 },         // single sample
+        { 1010, 1, 2560 },      // 10 * 65536 / 256
+        { 1030, 2, 3840 },      // 30 * 65536 / 512
+        { 1060, 3, 5120 },      // 60 * 65536 / 768
+        { 1100, 4, 7680 },      // 90 * 65536 / 768, from 1010
+        { 1040, 5, 853 },       // 10 * 65536 / 768 = 853.3, from 1030
+        { 900, 6, -13653 },     // -160 * 65536 / 768 = -13653.3, from 1060
+    };
+    const uint32_t count = sizeof(seq) / sizeof(seq[0]);
+    filter_slope_t fw, ref;
+    uint32_t failures = 0;
+    uint32_t i;
+
+    filter_slope_init(&fw, 4);
+    ref_filter_slope_init(&ref, 4);
+    for (i = 0; i < count; i++)
+    {
+        const uint32_t time = start + seq[i].ms * (TEST_MS);
+
+        failures += test_check("slope", i, filter_slope(&fw, seq[i].in, time), ref_filter_slope(&ref, seq[i].in, time),
+                               seq[i].slope);
+    }
+
+    // 1.5ms = 384 / 256ms: 3 * 65536 / 384 = 512, i.e. 2 digits per millisecond
+    filter_slope_init(&fw, 2);
+    ref_filter_slope_init(&ref, 2);
+    (void)filter_slope(&fw, 2000, 0);
+    (void)ref_filter_slope(&ref, 2000, 0);
+    failures += test_check("slope", count, filter_slope(&fw, 2003, 3 * (TEST_MS) / 2),
+                           ref_filter_slope(&ref, 2003, 3 * (TEST_MS) / 2), 512);
+
+    // two samples at the same time have no slope
+    filter_slope_init(&fw, 2);
+    ref_filter_slope_init(&ref, 2);
+    (void)filter_slope(&fw, 500, 1000);
+    (void)ref_filter_slope(&ref, 500, 1000);
+    failures += test_check("slope", count + 1, filter_slope(&fw, 600, 1000), ref_filter_slope(&ref, 600, 1000), 0);
+
+    // window sizes as initialized: 1 -> 2, 20 -> FILTER_SLOPE_MAX
+    filter_slope_init(&fw, 1);
+    ref_filter_slope_init(&ref, 1);
+    failures += test_check("slope", count + 2, fw.window, ref.window, 2);
+    filter_slope_init(&fw, 20);
+    ref_filter_slope_init(&ref, 20);
+    failures += test_check("slope", count + 3, fw.window, ref.window, FILTER_SLOPE_MAX);
+
+    return test_report("slope", count + 4, failures);
+}
+
+
+int main(int argc, char* argv[])
+{
+    bool ok = true;
+
+    if (argc > 1)
+    {
+        fprintf(stderr, "usage: %s\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    // calc_div() lets the simulated time pass, which steps the plant
+    host_plant_defaults();
+    host_plant_reset();
+    host_map_registers();
+    host_now = 0;
+
+    printf("filter,cases,failures\n");
+    ok = test_div() && ok;
+    ok = test_debounce() && ok;
+    ok = test_median() && ok;
+    ok = test_iir() && ok;
+    ok = test_slope() && ok;
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
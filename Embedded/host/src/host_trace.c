@@ -0,0 +1,230 @@
+/* ============================================================================
+** Copyright (c) 2021 Infineon Technologies AG
+**               All rights reserved.
+**               www.infineon.com
+** ============================================================================
+**
+** ============================================================================
+** Redistribution and use of this software only permitted to the extent
+** expressly agreed with Infineon Technologies AG.
+** ============================================================================
+*
+*/
+
+/** @file     host_trace.c
+ *  @brief    Recorded waveforms of VCCHB and the motor current
+ *
+ *  Loading of scope captures exported as CSV or as binary floats, and their linear interpolation at the simulated
+ *  time. See host_trace.h for the formats.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+// host build
+#include "host_trace.h"
+
+
+/** @brief Append a sample, growing the arrays as needed
+ *  @return false if out of memory
+ */
+static bool trace_append(host_trace_t* const trace, size_t* const capacity, const double time, const double vcchb,
+                         const double current)
+{
+    double* t;
+    double* v;
+    double* c;
+
+    if (trace->count == *capacity)
+    {
+        *capacity = (*capacity != 0) ? (*capacity * 2) : 4096;
+        t = realloc(trace->time, *capacity * sizeof(double));
+        v = (t != NULL) ? realloc(trace->vcchb, *capacity * sizeof(double)) : NULL;
+        c = (v != NULL) ? realloc(trace->current, *capacity * sizeof(double)) : NULL;
+        trace->time = (t != NULL) ? t : trace->time;
+        trace->vcchb = (v != NULL) ? v : trace->vcchb;
+        trace->current = (c != NULL) ? c : trace->current;
+        if (c == NULL)
+        {
+            return false;
+        }
+    }
+    trace->time[trace->count] = time;
+    trace->vcchb[trace->count] = vcchb;
+    trace->current[trace->count] = current;
+    trace->count++;
+
+    return true;
+}
+
+
+/** @brief Read the samples of a CSV file
+ */
+static bool trace_load_csv(host_trace_t* const trace, size_t* const capacity, FILE* const file)
+{
+    char line[512];
+    double value[3];
+    char* p;
+    char* end;
+    int n;
+
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        p = line;
+        while (isspace((unsigned char)*p))
+        {
+            p++;
+        }
+        if (!isdigit((unsigned char)*p) && (*p != '-') && (*p != '+') && (*p != '.'))
+        {
+            continue;
+        }
+        for (n = 0; n < 3; n++)
+        {
+            value[n] = strtod(p, &end);
+            if (end == p)
+            {
+                break;
+            }
+            p = end + strspn(end, ",; \t");
+        }
+        if (n < 2)
+        {
+            continue;
+        }
+        trace->has_current = trace->has_current || (n == 3);
+        if (!trace_append(trace, capacity, value[0], value[1], (n == 3) ? value[2] : 0.0))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+/** @brief Read the samples of a binary file
+ */
+static bool trace_load_bin(host_trace_t* const trace, size_t* const capacity, FILE* const file)
+{
+    uint8_t record[12];
+    float value[3];
+    int n;
+
+    while (fread(record, sizeof(record), 1, file) == 1)
+    {
+        for (n = 0; n < 3; n++)
+        {
+            const uint32_t bits = (uint32_t)record[4 * n] | ((uint32_t)record[4 * n + 1] << 8) |
+                                  ((uint32_t)record[4 * n + 2] << 16) | ((uint32_t)record[4 * n + 3] << 24);
+
+            memcpy(&value[n], &bits, sizeof(float));
+        }
+        if (!trace_append(trace, capacity, value[0], value[1], value[2]))
+        {
+            return false;
+        }
+    }
+    trace->has_current = true;
+
+    return true;
+}
+
+
+bool host_trace_load(host_trace_t* const trace, const char* const path)
+{
+    const size_t length = strlen(path);
+    const bool binary = (length >= 4) && (strcmp(path + length - 4, ".bin") == 0);
+    FILE* const file = fopen(path, binary ? "rb" : "r");
+    size_t capacity = 0;
+    bool ok;
+    size_t i;
+
+    memset(trace, 0, sizeof(*trace));
+    if (file == NULL)
+    {
+        return false;
+    }
+    ok = binary ? trace_load_bin(trace, &capacity, file) : trace_load_csv(trace, &capacity, file);
+    fclose(file);
+
+    // time relative to the first sample; samples going back in time are dropped
+    if (ok && (trace->count != 0))
+    {
+        const double start = trace->time[0];
+        size_t kept = 0;
+
+        for (i = 0; i < trace->count; i++)
+        {
+            if ((kept == 0) || ((trace->time[i] - start) > trace->time[kept - 1]))
+            {
+                trace->time[kept] = trace->time[i] - start;
+                trace->vcchb[kept] = trace->vcchb[i];
+                trace->current[kept] = trace->current[i];
+                kept++;
+            }
+        }
+        trace->count = kept;
+    }
+
+    return ok && (trace->count >= 2);
+}
+
+
+void host_trace_free(host_trace_t* const trace)
+{
+    free(trace->time);
+    free(trace->vcchb);
+    free(trace->current);
+    memset(trace, 0, sizeof(*trace));
+}
+
+
+double host_trace_duration(const host_trace_t* const trace)
+{
+    return (trace->count != 0) ? trace->time[trace->count - 1] : 0.0;
+}
+
+
+void host_trace_sample(const host_trace_t* const trace, const double time, double* const vcchb,
+                       double* const current)
+{
+    size_t lo = 0;
+    size_t hi = trace->count - 1;
+    size_t mid;
+    double f;
+
+    if (time <= trace->time[0])
+    {
+        hi = 0;
+    }
+    else if (time >= trace->time[hi])
+    {
+        lo = hi;
+    }
+    else
+    {
+        // time[lo] <= time < time[hi]
+        while ((hi - lo) > 1)
+        {
+            mid = (lo + hi) / 2;
+            if (trace->time[mid] <= time)
+            {
+                lo = mid;
+            }
+            else
+            {
+                hi = mid;
+            }
+        }
+    }
+
+    f = (hi != lo) ? ((time - trace->time[lo]) / (trace->time[hi] - trace->time[lo])) : 0.0;
+    *vcchb = trace->vcchb[lo] + (trace->vcchb[hi] - trace->vcchb[lo]) * f;
+    *current = trace->current[lo] + (trace->current[hi] - trace->current[lo]) * f;
+}
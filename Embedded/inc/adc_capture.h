@@ -0,0 +1,110 @@
+/* ============================================================================
+** Copyright (c) 2021 Infineon Technologies AG
+**               All rights reserved.
+**               www.infineon.com
+** ============================================================================
+**
+** ============================================================================
+** Redistribution and use of this software only permitted to the extent
+** expressly agreed with Infineon Technologies AG.
+** ============================================================================
+*
+*/
+
+/**
+ * @file     adc_capture.h
+ *
+ * @brief    Timer triggered capture of the VCCHB voltage and the motor current.
+ *
+ * @version  v1.0
+ * @date     2021-08-01
+ *
+ */
+
+#ifndef _ADC_CAPTURE_H_
+#define _ADC_CAPTURE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+
+/** @addtogroup Infineon
+ * @{
+ */
+
+/** @addtogroup Smack_stepwise
+ * @{
+ */
+
+/** @addtogroup adc_capture
+ * @{
+ */
+
+
+/** Registers of the sense unit. The register layout is the one used by sense_sh() of the ROM library; the generated
+ *  HAL headers are not part of this project. The host build models them as well (host_rom.c).
+ */
+#define SENSE_SH1_EVT_CFG   ((volatile uint32_t*)0x40000448UL)  // SH1 event configuration: irq number + enable
+#define SENSE_SH0_RESULT    ((volatile uint32_t*)0x40000430UL)  // SH0 conversion result
+#define SENSE_SH1_RESULT    ((volatile uint32_t*)0x40000450UL)  // SH1 conversion result
+#define SENSE_SH1_STATUS    ((volatile uint32_t*)0x40000454UL)  // SH1 status
+
+#define SENSE_EVT_IRQ_EN    0x400UL         // enable event (interrupt request) on conversion done
+#define SENSE_STATUS_DONE   0x20UL          // conversion result is valid
+#define SENSE_RESULT_MASK   0x1fffUL        // width of conversion result (13 bits)
+
+#define SCUC_MODULE_EN      ((volatile uint32_t*)0x20015008UL)  // clock enable of peripheral modules
+#define SCUC_MODULE_SENSE   0x40UL          // sense unit clock
+
+
+/**
+ * @brief one pair of conversion results as captured by the ADC interrupt
+ */
+typedef struct adc_sample_s
+{
+    uint16_t vcchb;     //!< VCCHB voltage (SH0), scaled to the comparator thresholds (ADC_CAPTURE_VCCHB_SCALE)
+    uint16_t current;   //!< motor current (SH1, I2V converter), raw ADC result
+    uint16_t seq;       //!< sequence number of the sample, incremented on every trigger; gaps indicate lost samples
+} adc_sample_t;
+
+
+/**
+ * @brief Configure the sense unit and start timer triggered conversions.
+ *        The system timer module must already be running (e.g. by sys_tim_cyclic_cascaded()).
+ *        Do not use the comparator (shc_compare()) while the capture is running, both share the analog routing.
+ * @param period    sample period in system timer ticks (16 bits)
+ */
+extern void adc_capture_start(const uint16_t period);
+
+/**
+ * @brief Stop the trigger timer and power down the sense unit. Samples still in the buffer may be read afterwards.
+ */
+extern void adc_capture_stop(void);
+
+/**
+ * @brief Fetch the oldest sample from the ring buffer.
+ * @param sample    destination of the sample
+ * @return          true: sample was copied, false: buffer empty
+ */
+extern bool adc_capture_read(adc_sample_t* sample);
+
+/**
+ * @brief Number of samples dropped because the buffer was full.
+ * @return          overrun count since adc_capture_start()
+ */
+extern uint32_t adc_capture_overruns(void);
+
+/**
+ * @brief Custom handler of the ADC interrupt, installed in the aparams (sense_adc_hand_addr).
+ *        Called by serve_adc_irq() of the ROM library.
+ */
+extern void adc_capture_irq(void);
+
+
+/** @} */ /* End of group adc_capture */
+
+/** @} */ /* End of group Smack_stepwise */
+
+/** @} */ /* End of group Infineon */
+
+#endif /* _ADC_CAPTURE_H_ */
@@ -0,0 +1,85 @@
+/* ============================================================================
+** Copyright (c) 2021 Infineon Technologies AG
+**               All rights reserved.
+**               www.infineon.com
+** ============================================================================
+**
+** ============================================================================
+** Redistribution and use of this software only permitted to the extent
+** expressly agreed with Infineon Technologies AG.
+** ============================================================================
+*
+*/
+
+/**
+ * @file     bemf_estimate.h
+ *
+ * @brief    Estimation of the motor movement while coasting from its back EMF.
+ *
+ * @version  v1.0
+ * @date     2021-08-01
+ *
+ */
+
+#ifndef _BEMF_ESTIMATE_H_
+#define _BEMF_ESTIMATE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "shc_lib.h"
+
+
+/** @addtogroup Infineon
+ * @{
+ */
+
+/** @addtogroup Smack_stepwise
+ * @{
+ */
+
+/** @addtogroup bemf_estimate
+ * @{
+ */
+
+
+/**
+ * @brief Initialize the estimation at the start of a movement.
+ * @param predicted  movement expected while coasting, until the first coasting phase has been measured (ticks)
+ * @param top        H bridge output connected to VCCHB while coasting (shc_channel_ma forward, shc_channel_mb backward)
+ */
+extern void bemf_init(const uint32_t predicted, const shc_channel_t top);
+
+/**
+ * @brief Movement expected in the next coasting phase, from the coasting phases measured so far.
+ * @return          movement in ticks of motor runtime at nominal speed
+ */
+extern uint32_t bemf_predicted(void);
+
+/**
+ * @brief Start measuring a coasting phase. To be called when the motor has been switched off; the top output must be
+ *        connected to VCCHB (top switch closed), the other output must be open.
+ * @param now       current time (system timer ticks)
+ */
+extern void bemf_start(const uint32_t now);
+
+/**
+ * @brief Sample the back EMF and integrate the movement.
+ * @param now       current time (system timer ticks)
+ * @return          true: motor is still coasting
+ */
+extern bool bemf_update(const uint32_t now);
+
+/**
+ * @brief End the measurement of a coasting phase.
+ * @return          measured minus predicted movement (ticks); to be added to the accumulated motor runtime
+ */
+extern int32_t bemf_finish(void);
+
+
+/** @} */ /* End of group bemf_estimate */
+
+/** @} */ /* End of group Smack_stepwise */
+
+/** @} */ /* End of group Infineon */
+
+#endif /* _BEMF_ESTIMATE_H_ */
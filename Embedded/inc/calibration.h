@@ -0,0 +1,102 @@
+/* ============================================================================
+** Copyright (c) 2021 Infineon Technologies AG
+**               All rights reserved.
+**               www.infineon.com
+** ============================================================================
+**
+** ============================================================================
+** Redistribution and use of this software only permitted to the extent
+** expressly agreed with Infineon Technologies AG.
+** ============================================================================
+*
+*/
+
+/**
+ * @file     calibration.h
+ *
+ * @brief    Calibration of the motor start correction from measured steps.
+ *
+ * @version  v1.0
+ * @date     2021-08-01
+ *
+ */
+
+#ifndef _CALIBRATION_H_
+#define _CALIBRATION_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "smack_stepwise.h"
+
+
+/** @addtogroup Infineon
+ * @{
+ */
+
+/** @addtogroup Smack_stepwise
+ * @{
+ */
+
+/** @addtogroup calibration
+ * @{
+ */
+
+
+/**
+ * @brief result of the last calibration
+ */
+typedef enum calibration_result_e
+{
+    calibration_result_none     = 0,   //!< no calibration performed since power up
+    calibration_result_ok       = 1,   //!< start correction calibrated and stored in NVM
+    calibration_result_charge   = 2,   //!< capacitor not charged in time, field too weak
+    calibration_result_fit      = 3,   //!< measured steps do not allow a fit, e.g. encoder not moving
+    calibration_result_nvm      = 4    //!< programming the NVM failed
+} calibration_result_t;
+
+/**
+ * @brief status of the last calibration, published as data points
+ */
+typedef struct calibration_status_s
+{
+    uint8_t  result;            //!< result of the calibration (calibration_result_t)
+    uint32_t correction;        //!< calibrated start correction in milliseconds
+} calibration_status_t;
+
+extern calibration_status_t calibration_status;
+
+
+/**
+ * @brief Start correction of a direction, calibrated if available.
+ * @param direction direction of the movement
+ * @param fallback  start correction to use if the direction has not been calibrated (milliseconds)
+ * @return          start correction in milliseconds
+ */
+extern uint32_t calibration_start_correction(const motion_dir_t direction, const uint32_t fallback);
+
+/**
+ * @brief Fit the start correction to measured steps by least squares.
+ *        The movement of a step is modelled as pulses = slope * (runtime + correction).
+ * @param runtime   motor runtime of the steps (milliseconds)
+ * @param pulses    encoder pulses of the steps, including coasting
+ * @param count     number of steps (2...CALIBRATION_STEPS)
+ * @param correction fitted start correction in milliseconds, not below 0
+ * @return          true: fit succeeded
+ */
+extern bool calibration_fit(const uint16_t* runtime, const uint16_t* pulses, const uint8_t count, uint32_t* correction);
+
+/**
+ * @brief Drive calibration steps of different lengths, fit the start correction and store it in NVM.
+ *        The result is reported in calibration_status.
+ * @param direction direction of the movement
+ */
+extern void calibration_run(const motion_dir_t direction);
+
+
+/** @} */ /* End of group calibration */
+
+/** @} */ /* End of group Smack_stepwise */
+
+/** @} */ /* End of group Infineon */
+
+#endif /* _CALIBRATION_H_ */
@@ -0,0 +1,63 @@
+/* ============================================================================
+** Copyright (c) 2021 Infineon Technologies AG
+**               All rights reserved.
+**               www.infineon.com
+** ============================================================================
+**
+** ============================================================================
+** Redistribution and use of this software only permitted to the extent
+** expressly agreed with Infineon Technologies AG.
+** ============================================================================
+*
+*/
+
+/**
+ * @file     clamp_ctrl.h
+ *
+ * @brief    Management of the clamping voltage of VCCHB during movements.
+ *
+ * @version  v1.0
+ * @date     2021-08-01
+ *
+ */
+
+#ifndef _CLAMP_CTRL_H_
+#define _CLAMP_CTRL_H_
+
+#include <stdint.h>
+
+
+/** @addtogroup Infineon
+ * @{
+ */
+
+/** @addtogroup Smack_stepwise
+ * @{
+ */
+
+/** @addtogroup clamp_ctrl
+ * @{
+ */
+
+
+/**
+ * @brief Raise the clamping voltage for a movement to the highest level allowed for the HB cap.
+ *        The current level is saved to be restored by clamp_ctrl_restore().
+ * @param voltage_on  VCCHB voltage to switch on the motor at the default clamping voltage (comparator threshold)
+ * @return            VCCHB voltage to switch on the motor at the raised clamping voltage (comparator threshold)
+ */
+extern uint16_t clamp_ctrl_raise(const uint16_t voltage_on);
+
+/**
+ * @brief Restore the clamping voltage saved by clamp_ctrl_raise(), e.g. for the NFC communication after a movement.
+ */
+extern void clamp_ctrl_restore(void);
+
+
+/** @} */ /* End of group clamp_ctrl */
+
+/** @} */ /* End of group Smack_stepwise */
+
+/** @} */ /* End of group Infineon */
+
+#endif /* _CLAMP_CTRL_H_ */
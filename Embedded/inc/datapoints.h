@@ -0,0 +1,96 @@
+/* ============================================================================
+** Copyright (c) 2021 Infineon Technologies AG
+**               All rights reserved.
+**               www.infineon.com
+** ============================================================================
+**
+** ============================================================================
+** Redistribution and use of this software only permitted to the extent
+** expressly agreed with Infineon Technologies AG.
+** ============================================================================
+*
+*/
+
+/**
+ * @file     datapoints.h
+ *
+ * @brief    Data points exchanged with the NFC reader.
+ *
+ * @version  v1.0
+ * @date     2021-08-01
+ *
+ */
+
+#ifndef _DATAPOINTS_H_
+#define _DATAPOINTS_H_
+
+#include <stdint.h>
+
+
+/** @addtogroup Infineon
+ * @{
+ */
+
+/** @addtogroup Smack_stepwise
+ * @{
+ */
+
+/** @addtogroup datapoints
+ * @{
+ */
+
+
+/** IDs of the data points. The IDs are grouped by the module providing the data.
+ */
+// firmware
+#define DP_FW_VERSION               0x0001  //!< array, version information (see Version_t in version.h)
+
+// stepwise motor operation (see smack_stepwise.h)
+#define DP_STEPWISE_END             0x0010  //!< uint8, reason why the last movement has ended (see stepwise_end_t)
+#define DP_STEPWISE_RUNTIME         0x0011  //!< uint32, accumulated motor runtime of the last movement in milliseconds
+#define DP_STEPWISE_PULSES          0x0012  //!< uint32, encoder pulses counted during the last movement
+#define DP_STEPWISE_DIRECTION       0x0013  //!< uint8, direction of the last movement (see motion_dir_t)
+
+// motion control (see smack_stepwise.h)
+#define DP_MOTION_COMMAND           0x0020  //!< uint8, write to start a movement (see motion_cmd_t)
+
+// calibration of the start correction (see calibration.h)
+#define DP_CALIBRATION_RESULT       0x0030  //!< uint8, result of the last calibration (see calibration_result_t)
+#define DP_CALIBRATION_CORRECTION   0x0031  //!< uint32, calibrated start correction in milliseconds
+
+// energy accounting (see energy_account.h)
+#define DP_ENERGY_STEP_HARVESTED    0x0040  //!< uint32, energy harvested during the last step in microjoules
+#define DP_ENERGY_STEP_MOTOR        0x0041  //!< uint32, motor energy of the last step in microjoules
+#define DP_ENERGY_HARVESTED         0x0042  //!< uint32, energy harvested during the last movement in microjoules
+#define DP_ENERGY_MOTOR             0x0043  //!< uint32, motor energy of the last movement in microjoules
+#define DP_ENERGY_LOSSES            0x0044  //!< uint32, energy lost during the last movement in microjoules
+#define DP_ENERGY_POWER             0x0045  //!< uint32, harvested power of the last charge phase in microwatts
+#define DP_ENERGY_EFFICIENCY        0x0046  //!< uint16, motor energy versus harvested energy in per mille
+
+// power domain manager (see power_domain.h)
+#define DP_POWER_OFF_MS             0x0050  //!< array of uint32, time each domain has been off in milliseconds
+#define DP_POWER_SAVED_UJ           0x0051  //!< array of uint32, energy saved by each domain in microjoules
+
+// field strength estimation (see field_estimate.h)
+#define DP_FIELD_RSSI               0x0100  //!< uint16, RSSI reading (raw)
+#define DP_FIELD_VDD_CA             0x0101  //!< uint16, rectified antenna voltage (raw)
+#define DP_FIELD_POWER              0x0102  //!< uint32, estimated harvested power in microwatts
+#define DP_FIELD_STEPS              0x0103  //!< uint16, predicted number of remaining steps
+#define DP_FIELD_TIME               0x0104  //!< uint32, predicted time to completion in milliseconds
+#define DP_FIELD_MODE               0x0105  //!< uint8, drive mode (see field_mode_t)
+
+
+/**
+ * @brief Register the data point table with the data exchange library.
+ *        smack_exchange_handler() is installed as app function 0 in the aparams.
+ */
+extern void datapoints_init(void);
+
+
+/** @} */ /* End of group datapoints */
+
+/** @} */ /* End of group Smack_stepwise */
+
+/** @} */ /* End of group Infineon */
+
+#endif /* _DATAPOINTS_H_ */
@@ -0,0 +1,72 @@
+/* ============================================================================
+** Copyright (c) 2021 Infineon Technologies AG
+**               All rights reserved.
+**               www.infineon.com
+** ============================================================================
+**
+** ============================================================================
+** Redistribution and use of this software only permitted to the extent
+** expressly agreed with Infineon Technologies AG.
+** ============================================================================
+*
+*/
+
+/**
+ * @file     encoder.h
+ *
+ * @brief    Counting of the pulses of a motor encoder through the GPIO event unit.
+ *
+ * @version  v1.0
+ * @date     2021-08-01
+ *
+ */
+
+#ifndef _ENCODER_H_
+#define _ENCODER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+
+/** @addtogroup Infineon
+ * @{
+ */
+
+/** @addtogroup Smack_stepwise
+ * @{
+ */
+
+/** @addtogroup encoder
+ * @{
+ */
+
+
+/**
+ * @brief Number of pulses counted since encoder_init(). Written by the interrupt only.
+ */
+extern volatile uint32_t encoder_pulses;
+
+/**
+ * @brief Configure the GPIO of the encoder as an input of the GPIO event unit, reset the counter and enable the
+ *        interrupt.
+ */
+extern void encoder_init(void);
+
+/**
+ * @brief Disable the interrupt of the encoder. The counter keeps its value.
+ */
+extern void encoder_close(void);
+
+/**
+ * @brief Interrupt handler of the GPIO event unit, installed in the aparams. Counts one pulse.
+ */
+extern void encoder_irq(void);
+
+
+/** @} */ /* End of group encoder */
+
+/** @} */ /* End of group Smack_stepwise */
+
+/** @} */ /* End of group Infineon */
+
+#endif /* _ENCODER_H_ */
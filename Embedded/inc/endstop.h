@@ -0,0 +1,75 @@
+/* ============================================================================
+** Copyright (c) 2021 Infineon Technologies AG
+**               All rights reserved.
+**               www.infineon.com
+** ============================================================================
+**
+** ============================================================================
+** Redistribution and use of this software only permitted to the extent
+** expressly agreed with Infineon Technologies AG.
+** ============================================================================
+*
+*/
+
+/**
+ * @file     endstop.h
+ *
+ * @brief    End stop switches on GPIOs, terminating the movement by interrupt.
+ *
+ * @version  v1.0
+ * @date     2021-08-01
+ *
+ */
+
+#ifndef _ENDSTOP_H_
+#define _ENDSTOP_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "smack_stepwise.h"
+
+
+/** @addtogroup Infineon
+ * @{
+ */
+
+/** @addtogroup Smack_stepwise
+ * @{
+ */
+
+/** @addtogroup endstop
+ * @{
+ */
+
+
+/**
+ * @brief Configure the GPIO of the end stop switch in the direction of the movement as an input and enable its
+ *        interrupt.
+ * @param direction direction of the movement
+ */
+extern void endstop_init(const motion_dir_t direction);
+
+/**
+ * @brief Disable the interrupt of the end stop switch.
+ */
+extern void endstop_close(void);
+
+/**
+ * @brief Check if the end stop has been reached, either reported by the interrupt or by the current level of the input.
+ * @return          true: end stop reached, the motor has been switched off
+ */
+extern bool endstop_reached(void);
+
+/**
+ * @brief Interrupt handler of the end stop GPIOs, installed in the aparams. Switches the motor off immediately.
+ */
+extern void endstop_irq(void);
+
+
+/** @} */ /* End of group endstop */
+
+/** @} */ /* End of group Smack_stepwise */
+
+/** @} */ /* End of group Infineon */
+
+#endif /* _ENDSTOP_H_ */
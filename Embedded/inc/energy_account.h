@@ -0,0 +1,93 @@
+/* ============================================================================
+** Copyright (c) 2021 Infineon Technologies AG
+**               All rights reserved.
+**               www.infineon.com
+** ============================================================================
+**
+** ============================================================================
+** Redistribution and use of this software only permitted to the extent
+** expressly agreed with Infineon Technologies AG.
+** ============================================================================
+*
+*/
+
+/**
+ * @file     energy_account.h
+ *
+ * @brief    Accounting of harvested and consumed energy per step and per movement.
+ *
+ * @version  v1.0
+ * @date     2021-08-01
+ *
+ */
+
+#ifndef _ENERGY_ACCOUNT_H_
+#define _ENERGY_ACCOUNT_H_
+
+#include <stdint.h>
+
+
+/** @addtogroup Infineon
+ * @{
+ */
+
+/** @addtogroup Smack_stepwise
+ * @{
+ */
+
+/** @addtogroup energy_account
+ * @{
+ */
+
+
+/**
+ * @brief energy balance of the last step and of the current (last) movement, published as data points
+ *        Energies in microjoules, power in microwatts.
+ */
+typedef struct energy_log_s
+{
+    uint32_t step_harvested;    //!< energy harvested during the last step (charge phase and motor on)
+    uint32_t step_motor;        //!< energy delivered to the motor during the last step
+    uint32_t harvested;         //!< energy harvested during the movement
+    uint32_t motor;             //!< energy delivered to the motor during the movement
+    uint32_t losses;            //!< harvested energy neither delivered to the motor nor left in the capacitor
+    uint32_t power;             //!< harvested power measured in the last charge phase
+    uint16_t efficiency;        //!< motor energy versus harvested energy, per mille
+} energy_log_t;
+
+extern energy_log_t energy_log;
+
+
+/**
+ * @brief Start the accounting of a movement. The HB cap is assumed to be empty.
+ */
+extern void energy_init(void);
+
+/**
+ * @brief Account a charge phase, when the motor is switched on.
+ * @param v_hi      VCCHB voltage at the end of the charge phase (scale of comparator thresholds)
+ * @param charge_ms duration of the charge phase in milliseconds, 0 if not measured (e.g. initial charge)
+ * @param clamp_ms  additional charge time with the capacitor at the clamping voltage, in milliseconds
+ */
+extern void energy_charged(const uint16_t v_hi, const uint32_t charge_ms, const uint32_t clamp_ms);
+
+/**
+ * @brief Account a motor on phase, when the motor is switched off.
+ * @param v_lo      VCCHB voltage at the end of the on phase (scale of comparator thresholds)
+ * @param on_ms     duration of the on phase in milliseconds
+ */
+extern void energy_discharged(const uint16_t v_lo, const uint32_t on_ms);
+
+/**
+ * @brief End the accounting of a movement: the losses and the efficiency are calculated.
+ */
+extern void energy_finish(void);
+
+
+/** @} */ /* End of group energy_account */
+
+/** @} */ /* End of group Smack_stepwise */
+
+/** @} */ /* End of group Infineon */
+
+#endif /* _ENERGY_ACCOUNT_H_ */
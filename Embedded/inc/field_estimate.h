@@ -0,0 +1,101 @@
+/* ============================================================================
+** Copyright (c) 2021 Infineon Technologies AG
+**               All rights reserved.
+**               www.infineon.com
+** ============================================================================
+**
+** ============================================================================
+** Redistribution and use of this software only permitted to the extent
+** expressly agreed with Infineon Technologies AG.
+** ============================================================================
+*
+*/
+
+/**
+ * @file     field_estimate.h
+ *
+ * @brief    Estimation of the harvested power and prediction of the time to complete a movement.
+ *
+ * @version  v1.0
+ * @date     2021-08-01
+ *
+ */
+
+#ifndef _FIELD_ESTIMATE_H_
+#define _FIELD_ESTIMATE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "smack_stepwise.h"
+
+
+/** @addtogroup Infineon
+ * @{
+ */
+
+/** @addtogroup Smack_stepwise
+ * @{
+ */
+
+/** @addtogroup field_estimate
+ * @{
+ */
+
+
+/**
+ * @brief drive mode selected from the harvested power
+ */
+typedef enum field_mode_e
+{
+    field_mode_bang_bang  = 0,  //!< charge to "on" voltage, run motor until "off" voltage
+    field_mode_continuous = 1   //!< restart the motor as soon as the voltage has recovered a bit
+} field_mode_t;
+
+/**
+ * @brief prediction of the movement, published as data points
+ */
+typedef struct field_prediction_s
+{
+    uint16_t rssi;          //!< most recent RSSI reading (raw)
+    uint16_t vdd_ca;        //!< most recent reading of the rectified antenna voltage (raw)
+    uint32_t power;         //!< estimated harvested power in microwatts
+    uint16_t steps;         //!< predicted number of remaining steps
+    uint32_t time;          //!< predicted time to completion in milliseconds
+    uint8_t  mode;          //!< selected drive mode (field_mode_t)
+} field_prediction_t;
+
+extern field_prediction_t field_prediction;
+
+
+/**
+ * @brief Sample the field at the start of a movement and make a first prediction.
+ *        Uses the sense unit, so the comparator must not be active (call before shc_init()).
+ * @param params    parameters of the movement
+ */
+extern void field_estimate_init(const stepwise_params_t* params);
+
+/**
+ * @brief Update the estimation with a measured charge phase and the current RSSI.
+ * @param params    parameters of the movement
+ * @param v_lo      VCCHB voltage at the start of the charge phase (scale of comparator thresholds)
+ * @param v_hi      VCCHB voltage at the end of the charge phase (scale of comparator thresholds)
+ * @param charge_ms duration of the charge phase in milliseconds
+ * @param remaining motor runtime still needed to complete the movement in milliseconds
+ */
+extern void field_estimate_charged(const stepwise_params_t* params, const uint16_t v_lo, const uint16_t v_hi,
+                                   const uint32_t charge_ms, const uint32_t remaining);
+
+/**
+ * @brief Drive mode recommended by the estimation.
+ * @return          true: continuous drive, false: bang-bang operation with full charge cycles
+ */
+extern bool field_estimate_continuous(void);
+
+
+/** @} */ /* End of group field_estimate */
+
+/** @} */ /* End of group Smack_stepwise */
+
+/** @} */ /* End of group Infineon */
+
+#endif /* _FIELD_ESTIMATE_H_ */
@@ -0,0 +1,179 @@
+/* ============================================================================
+** Copyright (c) 2021 Infineon Technologies AG
+**               All rights reserved.
+**               www.infineon.com
+** ============================================================================
+**
+** ============================================================================
+** Redistribution and use of this software only permitted to the extent
+** expressly agreed with Infineon Technologies AG.
+** ============================================================================
+*
+*/
+
+/**
+ * @file     filter.h
+ *
+ * @brief    Fixed point filters for comparator decisions and ADC readings.
+ *
+ * @version  v1.0
+ * @date     2021-08-01
+ *
+ */
+
+#ifndef _FILTER_H_
+#define _FILTER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+
+/** @addtogroup Infineon
+ * @{
+ */
+
+/** @addtogroup Smack_stepwise
+ * @{
+ */
+
+/** @addtogroup filter
+ * @{
+ */
+
+
+// maximum window of the moving median
+#define FILTER_MEDIAN_MAX   7
+
+// maximum window of the slope estimation
+#define FILTER_SLOPE_MAX    8
+
+
+/**
+ * @brief state of a debounced binary decision
+ */
+typedef struct filter_debounce_s
+{
+    bool    state;      //!< debounced state
+    uint8_t count;      //!< number of consecutive samples contradicting the debounced state
+    uint8_t limit;      //!< number of consecutive samples needed to change the state
+} filter_debounce_t;
+
+/**
+ * @brief state of a moving median
+ */
+typedef struct filter_median_s
+{
+    uint16_t buf[FILTER_MEDIAN_MAX];    //!< most recent samples (circular)
+    uint8_t  window;                    //!< window size (odd, 1...FILTER_MEDIAN_MAX)
+    uint8_t  fill;                      //!< number of valid samples in buffer
+    uint8_t  idx;                       //!< next position to write
+} filter_median_t;
+
+/**
+ * @brief state of a first order IIR low pass: y += (x - y) / 2^shift
+ */
+typedef struct filter_iir_s
+{
+    int32_t y;          //!< filter output (Q8)
+    uint8_t shift;      //!< filter coefficient as power of 2
+    bool    valid;      //!< output initialized
+} filter_iir_t;
+
+/**
+ * @brief state of a slope estimation over a window of samples
+ */
+typedef struct filter_slope_s
+{
+    uint16_t value[FILTER_SLOPE_MAX];   //!< most recent samples (circular)
+    uint32_t time[FILTER_SLOPE_MAX];    //!< timestamps of the samples (system timer ticks)
+    uint8_t  window;                    //!< window size (2...FILTER_SLOPE_MAX)
+    uint8_t  fill;                      //!< number of valid samples in buffer
+    uint8_t  idx;                       //!< next position to write
+} filter_slope_t;
+
+
+/**
+ * @brief Divide through the hardware divider (calc_div()) - the Cortex-M0 has no divide instruction.
+ *        Quotient is rounded towards zero, as the C operator.
+ * @param num       dividend
+ * @param den       divisor (must not be 0)
+ * @return          num / den
+ */
+extern int32_t filter_div(const int32_t num, const int32_t den);
+
+/**
+ * @brief Unsigned variant of filter_div().
+ */
+extern uint32_t filter_udiv(const uint32_t num, const uint32_t den);
+
+/**
+ * @brief Initialize debounce filter.
+ * @param f         filter state
+ * @param state     initial state
+ * @param limit     number of consecutive samples needed to change the state (1: no debouncing)
+ */
+extern void filter_debounce_init(filter_debounce_t* f, const bool state, const uint8_t limit);
+
+/**
+ * @brief Feed a sample into debounce filter.
+ * @param f         filter state
+ * @param in        raw decision
+ * @return          debounced decision
+ */
+extern bool filter_debounce(filter_debounce_t* f, const bool in);
+
+/**
+ * @brief Initialize moving median.
+ * @param f         filter state
+ * @param window    window size; even sizes are increased by one, limited to FILTER_MEDIAN_MAX
+ */
+extern void filter_median_init(filter_median_t* f, const uint8_t window);
+
+/**
+ * @brief Feed a sample into moving median.
+ *        Until the window is filled, the median of the samples received so far is returned.
+ * @param f         filter state
+ * @param in        sample
+ * @return          median of the window
+ */
+extern uint16_t filter_median(filter_median_t* f, const uint16_t in);
+
+/**
+ * @brief Initialize IIR low pass.
+ * @param f         filter state
+ * @param shift     filter coefficient 1/2^shift (0: no filtering)
+ */
+extern void filter_iir_init(filter_iir_t* f, const uint8_t shift);
+
+/**
+ * @brief Feed a sample into IIR low pass. The first sample initializes the output.
+ * @param f         filter state
+ * @param in        sample
+ * @return          filter output
+ */
+extern uint16_t filter_iir(filter_iir_t* f, const uint16_t in);
+
+/**
+ * @brief Initialize slope estimation.
+ * @param f         filter state
+ * @param window    number of samples between first and last point of the slope (2...FILTER_SLOPE_MAX)
+ */
+extern void filter_slope_init(filter_slope_t* f, const uint8_t window);
+
+/**
+ * @brief Feed a sample into slope estimation.
+ * @param f         filter state
+ * @param in        sample
+ * @param time      timestamp of sample (system timer ticks, free running)
+ * @return          slope over the window in digits per millisecond (Q8); 0 until two samples are available
+ */
+extern int32_t filter_slope(filter_slope_t* f, const uint16_t in, const uint32_t time);
+
+
+/** @} */ /* End of group filter */
+
+/** @} */ /* End of group Smack_stepwise */
+
+/** @} */ /* End of group Infineon */
+
+#endif /* _FILTER_H_ */
@@ -0,0 +1,94 @@
+/* ============================================================================
+** Copyright (c) 2021 Infineon Technologies AG
+**               All rights reserved.
+**               www.infineon.com
+** ============================================================================
+**
+** ============================================================================
+** Redistribution and use of this software only permitted to the extent
+** expressly agreed with Infineon Technologies AG.
+** ============================================================================
+*
+*/
+
+/**
+ * @file     hb_switch.h
+ *
+ * @brief    Switching of the H bridge transistors by direct register access.
+ *
+ * set_hb_switch() of the ROM library is called through the jump table (rom_func_table), which costs a load of the
+ * function pointer, the marshalling of four arguments and the call, for a single store to the switch register. The
+ * control loop switches the H bridge at every step, and the software PWM of the motion profile twice per period.
+ * With HB_DIRECT_ENABLE, hb_switch() writes the register inline instead. It writes the same value as the ROM
+ * function: a high side switch takes precedence over the low side switch of its half bridge, and the H bridge is put
+ * into direct CPU control (event bus ignored).
+ *
+ * @version  v1.0
+ * @date     2021-08-01
+ *
+ */
+
+#ifndef _HB_SWITCH_H_
+#define _HB_SWITCH_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Smack ROM lib
+#include "rom_lib.h"
+#include "hal_api.h"
+
+// Smack stepwise project
+#include "settings.h"
+
+
+/** @addtogroup Infineon
+ * @{
+ */
+
+/** @addtogroup Smack_stepwise
+ * @{
+ */
+
+/** @addtogroup hb_switch
+ * @{
+ */
+
+
+/** Switch register of the H bridge. The layout is the one written by set_hb_switch() and set_hb_eventctrl() of the
+ *  ROM library; the generated HAL headers are not part of this project.
+ */
+#define HB_SWITCH_REG       ((volatile uint32_t*)0x40000004UL)
+#define HB_SWITCH_EVENTCTRL 0x01UL          // switches controlled by the event bus, not by the bits below
+#define HB_SWITCH_HS1       0x02UL          // gate enable of HS1
+#define HB_SWITCH_HS2       0x04UL          // gate enable of HS2
+#define HB_SWITCH_LS1       0x08UL          // gate enable of LS1
+#define HB_SWITCH_LS2       0x10UL          // gate enable of LS2
+
+
+/**
+ * @brief Switch the four transistors of the H bridge, like set_hb_switch(). A high side switch which is set opens
+ *        the low side switch of the same half bridge.
+ * @param hs1_set   if true, HS1 is on
+ * @param ls1_set   if true, LS1 is on
+ * @param hs2_set   if true, HS2 is on
+ * @param ls2_set   if true, LS2 is on
+ */
+HAL_INLINE void hb_switch(const bool hs1_set, const bool ls1_set, const bool hs2_set, const bool ls2_set)
+{
+#if defined HB_DIRECT_ENABLE && HB_DIRECT_ENABLE
+    HAL_SET32(HB_SWITCH_REG, (hs1_set ? HB_SWITCH_HS1 : (ls1_set ? HB_SWITCH_LS1 : 0UL)) |
+                             (hs2_set ? HB_SWITCH_HS2 : (ls2_set ? HB_SWITCH_LS2 : 0UL)));
+#else
+    set_hb_switch(hs1_set, ls1_set, hs2_set, ls2_set);
+#endif
+}
+
+
+/** @} */ /* End of group hb_switch */
+
+/** @} */ /* End of group Smack_stepwise */
+
+/** @} */ /* End of group Infineon */
+
+#endif /* _HB_SWITCH_H_ */
@@ -0,0 +1,72 @@
+/* ============================================================================
+** Copyright (c) 2021 Infineon Technologies AG
+**               All rights reserved.
+**               www.infineon.com
+** ============================================================================
+**
+** ============================================================================
+** Redistribution and use of this software only permitted to the extent
+** expressly agreed with Infineon Technologies AG.
+** ============================================================================
+*
+*/
+
+/**
+ * @file     low_power.h
+ *
+ * @brief    Power saving mode during long charge phases.
+ *
+ * @version  v1.0
+ * @date     2021-08-01
+ *
+ */
+
+#ifndef _LOW_POWER_H_
+#define _LOW_POWER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "smack_stepwise.h"
+
+
+/** @addtogroup Infineon
+ * @{
+ */
+
+/** @addtogroup Smack_stepwise
+ * @{
+ */
+
+/** @addtogroup low_power
+ * @{
+ */
+
+
+/**
+ * @brief Enter the power saving mode, woken up by the standby timer.
+ *        The movement in progress is recorded first, so that it can be continued if the wake up goes through a reset
+ *        (see low_power_resume()). The H bridge and the comparator have to be set up again afterwards.
+ * @param ms        time to sleep in milliseconds
+ * @param direction direction of the movement in progress
+ * @param runtime   motor runtime of the movement done so far, milliseconds
+ * @return          time slept in milliseconds, measured by the standby timer
+ */
+extern uint32_t low_power_sleep(const uint32_t ms, const motion_dir_t direction, const uint32_t runtime);
+
+/**
+ * @brief Check for a movement interrupted by the power saving mode, to be called once after start up.
+ *        The record is cleared, so a movement is continued only once.
+ * @param direction direction of the interrupted movement
+ * @param runtime   motor runtime done before the interruption, milliseconds
+ * @return          true: a movement has to be continued
+ */
+extern bool low_power_resume(motion_dir_t* direction, uint32_t* runtime);
+
+
+/** @} */ /* End of group low_power */
+
+/** @} */ /* End of group Smack_stepwise */
+
+/** @} */ /* End of group Infineon */
+
+#endif /* _LOW_POWER_H_ */
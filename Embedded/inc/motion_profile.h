@@ -0,0 +1,137 @@
+/* ============================================================================
+** Copyright (c) 2021 Infineon Technologies AG
+**               All rights reserved.
+**               www.infineon.com
+** ============================================================================
+**
+** ============================================================================
+** Redistribution and use of this software only permitted to the extent
+** expressly agreed with Infineon Technologies AG.
+** ============================================================================
+*
+*/
+
+/**
+ * @file     motion_profile.h
+ *
+ * @brief    Motion profiles made of segments (ramp, cruise, dwell) with software PWM.
+ *
+ * @version  v1.0
+ * @date     2021-08-01
+ *
+ */
+
+#ifndef _MOTION_PROFILE_H_
+#define _MOTION_PROFILE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+
+/** @addtogroup Infineon
+ * @{
+ */
+
+/** @addtogroup Smack_stepwise
+ * @{
+ */
+
+/** @addtogroup motion_profile
+ * @{
+ */
+
+
+/**
+ * @brief conditions ending a segment before its duration has passed (flags)
+ */
+typedef enum motion_stop_e
+{
+    motion_stop_none   = 0x00,  //!< segment ends after its duration
+    motion_stop_stall  = 0x01,  //!< segment ends when the motor stalls (needs STALL_DETECT_ENABLE)
+    motion_stop_pulses = 0x02   //!< segment ends after its number of encoder pulses (needs ENCODER_ENABLE)
+} motion_stop_t;
+
+/**
+ * @brief one segment of a motion profile
+ *        With duty_from and duty_to both 0, the segment is a dwell: the motor stays off for the duration.
+ *        Otherwise, the duty is ramped linearly from duty_from to duty_to over the duration; equal values give a
+ *        cruise segment.
+ */
+typedef struct motion_segment_s
+{
+    uint8_t  duty_from;         //!< duty at the start of the segment, percent
+    uint8_t  duty_to;           //!< duty at the end of the segment, percent
+    uint8_t  stop;              //!< conditions ending the segment early (motion_stop_t flags)
+    uint16_t duration;          //!< motor runtime at full duty (drive) or time (dwell), milliseconds
+    uint16_t pulses;            //!< encoder pulses of the segment (with motion_stop_pulses)
+} motion_segment_t;
+
+
+/**
+ * @brief Start executing a profile.
+ * @param segments  segments of the profile
+ * @param count     number of segments
+ * @param pulses    encoder pulses counted so far
+ */
+extern void motion_profile_start(const motion_segment_t* segments, const uint8_t count, const uint32_t pulses);
+
+/**
+ * @brief Check if all segments have been executed.
+ * @return          true: profile done
+ */
+extern bool motion_profile_done(void);
+
+/**
+ * @brief Check if the current segment is a dwell.
+ * @return          true: the motor shall be off
+ */
+extern bool motion_profile_dwell(void);
+
+/**
+ * @brief Duty of the motor at the current position within the current segment.
+ * @return          duty in percent, 0 in a dwell or after the last segment
+ */
+extern uint8_t motion_profile_duty(void);
+
+/**
+ * @brief Advance the current drive segment; continues with the next segment when done.
+ * @param ticks     motor runtime at full duty since the last call (system timer ticks)
+ * @param pulses    encoder pulses counted so far
+ */
+extern void motion_profile_advance(const uint32_t ticks, const uint32_t pulses);
+
+/**
+ * @brief Let time pass in the current dwell segment; continues with the next segment when done.
+ * @param now       current time (system timer ticks)
+ * @param pulses    encoder pulses counted so far
+ * @return          true: still in the dwell
+ */
+extern bool motion_profile_wait(const uint32_t now, const uint32_t pulses);
+
+/**
+ * @brief Report a stall of the motor. If the current segment ends on a stall, the profile continues with the next
+ *        segment.
+ * @param pulses    encoder pulses counted so far
+ * @return          true: the stall has been handled by the profile, false: the stall ends the movement
+ */
+extern bool motion_profile_stall(const uint32_t pulses);
+
+/**
+ * @brief Drive the motor with software PWM for a period of time. Each PWM period ends with the motor switched on.
+ *        The motor is not switched on again once the stop condition is met, e.g. after the end stop interrupt has
+ *        switched it off; the function returns right away then.
+ * @param duty      duty in percent; 100 keeps the motor on, 0 keeps it off
+ * @param forward   direction of the movement: true forward (HS1 + LS2), false backward (HS2 + LS1)
+ * @param duration  time to drive the motor (system timer ticks)
+ * @param stop      stop condition checked before the motor is switched on, e.g. endstop_reached(); NULL: none
+ */
+extern void motion_pwm(const uint8_t duty, const bool forward, const uint32_t duration, bool (*stop)(void));
+
+
+/** @} */ /* End of group motion_profile */
+
+/** @} */ /* End of group Smack_stepwise */
+
+/** @} */ /* End of group Infineon */
+
+#endif /* _MOTION_PROFILE_H_ */
@@ -0,0 +1,98 @@
+/* ============================================================================
+** Copyright (c) 2021 Infineon Technologies AG
+**               All rights reserved.
+**               www.infineon.com
+** ============================================================================
+**
+** ============================================================================
+** Redistribution and use of this software only permitted to the extent
+** expressly agreed with Infineon Technologies AG.
+** ============================================================================
+*
+*/
+
+/**
+ * @file     power_domain.h
+ *
+ * @brief    Reference counted switching of the peripheral blocks.
+ *
+ * @version  v1.0
+ * @date     2021-08-01
+ *
+ */
+
+#ifndef _POWER_DOMAIN_H_
+#define _POWER_DOMAIN_H_
+
+#include <stdint.h>
+
+
+/** @addtogroup Infineon
+ * @{
+ */
+
+/** @addtogroup Smack_stepwise
+ * @{
+ */
+
+/** @addtogroup power_domain
+ * @{
+ */
+
+
+/**
+ * @brief peripheral blocks which can be switched off
+ */
+typedef enum power_domain_e
+{
+    power_domain_nvm        = 0,    //!< NVM (switch_on_nvm_lib()/switch_off_nvm_lib()); held while code is executed from it
+    power_domain_sense      = 1,    //!< sense unit (switch_on_sense()/switch_off_sense())
+    power_domain_comparator = 2,    //!< comparator of the NVM library (shc_init()/shc_close()); holds the sense unit
+    power_domain_timer      = 3,    //!< system timer block, started by the timer functions (sys_tim_close())
+    power_domain_count      = 4     //!< number of domains
+} power_domain_t;
+
+/**
+ * @brief savings of the power domain manager since power up, published as data points
+ */
+typedef struct power_log_s
+{
+    uint32_t off_ms[power_domain_count];    //!< time each domain has been switched off during movements, milliseconds
+    uint32_t saved_uj[power_domain_count];  //!< energy saved by each domain (off time and POWER_DOMAIN_UW), microjoules
+} power_log_t;
+
+extern power_log_t power_log;
+
+
+/**
+ * @brief Initialize the manager. The NVM is acquired, as the firmware is executed from it, the other blocks are
+ *        switched off.
+ */
+extern void power_init(void);
+
+/**
+ * @brief Request a domain; it is switched on if it is off.
+ * @param domain    domain to use
+ */
+extern void power_acquire(const power_domain_t domain);
+
+/**
+ * @brief Release a domain. It is switched off by the next power_minimal() if no one else uses it.
+ * @param domain    domain no longer used
+ */
+extern void power_release(const power_domain_t domain);
+
+/**
+ * @brief Switch off all domains not in use, e.g. before each motor on phase.
+ *        Domains in an unknown state, as left by the ROM, are switched off as well.
+ */
+extern void power_minimal(void);
+
+
+/** @} */ /* End of group power_domain */
+
+/** @} */ /* End of group Smack_stepwise */
+
+/** @} */ /* End of group Infineon */
+
+#endif /* _POWER_DOMAIN_H_ */
@@ -12,6 +12,20 @@
 //=================================================================
 // Global definitions
 
+// conversion of milliseconds into system timer ticks (system timer is clocked by the CPU clock)
+//#undef wait_about_1ms
+//#define wait_about_1ms  (XTAL / 1000U)          // calculated from oscillator; more exact than rough estimate
+#define ms2ticks(ms)    ((ms) * WAIT_ABOUT_1MS)
+
+// The functions which drive the motor are using timers in a different manner to estimate if the operation is completed.
+// The system timer channels used by the application are allocated here, so that the modules do not collide.
+#define TIMER_SINGLE        1       // timer # used for single shot delays
+#define TIMER_ADC_TRIGGER   2       // timer # used to trigger the sample & hold stages of the ADC (see ADC_CAPTURE_ENABLE)
+#define TIMER_CLOCK         5       // timer # configured together with the preceeding timer as a free running 32 bit timer to be used for timing measurements
+
+// interrupt number used in system timer calls
+#define SYSTIM_IRQ          9
+
 
 //=================================================================
 // test cases
@@ -62,6 +76,15 @@
 // remark: currently only supported with voltage controlled method
 #define MOTOR_START_CORRECTION  10
 
+// The values above apply to the forward direction (HS1 + LS2). Moving backward (HS2 + LS1) may need different values,
+// e.g. if the mechanism is loaded by a spring in one direction.
+#define TOTAL_MOTOR_RUNTIME_BACKWARD    2000
+#define MOTOR_START_CORRECTION_BACKWARD 10
+
+// movement to perform after power up: motion_cmd_forward, motion_cmd_backward, or motion_cmd_none to wait for a
+// command from the NFC reader (data point DP_MOTION_COMMAND)
+#define MOTION_STARTUP_COMMAND  motion_cmd_forward
+
 
 //-----------------------------------------------------------------
 // Settings for voltage controlled operations
@@ -74,11 +97,337 @@
 // set to 0 to disable this option
 #define DELAY_ADDITIONAL_CHARGE 50
 
+// period of the control loop in milliseconds: VCCHB is polled and the motor runtime is checked at this rate
+#define POLL_PERIOD             10
+
 // specify voltage levels in millivolts (add about 2% or 3% for a better match of the prescaler, and calculate a safety margin for tolerances)
 // clamping voltage is 3.3V
 #define VOLTAGE_ON              3100
 #define VOLTAGE_OFF             2200
 
+// The clamping voltage may be raised during movements to store more energy in the HB cap (see clamp_ctrl.c), and
+// VOLTAGE_ON is raised by the same amount. The clamping voltage is restored after the movement.
+// set to 0 to keep the clamping voltage
+#define VCLAMP_ENABLE           0
+
+// clamping voltage of the levels 0, 1, 2 of vclamp_set() in millivolts (example values, check the data sheet)
+#define VCLAMP_LEVELS           3300, 3600, 3900
+
+// highest clamping voltage allowed for the HB cap (its rated voltage minus a safety margin) in millivolts
+#define VCLAMP_CAP_MAX          3600
+
+// filtering of the VCCHB readings (see filter.h):
+// window of the moving median applied to each reading; set to 1 to disable
+#define FILTER_VCCHB_MEDIAN     3
+// number of consecutive readings below VOLTAGE_OFF needed to switch off the motor, e.g. to ignore the voltage dip
+// caused by the inrush current of the motor; set to 1 to disable
+#define FILTER_OFF_DEBOUNCE     1
+
+
+//-----------------------------------------------------------------
+// Settings for timer triggered ADC capture
+
+// Instead of polling the comparator every POLL_PERIOD, a system timer channel triggers both sample & hold stages of the
+// ADC at a fixed rate. The ADC interrupt stores the results in a ring buffer which is read by the motor control loop.
+// SH0 samples the VCCHB voltage through an external divider on an AIN pin, SH1 samples the motor current through
+// the I2V converter.
+// set to 0 to use the comparator (shc_compare()) instead
+#define ADC_CAPTURE_ENABLE      0
+
+// sample period in system timer ticks; the channels are 16 bits wide, so this is limited to about 2ms
+#define ADC_CAPTURE_PERIOD      (WAIT_ABOUT_1MS)
+
+// number of samples the ring buffer can hold; must be a power of 2
+#define ADC_CAPTURE_BUFFER_SIZE 32
+
+// analog input of SH0 carrying the (divided) VCCHB voltage: ain_sel_ain1 or ain_sel_ain2
+#define ADC_CAPTURE_VCCHB_AIN   ain_sel_ain1
+
+// scaling of the SH0 result to the scale of VOLTAGE_ON/VOLTAGE_OFF (Q10, e.g. 1024 passes the result unchanged); depends on divider
+#define ADC_CAPTURE_VCCHB_SCALE 1024
+
+
+//-----------------------------------------------------------------
+// Settings for temperature compensation
+
+// ESR of the HB cap, resistance of the motor winding and the viscosity of the grease depend on temperature. If
+// enabled, the on-chip temperature sensor is read at the start of the movement, and VOLTAGE_OFF,
+// MOTOR_START_CORRECTION and TOTAL_MOTOR_RUNTIME are replaced by values interpolated from the table below. The
+// runtime and correction of the backward direction are scaled by the same ratio as the forward values.
+// set to 0 to use the fixed values configured above
+#define TEMP_COMP_ENABLE        0
+
+// calibration of the temperature sensor: raw result at 25 degC, and change of the raw result per Kelvin (Q8)
+// (example values, to be characterized for the device)
+#define TEMP_SENSE_RAW_25C      2048
+#define TEMP_SENSE_SLOPE_Q8     1280
+
+// compensation table, one line per temperature in ascending order:
+// { temperature [degC], VOLTAGE_OFF, MOTOR_START_CORRECTION, TOTAL_MOTOR_RUNTIME }
+// below the first and above the last line, the values of that line are used
+// (example values, to be characterized for the motor and mechanics)
+#define TEMP_COMP_TABLE \
+    { -20, 2400, 25, 2600 }, \
+    {   0, 2300, 15, 2250 }, \
+    {  25, 2200, 10, 2000 }, \
+    {  60, 2150,  8, 1900 }
+
+
+//-----------------------------------------------------------------
+// Settings for the field strength estimation
+
+// The RSSI of the NFC receiver is sampled at the start and at the end of each charge phase to estimate the power
+// harvested from the field. From this, the number of steps and the time to complete the movement are predicted and
+// published as data points, so that the NFC reader (e.g. a phone app) can tell the user how long to hold still.
+// If the harvested power is close to the power drawn by the motor, the motor is driven continuously: it is switched
+// on again as soon as the voltage has recovered a bit above the "off" voltage instead of waiting for a full charge.
+// set to 0 to disable estimation and always use full charge cycles
+#define FIELD_ESTIMATE_ENABLE   0
+
+// capacitance of the HB cap in microfarads
+#define VCCHB_CAPACITANCE_UF    470
+
+// power drawn by the motor while running in microwatts
+#define MOTOR_POWER_UW          60000
+
+// initial estimate of harvested power per digit of the RSSI reading in microwatts (Q8), refined by the measured
+// charge phases (example value, to be characterized with the antenna)
+#define FIELD_POWER_PER_RSSI_Q8 4096
+
+// switch to continuous drive if harvested power is at least this percentage of the motor power
+#define FIELD_CONTINUOUS_PERCENT 80
+
+// in continuous drive, restart the motor when the voltage is this much above VOLTAGE_OFF
+#define FIELD_CONTINUOUS_HYSTERESIS 100
+
+
+//-----------------------------------------------------------------
+// Settings for the energy accounting
+
+// The energy harvested from the field and the energy delivered to the motor are calculated for each step from the
+// VCCHB voltages at the switching of the motor and the durations of the phases, using VCCHB_CAPACITANCE_UF above.
+// The balance of the last step and of the movement, the losses and the efficiency are published as data points.
+// set to 0 to disable
+#define ENERGY_ACCOUNT_ENABLE   0
+
+
+//-----------------------------------------------------------------
+// Settings for stall detection
+
+// The motor current is sampled through the I2V converter of the sense unit during the "on" phases. If the current
+// stays above a threshold for a number of samples, the motor is considered stalled (e.g. the mechanism has reached
+// its end stop), and the movement ends, even if the total motor runtime has not been reached.
+// set to 0 to disable
+#define STALL_DETECT_ENABLE     0
+
+// analog input connected to the motor current sense path: ain_sel_ain3 or ain_sel_ain4 (SH1)
+#define STALL_I2V_AIN           ain_sel_ain3
+
+// current threshold (raw ADC result of the I2V path; to be characterized for the motor)
+#define STALL_CURRENT_THRESHOLD 3000
+
+// number of consecutive samples above threshold to detect a stall
+#define STALL_CONFIRM_SAMPLES   3
+
+// time after switching on the motor in which the inrush current is not considered a stall, in milliseconds
+#define STALL_BLANKING_TIME     30
+
+
+//-----------------------------------------------------------------
+// Settings for back EMF estimation
+
+// While coasting after each step, the back EMF of the motor is sampled and integrated to measure the movement. The
+// measured movement replaces MOTOR_START_CORRECTION (which is still used as the prediction for the first step), and
+// the movement is complete when the motor runtime plus the measured coasting reaches TOTAL_MOTOR_RUNTIME.
+// Only steps ending with step_end_coast are measured (see STEP_END_STRATEGY), the other strategies short the winding.
+// Not available with ADC_CAPTURE_ENABLE, as the back EMF is measured through the comparator path.
+// set to 0 to disable
+#define BEMF_ESTIMATE_ENABLE    0
+
+// back EMF between MA and MB with the motor running at nominal speed (scale of the comparator thresholds)
+#define BEMF_NOMINAL            1500
+
+// back EMF below which the motor is considered to stand still
+#define BEMF_THRESHOLD          50
+
+// sample period of the back EMF while coasting, in milliseconds
+#define BEMF_SAMPLE_PERIOD      1
+
+
+//-----------------------------------------------------------------
+// Settings for the end stop switch
+
+// A switch at each end of the travel of the mechanism connects a GPIO to VDD (the internal pull down is enabled). The
+// interrupt of the switch in the direction of the movement switches the motor off immediately and ends the movement;
+// the total motor runtime remains as a fallback.
+// set to 0 to disable
+#define ENDSTOP_ENABLE          0
+
+// GPIOs of the end stop switches at the end of the forward and the backward movement, 0..7
+#define ENDSTOP_GPIO_FORWARD    0
+#define ENDSTOP_GPIO_BACKWARD   1
+
+
+//-----------------------------------------------------------------
+// Settings for the end of each step
+
+// How the motor is switched off at the end of a step (see step_end.h):
+//   step_end_coast:          the motor coasts to a stop, the overshoot is covered by MOTOR_START_CORRECTION (or measured
+//                            by BEMF_ESTIMATE_ENABLE)
+//   step_end_freewheel_low:  the winding is shorted through LS1 + LS2 for STEP_END_FREEWHEEL_TIME, then coasts
+//   step_end_freewheel_high: the winding is shorted through HS1 + HS2 for STEP_END_FREEWHEEL_TIME, then coasts
+//   step_end_brake:          the winding is shorted through LS1 + LS2 until the motor has stopped (STEP_END_BRAKE_TIME)
+// Braking gives the smallest and most repeatable overshoot; reduce MOTOR_START_CORRECTION accordingly. The energy of
+// the rotating parts is lost, though, so coasting needs less energy per movement.
+#define STEP_END_STRATEGY       step_end_coast
+
+// strategy at the end of the last step of a movement, e.g. step_end_brake to stop precisely at the target
+#define STEP_END_FINAL_STRATEGY step_end_coast
+
+// time the winding is shorted by the freewheel strategies, in milliseconds
+#define STEP_END_FREEWHEEL_TIME 2
+
+// time the winding is shorted by the brake strategy, in milliseconds
+#define STEP_END_BRAKE_TIME     20
+
+// configuration of the H bridge while the motor is running and while braking, see hb_config_struct_t and the manual:
+// { slopetrtfx10, slopetrtf, slopeext, slope_en, ccset, brake_en, acl_en, acl_delay }
+// set to 0 to leave the H bridge configuration untouched
+#define HB_CONFIG_ENABLE        0
+#define HB_CONFIG_RUN           { false, 0, false, true, 3, false, true, 2 }
+#define HB_CONFIG_BRAKE         { false, 0, false, true, 3, true,  true, 2 }
+
+
+//-----------------------------------------------------------------
+// Settings for motion profiles
+
+// The movement is described by segments which ramp the duty of the motor up and down (see motion_profile.h). The
+// segments continue across the charge cycles of the VCCHB capacitor. The movement ends after the last segment;
+// the total motor runtime remains as a limit and should be configured above the sum of the segment durations.
+// set to 0 to drive the motor with full duty
+#define MOTION_PROFILE_ENABLE   0
+
+// period of the software PWM, in system timer ticks
+#define MOTION_PWM_PERIOD       (WAIT_ABOUT_1MS)
+
+// segments of the forward and the backward movement, one line per segment:
+// { duty at start [%], duty at end [%], stop conditions (motion_stop_t), duration [ms], encoder pulses }
+// duty 0 at start and end: dwell, the motor is off for the duration
+#define MOTION_PROFILE_FORWARD \
+    {  40, 100, motion_stop_none,   150, 0 }, \
+    { 100, 100, motion_stop_none,  1500, 0 }, \
+    { 100,  40, motion_stop_stall,  150, 0 }
+#define MOTION_PROFILE_BACKWARD \
+    {  40, 100, motion_stop_none,   150, 0 }, \
+    { 100, 100, motion_stop_none,  1500, 0 }, \
+    { 100,  40, motion_stop_stall,  150, 0 }
+
+
+//-----------------------------------------------------------------
+// Settings for the motor encoder
+
+// The pulses of a hall sensor on the motor are counted through the GPIO event unit. If a target number of pulses is
+// configured, the movement ends when it is reached, and TOTAL_MOTOR_RUNTIME only remains as a fallback.
+// set to 0 to disable
+#define ENCODER_ENABLE          0
+
+// GPIO of the encoder output
+#define ENCODER_GPIO            2
+
+// alternate input function of ENCODER_GPIO which feeds the GPIO event unit (see set_singlegpio_alt() and the manual)
+#define ENCODER_ALT_IN          1
+
+// number of encoder pulses of the forward and the backward movement; 0: the movement ends at the total motor runtime
+#define ENCODER_TARGET_PULSES   0
+#define ENCODER_TARGET_PULSES_BACKWARD 0
+
+
+//-----------------------------------------------------------------
+// Settings for the power saving mode during charge phases
+
+// In a weak field, the device sleeps in the power saving mode of the PMU for most of a charge phase, so that the
+// power otherwise drawn by the clocks and the peripherals charges the HB cap. The duration of a charge phase is
+// expected to be the one of the previous charge phase; the standby timer wakes the device up before it has ended.
+// Not available with ADC_CAPTURE_ENABLE. set to 0 to disable
+#define LOW_POWER_ENABLE        0
+
+// minimum time to sleep in milliseconds; shorter charge phases are done with the regular checks of the voltage
+#define LOW_POWER_MIN_SLEEP     50
+
+// part of the expected remaining charge phase to sleep, in percent; the remainder is checked regularly
+#define LOW_POWER_SLEEP_PERCENT 75
+
+// clock ticks of the standby timer (slow clock) per millisecond (example value, check the slow clock frequency)
+#define STANDBY_TICKS_PER_MS    32
+
+// set to 1 to wake up on NFC field presence as well
+#define LOW_POWER_WAKE_BY_NFC   0
+
+
+//-----------------------------------------------------------------
+// Settings for the power domain manager
+
+// The peripheral blocks (NVM, sense unit, comparator, system timer) are requested by the modules using them, and the
+// blocks not in use are switched off before each motor on phase and after the movement. set to 0 to disable
+#define POWER_MANAGER_ENABLE    0
+
+// power consumption of the NVM, the sense unit, the comparator and the system timer when switched on, in microwatts;
+// used to estimate the energy saved (example values, to be measured)
+#define POWER_DOMAIN_UW         150, 300, 100, 50
+
+
+//-----------------------------------------------------------------
+// Settings for the execution of the control loop from RAM
+
+// The control loop, the functions it calls, the interrupt handlers and the functions of the NVM library they use are
+// copied from the NVM to the RAM at startup (section .ram_code, see Linker_config.ld), so that the loop runs without
+// the wait states of the NVM. The NVM stays on: the ROM dispatches the interrupts of the loop (system tick, ADC,
+// GPIO, NFC) through the handler addresses in the aparams, which are in the NVM.
+// Costs RAM for the code (see "make size"). set to 0 to disable
+#define RAM_CODE_ENABLE         0
+
+// placement of the functions and constants used by the control loop
+#if defined RAM_CODE_ENABLE && RAM_CODE_ENABLE
+#define RAM_CODE                __attribute__((section(".ram_code")))
+#define RAM_CONST               __attribute__((section(".ram_const")))
+#else
+#define RAM_CODE
+#define RAM_CONST
+#endif
+
+
+//-----------------------------------------------------------------
+// Settings for the switching of the H bridge
+
+// The switch register of the H bridge is written directly by an inline function (see hb_switch.h) instead of calling
+// set_hb_switch() through the jump table of the ROM library. Same register value, without the call overhead.
+// set to 0 to use the ROM library
+#define HB_DIRECT_ENABLE        0
+
+
+//-----------------------------------------------------------------
+// Settings for the calibration of the start correction
+
+// The NFC reader may start a calibration through DP_MOTION_COMMAND: single steps of different runtimes are driven
+// and their movement is measured with the encoder, and the start correction is fitted by least squares. The result
+// is stored in NVM and replaces MOTOR_START_CORRECTION (MOTOR_START_CORRECTION_BACKWARD) of that direction.
+// needs ENCODER_ENABLE; set to 0 to disable
+#define CALIBRATION_ENABLE      0
+
+// number of steps (2...8), runtimes are spread evenly from CALIBRATION_STEP_MIN to CALIBRATION_STEP_MAX
+#define CALIBRATION_STEPS       8
+
+// runtime of the shortest and the longest step in milliseconds (at most 1000); the longest step must be possible
+// with the energy stored in the capacitor
+#define CALIBRATION_STEP_MIN    10
+#define CALIBRATION_STEP_MAX    80
+
+// time after each step to let the motor coast to a stop, in milliseconds
+#define CALIBRATION_SETTLE      100
+
+// time to wait for the capacitor to be charged before each step, in milliseconds
+#define CALIBRATION_CHARGE_TIMEOUT 5000
+
 
 //-----------------------------------------------------------------
 // Settings for timer controlled operation
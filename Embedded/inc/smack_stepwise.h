@@ -26,6 +26,10 @@
 #ifndef _SMACK_STEPWISE_H_
 #define _SMACK_STEPWISE_H_
 
+#include <stdint.h>
+#include <stdbool.h>
+#include "motion_profile.h"
+
 
 /** @addtogroup Infineon
  * @{
@@ -41,6 +45,91 @@
  */
 
 
+/**
+ * @brief parameters of the stepwise motor operation
+ *        Initialized from settings.h at the start of a movement and possibly adjusted to the conditions found then.
+ */
+typedef struct stepwise_params_s
+{
+    uint16_t voltage_on;        //!< VCCHB voltage to switch on the motor (see VOLTAGE_ON)
+    uint16_t voltage_off;       //!< VCCHB voltage to switch off the motor (see VOLTAGE_OFF)
+    uint16_t additional_charge; //!< time to charge on after reaching voltage_on, milliseconds (see DELAY_ADDITIONAL_CHARGE)
+    uint16_t poll_period;       //!< period of the control loop, milliseconds (see POLL_PERIOD)
+    uint32_t start_correction;  //!< runtime added on each start of the motor, milliseconds (see MOTOR_START_CORRECTION)
+    uint32_t total_runtime;     //!< total time the motor shall run, milliseconds (see TOTAL_MOTOR_RUNTIME)
+    uint32_t target_pulses;     //!< encoder pulses of the movement, 0: end at total_runtime (see ENCODER_TARGET_PULSES)
+    const motion_segment_t* segments;   //!< motion profile, NULL: full duty (see MOTION_PROFILE_ENABLE)
+    uint8_t  segment_count;     //!< number of segments of the motion profile
+} stepwise_params_t;
+
+/**
+ * @brief direction of a movement
+ */
+typedef enum motion_dir_e
+{
+    motion_forward  = 0,        //!< HS1 + LS2, VCCHB observed on MA
+    motion_backward = 1         //!< HS2 + LS1, VCCHB observed on MB
+} motion_dir_t;
+
+/**
+ * @brief commands to start a movement, written by the NFC reader (see DP_MOTION_COMMAND)
+ */
+typedef enum motion_cmd_e
+{
+    motion_cmd_none               = 0,  //!< no movement requested
+    motion_cmd_forward            = 1,  //!< move forward with the default profile
+    motion_cmd_backward           = 2,  //!< move backward with the default profile
+    motion_cmd_calibrate_forward  = 3,  //!< calibrate the start correction moving forward (see CALIBRATION_ENABLE)
+    motion_cmd_calibrate_backward = 4   //!< calibrate the start correction moving backward
+} motion_cmd_t;
+
+/**
+ * @brief reason why a movement has ended
+ */
+typedef enum stepwise_end_e
+{
+    stepwise_end_none    = 0,   //!< movement not completed (yet)
+    stepwise_end_time    = 1,   //!< total motor runtime reached
+    stepwise_end_stall   = 2,   //!< motor stalled, e.g. mechanism at its end stop
+    stepwise_end_endstop = 3,   //!< end stop switch reached
+    stepwise_end_pulses  = 4,   //!< target number of encoder pulses reached
+    stepwise_end_profile = 5    //!< all segments of the motion profile done
+} stepwise_end_t;
+
+/**
+ * @brief result of the last movement, published as data points
+ */
+typedef struct stepwise_status_s
+{
+    uint8_t  end;               //!< reason why the movement has ended (stepwise_end_t)
+    uint8_t  direction;         //!< direction of the movement (motion_dir_t)
+    uint32_t runtime;           //!< accumulated motor runtime in milliseconds (including start corrections)
+    uint32_t pulses;            //!< encoder pulses counted during the movement
+} stepwise_status_t;
+
+extern stepwise_status_t stepwise_status;
+
+/**
+ * @brief pending motion command (motion_cmd_t), written by the NFC reader and executed by the background loop
+ */
+extern volatile uint8_t motion_command;
+
+
+/**
+ * @brief Fill a profile with the default parameters of a direction from settings.h.
+ * @param direction direction of the movement
+ * @param profile   profile to fill
+ */
+void motion_profile_default(const motion_dir_t direction, stepwise_params_t* profile);
+
+/**
+ * @brief Perform a movement. Returns when the movement has ended, the result is reported in stepwise_status.
+ * @param direction direction of the movement
+ * @param profile   parameters of the movement, possibly adjusted to the temperature before use
+ */
+void motion_run(const motion_dir_t direction, const stepwise_params_t* profile);
+
+
 void hardfault_handler(void);
 
 
@@ -0,0 +1,81 @@
+/* ============================================================================
+** Copyright (c) 2021 Infineon Technologies AG
+**               All rights reserved.
+**               www.infineon.com
+** ============================================================================
+**
+** ============================================================================
+** Redistribution and use of this software only permitted to the extent
+** expressly agreed with Infineon Technologies AG.
+** ============================================================================
+*
+*/
+
+/**
+ * @file     stall_detect.h
+ *
+ * @brief    Detection of a stalled motor from its current.
+ *
+ * @version  v1.0
+ * @date     2021-08-01
+ *
+ */
+
+#ifndef _STALL_DETECT_H_
+#define _STALL_DETECT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+
+/** @addtogroup Infineon
+ * @{
+ */
+
+/** @addtogroup Smack_stepwise
+ * @{
+ */
+
+/** @addtogroup stall_detect
+ * @{
+ */
+
+
+/**
+ * @brief Power up the sense unit and configure SH1 to sample the motor current through the I2V converter.
+ *        Not needed if the current is taken from the timer triggered ADC capture.
+ */
+extern void stall_detect_init(void);
+
+/**
+ * @brief Power down the sense unit.
+ */
+extern void stall_detect_close(void);
+
+/**
+ * @brief Sample the motor current.
+ * @return          motor current (raw result of I2V path)
+ */
+extern uint16_t stall_detect_sample(void);
+
+/**
+ * @brief Reset the detection, to be called whenever the motor is switched on.
+ */
+extern void stall_detect_start(void);
+
+/**
+ * @brief Feed a current sample into the detection.
+ * @param current   motor current (raw result of I2V path)
+ * @param on_ms     time since the motor has been switched on in milliseconds
+ * @return          true: motor stalled
+ */
+extern bool stall_detect(const uint16_t current, const uint32_t on_ms);
+
+
+/** @} */ /* End of group stall_detect */
+
+/** @} */ /* End of group Smack_stepwise */
+
+/** @} */ /* End of group Infineon */
+
+#endif /* _STALL_DETECT_H_ */
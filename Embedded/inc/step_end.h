@@ -0,0 +1,76 @@
+/* ============================================================================
+** Copyright (c) 2021 Infineon Technologies AG
+**               All rights reserved.
+**               www.infineon.com
+** ============================================================================
+**
+** ============================================================================
+** Redistribution and use of this software only permitted to the extent
+** expressly agreed with Infineon Technologies AG.
+** ============================================================================
+*
+*/
+
+/**
+ * @file     step_end.h
+ *
+ * @brief    Switching of the H bridge at the end of each step: coast, freewheel or brake.
+ *
+ * @version  v1.0
+ * @date     2021-08-01
+ *
+ */
+
+#ifndef _STEP_END_H_
+#define _STEP_END_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+
+/** @addtogroup Infineon
+ * @{
+ */
+
+/** @addtogroup Smack_stepwise
+ * @{
+ */
+
+/** @addtogroup step_end
+ * @{
+ */
+
+
+/**
+ * @brief strategies to switch off the motor at the end of a step
+ */
+typedef enum step_end_e
+{
+    step_end_coast          = 0,    //!< open the low side switch, the motor coasts (top switch stays closed)
+    step_end_freewheel_low  = 1,    //!< LS1 + LS2 for STEP_END_FREEWHEEL_TIME, then coast
+    step_end_freewheel_high = 2,    //!< HS1 + HS2 for STEP_END_FREEWHEEL_TIME, then coast
+    step_end_brake          = 3     //!< LS1 + LS2 with HB_CONFIG_BRAKE for STEP_END_BRAKE_TIME, then coast
+} step_end_t;
+
+
+/**
+ * @brief Apply the H bridge configuration for the motor running (HB_CONFIG_RUN), if configured.
+ */
+extern void step_end_init(void);
+
+/**
+ * @brief Switch off the motor. Returns with the top switch of the direction closed (the "off" state of the control
+ *        loop), after the freewheel or brake time, if any.
+ * @param strategy  how to switch off the motor
+ * @param forward   direction of the movement: true forward (HS1 + LS2), false backward (HS2 + LS1)
+ */
+extern void step_end(const step_end_t strategy, const bool forward);
+
+
+/** @} */ /* End of group step_end */
+
+/** @} */ /* End of group Smack_stepwise */
+
+/** @} */ /* End of group Infineon */
+
+#endif /* _STEP_END_H_ */
@@ -0,0 +1,66 @@
+/* ============================================================================
+** Copyright (c) 2021 Infineon Technologies AG
+**               All rights reserved.
+**               www.infineon.com
+** ============================================================================
+**
+** ============================================================================
+** Redistribution and use of this software only permitted to the extent
+** expressly agreed with Infineon Technologies AG.
+** ============================================================================
+*
+*/
+
+/**
+ * @file     temp_comp.h
+ *
+ * @brief    Temperature compensation of the stepwise motor parameters.
+ *
+ * @version  v1.0
+ * @date     2021-08-01
+ *
+ */
+
+#ifndef _TEMP_COMP_H_
+#define _TEMP_COMP_H_
+
+#include <stdint.h>
+#include "smack_stepwise.h"
+
+
+/** @addtogroup Infineon
+ * @{
+ */
+
+/** @addtogroup Smack_stepwise
+ * @{
+ */
+
+/** @addtogroup temp_comp
+ * @{
+ */
+
+
+/**
+ * @brief Read the on-chip temperature sensor.
+ *        Uses the sense unit, so the comparator must not be active (call before shc_init()).
+ * @return          temperature in degC (Q8)
+ */
+extern int32_t temp_comp_read(void);
+
+/**
+ * @brief Replace voltage_off by the value interpolated from the compensation table (TEMP_COMP_TABLE in settings.h),
+ *        and scale start_correction and total_runtime by the ratio of the interpolated values to the forward defaults.
+ * @param params    parameters to adjust
+ * @param temp      temperature in degC (Q8), see temp_comp_read()
+ */
+extern void temp_comp_apply(stepwise_params_t* params, const int32_t temp);
+
+
+/** @} */ /* End of group temp_comp */
+
+/** @} */ /* End of group Smack_stepwise */
+
+/** @} */ /* End of group Infineon */
+
+#endif /* _TEMP_COMP_H_ */
@@ -0,0 +1,68 @@
+/* ============================================================================
+** Copyright (c) 2021 Infineon Technologies AG
+**               All rights reserved.
+**               www.infineon.com
+** ============================================================================
+**
+** ============================================================================
+** Redistribution and use of this software only permitted to the extent
+** expressly agreed with Infineon Technologies AG.
+** ============================================================================
+*
+*/
+
+/**
+ * @file     voltage_measure.h
+ *
+ * @brief    Measurement of the H bridge pin voltages (e.g. VCCHB) with the resolution of the comparator.
+ *
+ * @version  v1.0
+ * @date     2021-08-01
+ *
+ */
+
+#ifndef _VOLTAGE_MEASURE_H_
+#define _VOLTAGE_MEASURE_H_
+
+#include <stdint.h>
+#include "shc_lib.h"
+
+
+/** @addtogroup Infineon
+ * @{
+ */
+
+/** @addtogroup Smack_stepwise
+ * @{
+ */
+
+/** @addtogroup voltage_measure
+ * @{
+ */
+
+
+/**
+ * @brief Measure the voltage of an H bridge pin.
+ *        The result has the same scale as the threshold of shc_compare() (1000mV ~ 1024 digits), so
+ *        "voltage_measure(ch) >= threshold" gives the same decision as "shc_compare(ch, threshold)".
+ *        The comparator must be initialized (shc_init()).
+ * @param channel   signal to measure
+ * @return          voltage of signal (digits)
+ */
+extern uint16_t voltage_measure(const shc_channel_t channel);
+
+/**
+ * @brief Convert a measurement result or comparator threshold to millivolts.
+ * @param digits    result of voltage_measure()
+ * @return          voltage in millivolts
+ */
+extern uint16_t voltage_to_mv(const uint16_t digits);
+
+
+/** @} */ /* End of group voltage_measure */
+
+/** @} */ /* End of group Smack_stepwise */
+
+/** @} */ /* End of group Infineon */
+
+#endif /* _VOLTAGE_MEASURE_H_ */
@@ -0,0 +1,622 @@
+#!/usr/bin/env python3
+# ============================================================================
+# Copyright (c) 2021 Infineon Technologies AG
+#               All rights reserved.
+#               www.infineon.com
+# ============================================================================
+#
+# ============================================================================
+# Redistribution and use of this software only permitted to the extent
+# expressly agreed with Infineon Technologies AG.
+# ============================================================================
+
+"""Cycle profile of the NVM image under a Cortex-M0 instruction set emulator.
+
+The NVM image (image_nvm.elf) is run from its entry (_nvm_start) under Unicorn
+(pip install unicorn, version 2). The ROM image is loaded for its jump table,
+whose entries are replaced by stubs implemented here. The stubs follow a simple
+electrical model: VCCHB charges from a constant current and is drained through
+the motor while the H bridge drives it.
+
+Stubs:
+- ROM functions: each call costs --rom-cycles, plus the conversion time for the
+  conversions of the sense unit.
+- NVM library functions whose timing depends on the hardware (timers, ADC
+  conversion): these are stubbed by default at an estimated cost (LIB_MODELS
+  below). --native NAME runs one of them from the image instead.
+- Peripheral registers: plain memory. A register polled by the same
+  instruction many times in a row is taken as a busy wait and toggled; each
+  toggle is reported.
+
+Time passes with the executed cycles and in the modelled waits
+(single_shot_systick(), sys_tim_singleshot_32(), power saving mode). Waits are
+reported separately from the CPU cycles.
+
+Cycles are counted per instruction with the timing of the Cortex-M0 technical
+reference manual:
+- 1 cycle for data processing;
+- 2 for loads and stores;
+- 1+N for PUSH/POP/LDM/STM, +3 when loading the PC;
+- 3 for taken branches and 4 for BL.
+--wait-states adds wait states to each word fetched from NVM, both code and
+literals.
+
+Interrupts can be injected periodically with --irq FUNCTION:PERIOD. Each
+injection adds --irq-overhead cycles for exception entry, exit and the ROM
+dispatcher.
+
+Output:
+- per function: calls, self cycles, inclusive cycles, cycles per call (mean
+  and max);
+- the CPU cycles between two waits of the control loop, i.e. the cost of one
+  loop iteration, which bounds the polling period;
+- folded stacks (<out>.folded, for flamegraph.pl or speedscope) and a flame
+  graph (<out>.svg).
+"""
+
+import argparse
+import bisect
+import collections
+import html
+import os
+import re
+import struct
+import sys
+
+MAGIC_RETURN = 0x30000000      # return address of injected interrupts
+STUB_BASE = 0x30001000         # stubs of the ROM jump table
+XTAL = 28000000
+
+NVM_BASE, NVM_END = 0x00010000, 0x00020000
+MEMORY_MAP = [                 # (base, size): ROM/DPARAM/APARAM/NVM, RAM, RAM2, SCU, peripherals, stubs
+    (0x00000000, 0x00020000),
+    (0x00020000, 0x00002000),
+    (0x20000000, 0x00002000),
+    (0x20010000, 0x00010000),
+    (0x40000000, 0x00010000),
+    (0x30000000, 0x00002000),
+]
+REGISTER_WINDOWS = [(0x20010000, 0x20020000), (0x40000000, 0x40010000)]
+HB_SWITCH_REG = 0x40000004     # written directly with HB_DIRECT_ENABLE, see hb_switch.h
+BUSY_WAIT_READS = 64
+
+
+# ---- ELF
+
+class Elf:
+    """Minimal reader of 32 bit little endian ELF files: loadable segments, sections and sized symbols."""
+
+    def __init__(self, path):
+        with open(path, 'rb') as f:
+            self.data = f.read()
+        if self.data[:4] != b'\x7fELF' or self.data[4] != 1 or self.data[5] != 1:
+            raise ValueError('%s: not a 32 bit little endian ELF file' % path)
+        (self.entry, phoff, shoff, _, _, phentsize, phnum, shentsize, shnum, shstrndx) = \
+            struct.unpack_from('<IIIIHHHHHH', self.data, 24)
+        self.segments = []
+        for i in range(phnum):
+            p_type, p_offset, p_vaddr, _, p_filesz, p_memsz, _, _ = \
+                struct.unpack_from('<IIIIIIII', self.data, phoff + i * phentsize)
+            if p_type == 1 and p_memsz != 0:
+                self.segments.append((p_vaddr, self.data[p_offset:p_offset + p_filesz], p_memsz))
+        self.sections = []
+        for i in range(shnum):
+            self.sections.append(struct.unpack_from('<IIIIIIIIII', self.data, shoff + i * shentsize))
+        self.section_names = [self._string(self.sections[shstrndx][4], sh[0]) for sh in self.sections] \
+            if shstrndx < shnum else [''] * shnum
+        self.symbols = {}
+        self.functions = []
+        self.objects = []               # data symbols: (address, size, name)
+        for sh_name, sh_type, _, _, sh_offset, sh_size, sh_link, _, _, sh_entsize in self.sections:
+            if sh_type != 2:   # SHT_SYMTAB
+                continue
+            strtab = self.sections[sh_link]
+            for off in range(sh_offset, sh_offset + sh_size, sh_entsize):
+                st_name, st_value, st_size, st_info, _, _ = struct.unpack_from('<IIIBBH', self.data, off)
+                name = self._string(strtab[4], st_name)
+                if not name or name.startswith('$'):
+                    continue
+                self.symbols[name] = st_value
+                if (st_info & 0xf) == 2:   # STT_FUNC
+                    self.functions.append((st_value & ~1, st_size, name))
+                elif (st_info & 0xf) == 1 and st_size != 0:   # STT_OBJECT
+                    self.objects.append((st_value, st_size, name))
+        self.functions.sort()
+        self._starts = [f[0] for f in self.functions]
+
+    def _string(self, offset, index):
+        end = self.data.index(b'\0', offset + index)
+        return self.data[offset + index:end].decode('ascii', 'replace')
+
+    def function_at(self, address):
+        i = bisect.bisect_right(self._starts, address) - 1
+        if i >= 0:
+            start, size, name = self.functions[i]
+            if address < start + max(size, 2):
+                return name
+        return '0x%08x' % address
+
+
+def rom_table_names(header):
+    """Names of the entries of rom_func_table_t in the order of rom_lib.h."""
+    text = open(header, encoding='latin-1').read()
+    body = text[text.index('typedef struct'):text.index('} rom_func_table_t')]
+    return re.findall(r'\(\s*\*\s*m_(\w+)\s*\)', body)
+
+
+# ---- Cortex-M0 instruction timing
+
+def instruction_timing(hw1, hw2, mul_cycles):
+    """Cycles of a Thumb instruction and its kind: 'call', 'branch' (conditional), 'return', 'wfi' or ''."""
+    if (hw1 & 0xf800) in (0xf000, 0xf800, 0xe800):
+        if (hw1 & 0xf800) == 0xf000 and (hw2 & 0xd000) == 0xd000:
+            return 4, 'call'                                    # BL
+        return 4, ''                                            # MSR, MRS, DMB, DSB, ISB
+    if (hw1 & 0xff00) == 0xbd00:
+        return 4 + bin(hw1 & 0xff).count('1'), 'return'         # POP {..., PC}
+    if (hw1 & 0xfe00) in (0xb400, 0xbc00):
+        return 1 + bin(hw1 & 0x1ff).count('1'), ''              # PUSH, POP
+    if (hw1 & 0xf000) == 0xc000:
+        return 1 + bin(hw1 & 0xff).count('1'), ''               # LDM, STM
+    if (hw1 & 0xff80) == 0x4780:
+        return 3, 'call'                                        # BLX Rm
+    if (hw1 & 0xff80) == 0x4700:
+        return 3, 'return' if (hw1 & 0x78) == 0x70 else ''      # BX LR, BX Rm
+    if (hw1 & 0xff00) in (0x4400, 0x4600) and (hw1 & 0x87) == 0x87:
+        return 3, ''                                            # ADD/MOV PC, Rm
+    if (hw1 & 0xf000) == 0xd000 and (hw1 & 0x0f00) < 0x0e00:
+        return 1, 'branch'                                      # B<cond>, 3 if taken
+    if (hw1 & 0xf800) == 0xe000:
+        return 3, ''                                            # B
+    if (hw1 & 0xf800) == 0x4800 or (hw1 & 0xf000) in (0x5000, 0x6000, 0x7000, 0x8000, 0x9000):
+        return 2, ''                                            # LDR, STR
+    if (hw1 & 0xffc0) == 0x4340:
+        return mul_cycles, ''                                   # MULS
+    if hw1 == 0xbf30:
+        return 2, 'wfi'
+    return 1, ''
+
+
+# ---- plant and stubs
+
+class Plant:
+    """VCCHB charged by a constant current, drained by a resistive motor while the H bridge drives it."""
+
+    def __init__(self, args):
+        self.harvest = args.harvest_ua * 1e-6
+        self.cap = args.cap_uf * 1e-6
+        self.motor_ohm = args.motor_ohm
+        self.clamp = args.clamp_mv * 1e-3
+        self.vcchb = 0.0
+        self.switches = (False, False, False, False)
+        self.time = 0
+
+    def advance(self, now):
+        while self.time < now:
+            step = min(now - self.time, 1000)
+            hs1, ls1, hs2, ls2 = self.switches
+            load = self.vcchb / self.motor_ohm if ((hs1 and ls2) or (hs2 and ls1)) else 0.0
+            self.vcchb = min(max(self.vcchb + (self.harvest - load) * step / XTAL / self.cap, 0.0), self.clamp)
+            self.time += step
+
+    def pin_digits(self, channel):
+        hs1, _, hs2, _ = self.switches
+        high = hs1 if channel == 3 else hs2
+        return min(int(self.vcchb * 1024), 8191) if high else 0
+
+
+class Profiler:
+
+    def __init__(self, args, uc, nvm, rom_names):
+        self.args = args
+        self.uc = uc
+        self.nvm = nvm
+        self.rom_names = rom_names
+        self.plant = Plant(args)
+        self.cycles = 0                 # CPU cycles
+        self.sleep = 0                  # cycles spent in modelled waits
+        self.self_cycles = collections.Counter()
+        self.folded = collections.Counter()
+        self.calls = collections.Counter()
+        self.inclusive = collections.Counter()
+        self.max_call = collections.Counter()
+        self.frames = []                # [name, return address, cycles at entry]
+        self.pending = None             # instruction whose taken branch is not known yet
+        self.decoded = {}
+        self.last_fetch = None
+        self.clock_start = None
+        self.clock_value = 0
+        self.vclamp = 0
+        self.stbtm = 0
+        self.iterations = []            # CPU cycles between two waits
+        self.iteration_start = 0
+        self.reads = (None, None, 0)    # busy wait detection: pc, address, count
+        self.busy_waits = collections.Counter()
+        self.stop_reason = None
+        self.next_irq = {name: period for name, period in args.irq}
+        self.irq_saved = None
+
+    @property
+    def now(self):
+        return self.cycles + self.sleep
+
+    # -- accounting
+
+    def charge(self, cycles, name=None):
+        stack = [f[0] for f in self.frames] or ['?']
+        if name is not None and stack[-1] != name:
+            stack.append(name)
+        self.cycles += cycles
+        self.self_cycles[stack[-1]] += cycles
+        self.folded[';'.join(stack)] += cycles
+
+    def wait(self, cycles):
+        self.iterations.append(self.cycles - self.iteration_start)
+        self.sleep += cycles
+        self.iteration_start = self.cycles
+        self.plant.advance(self.now)
+
+    def push(self, name, ret):
+        self.frames.append([name, ret & ~1, self.cycles])
+        self.calls[name] += 1
+
+    def pop(self):
+        name, _, start = self.frames.pop()
+        self.inclusive[name] += self.cycles - start
+        self.max_call[name] = max(self.max_call[name], self.cycles - start)
+
+    # -- hooks
+
+    def on_code(self, uc, address, size, _):
+        if self.pending is not None:
+            prev, prev_size, kind = self.pending
+            self.pending = None
+            if kind == 'branch' and address != prev + prev_size:
+                self.charge(2)
+            elif kind == 'call' and address != prev + prev_size:
+                self.push(self.function(address), prev + prev_size)
+        while self.frames and address == self.frames[-1][1]:
+            self.pop()
+
+        if address == MAGIC_RETURN:
+            self.stop_reason = 'irq_return'
+            uc.emu_stop()
+            return
+        if STUB_BASE <= address < STUB_BASE + 4 * len(self.rom_names):
+            self.rom_stub(self.rom_names[(address - STUB_BASE) // 4])
+            return
+        if address in self.lib_stubs:
+            self.lib_stub(self.lib_stubs[address])
+            return
+
+        cycles, kind = self.timing(uc, address, size)
+        if NVM_BASE <= address < NVM_END and (address >> 2) != self.last_fetch:
+            cycles += self.args.wait_states
+            self.last_fetch = address >> 2
+        self.charge(cycles, self.function(address))
+        if kind == 'wfi':
+            if len(self.frames) <= 1:
+                self.stop_reason = 'idle'
+                uc.emu_stop()
+                return
+            self.wait(self.args.wfi_cycles)
+        if kind in ('branch', 'call'):
+            self.pending = (address, size, kind)
+
+        for name, due in self.next_irq.items():
+            if self.now >= due and self.irq_saved is None:
+                self.next_irq[name] = due + dict(self.args.irq)[name]
+                self.stop_reason = 'irq:' + name
+                self.pending = None
+                uc.emu_stop()
+                return
+        if self.cycles >= self.args.limit:
+            self.stop_reason = 'limit'
+            uc.emu_stop()
+
+    def on_read(self, uc, _access, address, size, _value, _):
+        if not any(lo <= address < hi for lo, hi in REGISTER_WINDOWS):
+            if NVM_BASE <= address < NVM_END and (address >> 2) != self.last_fetch:
+                self.charge(self.args.wait_states)
+            return
+        pc = uc.reg_read(self.regs['pc'])
+        prev_pc, prev_address, count = self.reads
+        count = count + 1 if (pc, address) == (prev_pc, prev_address) else 1
+        if count >= BUSY_WAIT_READS:
+            value = int.from_bytes(uc.mem_read(address, size), 'little')
+            uc.mem_write(address, ((~value) & ((1 << (8 * size)) - 1)).to_bytes(size, 'little'))
+            self.busy_waits['%s @0x%08x' % (self.function(pc), address)] += 1
+            count = 0
+        self.reads = (pc, address, count)
+
+    def on_write(self, uc, _access, address, _size, value, _):
+        if address == HB_SWITCH_REG:
+            self.plant.advance(self.now)
+            # bit 1 HS1, bit 2 HS2, bit 3 LS1, bit 4 LS2
+            self.plant.switches = (bool(value & 0x02), bool(value & 0x08), bool(value & 0x04), bool(value & 0x10))
+
+    def function(self, address):
+        return self.nvm.function_at(address)
+
+    def timing(self, uc, address, size):
+        if address not in self.decoded:
+            raw = bytes(uc.mem_read(address, 4))
+            hw1, hw2 = struct.unpack('<HH', raw)
+            self.decoded[address] = instruction_timing(hw1, hw2, self.args.mul_cycles)
+        return self.decoded[address]
+
+    # -- stubs
+
+    def arg(self, n):
+        return self.uc.reg_read(self.regs['r%d' % n])
+
+    def result(self, value):
+        self.uc.reg_write(self.regs['r0'], value & 0xffffffff)
+
+    def rom_stub(self, name):
+        cycles = self.args.rom_cycles
+        self.plant.advance(self.now)
+        result = 0
+        if name == 'set_hb_switch':
+            self.plant.switches = tuple(bool(self.arg(i) & 0xff) for i in range(4))
+        elif name == 'single_shot_systick':
+            self.charge(cycles, 'rom:' + name)
+            self.wait(self.arg(0))
+            return
+        elif name == 'config_stbtm':
+            self.stbtm = self.arg(1)
+        elif name == 'get_standby_time':
+            result = self.stbtm
+        elif name == 'request_power_saving_mode':
+            self.charge(cycles, 'rom:' + name)
+            self.wait(self.stbtm * XTAL // 32768)
+            return
+        elif name in ('get_nfc_value', 'sense_sh'):
+            cycles += self.args.conversion_cycles
+            result = min(int(self.plant.vcchb * 1024), 8191)
+        elif name == 'get_adc_irq':
+            result = 1
+        elif name == 'calc_div':
+            op1, op2, fmt, res = (self.arg(i) for i in range(4))
+            signed = lambda v: v - (1 << 32) if v & 0x80000000 else v
+            num = signed(op1) if fmt in (2, 3) else op1
+            den = signed(op2) if fmt in (1, 3) else op2
+            result = 0 if den == 0 else (int(num / den) if res == 0 else num - int(num / den) * den)
+        self.charge(cycles, 'rom:' + name)
+        self.result(result)
+
+    def lib_stub(self, name):
+        cycles = self.args.lib_cycles
+        self.plant.advance(self.now)
+        result = 0
+        if name == 'get_nfc_value_ext':
+            cycles += self.args.conversion_cycles
+            result = self.plant.pin_digits(self.arg(0))
+        elif name in ('sys_tim_singleshot', 'sys_tim_singleshot_32'):
+            self.charge(cycles, name)
+            self.wait(self.arg(1))
+            return
+        elif name == 'sys_tim_cyclic_cascaded':
+            self.clock_start = self.now
+        elif name == 'sys_tim_cyclic_cascaded_stop':
+            self.clock_value = (self.now - self.clock_start) if self.clock_start is not None else 0
+            self.clock_start = None
+        elif name in ('sys_tim_cyclic_cascaded_get_combined', 'sys_tim_cyclic_cascaded_get_upper'):
+            result = (self.now - self.clock_start) if self.clock_start is not None else self.clock_value
+            result = result >> 16 if name.endswith('upper') else result
+        elif name == 'vclamp_get':
+            result = self.vclamp
+        elif name == 'vclamp_set':
+            self.vclamp = self.arg(0)
+        elif name == 'check_rf_field':
+            result = 1
+        self.charge(cycles, name)
+        self.result(result)
+
+
+# NVM library functions modelled instead of executed (their cost is an estimate, see --lib-cycles)
+LIB_MODELS = [
+    'get_nfc_value_ext', 'sys_tim_singleshot', 'sys_tim_singleshot_32', 'sys_tim_cyclic_cascaded',
+    'sys_tim_cyclic_cascaded_stop', 'sys_tim_cyclic_cascaded_get_combined', 'sys_tim_cyclic_cascaded_get_upper',
+    'sys_tim_close', 'shc_init', 'shc_close', 'vclamp_get', 'vclamp_set', 'check_rf_field',
+    'switch_on_nvm_lib', 'switch_off_nvm_lib',
+]
+
+
+# ---- output
+
+def flame_graph(folded, path, title):
+    """Write a flame graph of folded stacks as a self-contained SVG."""
+    root = {}
+    total = sum(folded.values())
+    for stack, cycles in folded.items():
+        node = root
+        for name in stack.split(';'):
+            entry = node.setdefault(name, [0, {}])
+            entry[0] += cycles
+            node = entry[1]
+
+    def depth(node):
+        return 1 + max((depth(child[1]) for child in node.values()), default=0)
+
+    width, row = 1200.0, 16
+    levels = depth(root)
+    height = (levels + 2) * row
+    out = ['<svg xmlns="http://www.w3.org/2000/svg" width="%d" height="%d" font-family="monospace" '
+           'font-size="11">' % (width, height),
+           '<text x="4" y="12">%s: %d cycles</text>' % (html.escape(title), total)]
+
+    def draw(node, x, level):
+        for name, (cycles, children) in sorted(node.items()):
+            w = width * cycles / total if total else 0
+            y = height - (level + 1) * row
+            hue = sum(map(ord, name)) % 60
+            label = html.escape(name)
+            out.append('<g><title>%s: %d cycles (%.1f%%)</title><rect x="%.1f" y="%d" width="%.1f" height="%d" '
+                       'fill="hsl(%d,80%%,60%%)" stroke="white"/>' % (label, cycles, 100.0 * cycles / total, x, y,
+                                                                     w, row - 1, hue))
+            if w > 40:
+                out.append('<text x="%.1f" y="%d">%s</text>' % (x + 2, y + row - 4, label[:int(w / 7)]))
+            out.append('</g>')
+            draw(children, x, level + 1)
+            x += w
+
+    draw(root, 0.0, 0)
+    out.append('</svg>')
+    with open(path, 'w') as f:
+        f.write('\n'.join(out) + '\n')
+
+
+def report(p, out):
+    total = p.cycles
+    print('stop: %s after %d CPU cycles (%.3f ms) and %d cycles of waits (%.3f ms)' %
+          (p.stop_reason, total, total * 1e3 / XTAL, p.sleep, p.sleep * 1e3 / XTAL))
+    print()
+    print('%-40s %8s %12s %12s %10s %10s %6s' % ('function', 'calls', 'self', 'inclusive', 'mean/call',
+                                                'max/call', 'self%'))
+    names = set(p.self_cycles) | set(p.calls)
+    for name in sorted(names, key=lambda n: -max(p.inclusive[n], p.self_cycles[n])):
+        calls = p.calls[name]
+        print('%-40s %8d %12d %12d %10s %10s %5.1f%%' % (
+            name[:40], calls, p.self_cycles[name], p.inclusive[name],
+            '%.0f' % (p.inclusive[name] / calls) if calls else '-', p.max_call[name] if calls else '-',
+            100.0 * p.self_cycles[name] / total if total else 0.0))
+    loops = [n for n in p.iterations if n > 0]
+    if loops:
+        loops.sort()
+        print()
+        print('CPU cycles between two waits (loop iterations): %d, mean %.0f, median %d, max %d (%.1f us)' %
+              (len(loops), sum(loops) / len(loops), loops[len(loops) // 2], loops[-1], loops[-1] * 1e6 / XTAL))
+    for name, count in sorted(p.busy_waits.items()):
+        print('busy wait broken %d times: %s' % (count, name))
+
+    os.makedirs(os.path.dirname(os.path.abspath(out)), exist_ok=True)
+    with open(out + '.folded', 'w') as f:
+        for stack, cycles in sorted(p.folded.items()):
+            f.write('%s %d\n' % (stack, cycles))
+    flame_graph(p.folded, out + '.svg', os.path.basename(out))
+    print()
+    print('written: %s.folded, %s.svg' % (out, out))
+
+
+# ---- main
+
+def parse_irq(text):
+    name, _, period = text.partition(':')
+    return name, int(period, 0)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    parser.add_argument('--nvm', required=True, help='NVM image, e.g. build/image/image_nvm.elf')
+    parser.add_argument('--rom', required=True, help='ROM image, smack_rom/build/image/image_rom.elf')
+    parser.add_argument('--rom-header', required=True, help='rom_lib.h, for the layout of the ROM jump table')
+    parser.add_argument('--entry', default='_nvm_start', help='function to run (default: _nvm_start)')
+    parser.add_argument('--out', default='build/profile/profile', help='prefix of the output files')
+    parser.add_argument('--limit', type=int, default=200 * 1000 * 1000, help='limit of CPU cycles')
+    parser.add_argument('--wait-states', type=int, default=1, help='wait states of each NVM word fetch')
+    parser.add_argument('--mul-cycles', type=int, default=1, help='cycles of MULS (1 or 32, core option)')
+    parser.add_argument('--rom-cycles', type=int, default=20, help='estimated cycles of each ROM call')
+    parser.add_argument('--lib-cycles', type=int, default=40, help='estimated cycles of each modelled NVM lib call')
+    parser.add_argument('--conversion-cycles', type=int, default=560, help='cycles of one ADC conversion')
+    parser.add_argument('--wfi-cycles', type=int, default=XTAL // 1000, help='sleep of a WFI inside a function')
+    parser.add_argument('--irq', type=parse_irq, action='append', default=[],
+                        help='inject an interrupt: FUNCTION:PERIOD_CYCLES, e.g. encoder_irq:28000')
+    parser.add_argument('--irq-overhead', type=int, default=48,
+                        help='cycles of exception entry, exit and the ROM dispatcher per interrupt')
+    parser.add_argument('--native', action='append', default=[], help='run this NVM lib function from the image')
+    parser.add_argument('--harvest-ua', type=float, default=2000.0)
+    parser.add_argument('--cap-uf', type=float, default=470.0)
+    parser.add_argument('--motor-ohm', type=float, default=200.0)
+    parser.add_argument('--clamp-mv', type=float, default=3300.0)
+    args = parser.parse_args()
+
+    try:
+        import unicorn
+        from unicorn import arm_const
+    except ImportError:
+        sys.exit('smack_profile: the Unicorn engine is needed (pip install unicorn)')
+
+    nvm = Elf(args.nvm)
+    rom = Elf(args.rom)
+    rom_names = rom_table_names(args.rom_header)
+    if 'rom_func_table' not in rom.symbols:
+        sys.exit('smack_profile: rom_func_table not found in %s' % args.rom)
+
+    uc = unicorn.Uc(unicorn.UC_ARCH_ARM, unicorn.UC_MODE_THUMB | unicorn.UC_MODE_MCLASS)
+    if hasattr(arm_const, 'UC_CPU_ARM_CORTEX_M0'):
+        uc.ctl_set_cpu_model(arm_const.UC_CPU_ARM_CORTEX_M0)
+    for base, size in MEMORY_MAP:
+        uc.mem_map(base, size, unicorn.UC_PROT_ALL)
+    for image in (rom, nvm):
+        for vaddr, data, memsz in image.segments:
+            uc.mem_write(vaddr, data + bytes(memsz - len(data)))
+
+    # ROM jump table: each entry points to a stub "BX LR", the stub is done by the code hook
+    table = rom.symbols['rom_func_table']
+    for i in range(len(rom_names)):
+        uc.mem_write(STUB_BASE + 4 * i, struct.pack('<HH', 0x4770, 0xbf00))
+        uc.mem_write(table + 4 * i, struct.pack('<I', (STUB_BASE + 4 * i) | 1))
+    uc.mem_write(MAGIC_RETURN, struct.pack('<HH', 0xe7fe, 0xbf00))
+
+    profiler = Profiler(args, uc, nvm, rom_names)
+    profiler.regs = {'r%d' % i: getattr(arm_const, 'UC_ARM_REG_R%d' % i) for i in range(13)}
+    profiler.regs.update(sp=arm_const.UC_ARM_REG_SP, lr=arm_const.UC_ARM_REG_LR, pc=arm_const.UC_ARM_REG_PC)
+    profiler.lib_stubs = {}
+    for name in LIB_MODELS:
+        if name in nvm.symbols and name not in args.native:
+            address = nvm.symbols[name] & ~1
+            uc.mem_write(address, struct.pack('<H', 0x4770))
+            profiler.lib_stubs[address] = name
+    for name, _ in args.irq:
+        if name not in nvm.symbols:
+            sys.exit('smack_profile: interrupt handler %s not found' % name)
+
+    uc.hook_add(unicorn.UC_HOOK_CODE, profiler.on_code)
+    uc.hook_add(unicorn.UC_HOOK_MEM_READ, profiler.on_read)
+    uc.hook_add(unicorn.UC_HOOK_MEM_WRITE, profiler.on_write)
+
+    entry = nvm.symbols[args.entry]
+    stack_top = nvm.symbols.get('__StackTop', 0x00022000)
+    uc.reg_write(arm_const.UC_ARM_REG_SP, stack_top)
+    uc.reg_write(arm_const.UC_ARM_REG_LR, MAGIC_RETURN | 1)
+    profiler.push(args.entry, MAGIC_RETURN)
+    pc = entry | 1
+    while True:
+        profiler.stop_reason = None
+        try:
+            uc.emu_start(pc, 0xffffffff)
+        except unicorn.UcError as error:
+            profiler.stop_reason = 'fault at 0x%08x: %s' % (uc.reg_read(arm_const.UC_ARM_REG_PC), error)
+        reason = profiler.stop_reason or 'stopped'
+        pc = uc.reg_read(arm_const.UC_ARM_REG_PC) | 1
+
+        if reason.startswith('irq:'):
+            # call the handler like the ROM dispatcher, with the registers saved
+            name = reason[4:]
+            profiler.irq_saved = ({r: uc.reg_read(v) for r, v in profiler.regs.items()}, list(profiler.frames))
+            profiler.charge(args.irq_overhead, 'irq')
+            profiler.push(name, MAGIC_RETURN)
+            uc.reg_write(arm_const.UC_ARM_REG_SP, (uc.reg_read(arm_const.UC_ARM_REG_SP) - 32) & ~7)
+            uc.reg_write(arm_const.UC_ARM_REG_LR, MAGIC_RETURN | 1)
+            pc = nvm.symbols[name] | 1
+            continue
+        if reason == 'irq_return' and profiler.irq_saved is not None:
+            saved, frames = profiler.irq_saved
+            profiler.irq_saved = None
+            while len(profiler.frames) > len(frames):
+                profiler.pop()
+            for r, v in saved.items():
+                uc.reg_write(profiler.regs[r], v)
+            pc = saved['pc'] | 1
+            continue
+        profiler.stop_reason = reason
+        break
+
+    while profiler.frames:
+        profiler.pop()
+    report(profiler, args.out)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,306 @@
+#!/usr/bin/env python3
+# ============================================================================
+# Copyright (c) 2021 Infineon Technologies AG
+#               All rights reserved.
+#               www.infineon.com
+# ============================================================================
+#
+# ============================================================================
+# Redistribution and use of this software only permitted to the extent
+# expressly agreed with Infineon Technologies AG.
+# ============================================================================
+
+"""Code size and section budget report of the NVM image.
+
+Reads the ELF file and the linker map of image_nvm.elf and reports:
+- the use of each memory region (Memory Configuration of the map), with the
+  NVM counted at the load addresses, so the initial values of .data count in
+  the NVM as well as in the RAM;
+- the output sections of Linker_config.ld (.version, .aparam, .text, .data,
+  ...);
+- the size per category (text, rodata, data, ram_code, bss, config, aparams,
+  version);
+- the size per object file;
+- the size per function and data object (symbol table of the ELF file).
+
+With --baseline, each figure is compared with a report saved earlier with
+--save. The exit code is 1 when a budget (--budget) or a memory region is
+exceeded.
+
+Budgets are NAME=BYTES, where NAME is a region (nvm, ram, ...) or a category
+(text, rodata, ram_code, ...). BYTES may end in K.
+"""
+
+import argparse
+import collections
+import json
+import os
+import re
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from smack_profile import Elf   # noqa: E402
+
+SHF_ALLOC = 0x2
+SHT_NOBITS = 8
+
+# category of the input sections, by output section and input section name
+OUTPUT_CATEGORIES = {
+    '.version': 'version',
+    '.aparam': 'aparams',
+    '.nvm_config': 'config',
+    '.data': 'data',
+    '.ram_code': 'ram_code',
+    '.bss': 'bss',
+    '.ram2': 'bss',
+    '.noinit': 'bss',
+}
+CATEGORIES = ('text', 'rodata', 'data', 'ram_code', 'bss', 'config', 'aparams', 'version')
+# categories stored in the NVM (.data and .ram_code as their initial values)
+NVM_CATEGORIES = ('text', 'rodata', 'data', 'ram_code', 'config')
+# output sections that reserve memory without content of the firmware
+RESERVED = ('.dparam', '.data_romcode', '.ram2_dma', '.heap', '.stack', '.text.pad2')
+
+
+# ---- inputs
+
+def parse_map(path):
+    """Memory regions and input sections of a GNU ld map file.
+
+    Returns (regions, inputs): regions is a list of (name, origin, length), inputs a list of
+    (output section, input section, address, size, object file).
+    """
+    regions = []
+    inputs = []
+    with open(path, encoding='latin-1') as f:
+        lines = f.read().splitlines()
+
+    i = 0
+    while i < len(lines) and not lines[i].startswith('Memory Configuration'):
+        i += 1
+    for line in lines[i + 1:]:
+        if line.startswith('Linker script and memory map'):
+            break
+        m = re.match(r'(\S+)\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)', line)
+        if m and m.group(1) not in ('Name', '*default*'):
+            regions.append((m.group(1), int(m.group(2), 16), int(m.group(3), 16)))
+
+    while i < len(lines) and not lines[i].startswith('Linker script and memory map'):
+        i += 1
+    output = None
+    pending = None      # input section name on a line of its own (long names are wrapped)
+    for line in lines[i + 1:]:
+        m = re.match(r'(\.\S+)(?:\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+))?', line)
+        if m:
+            output = m.group(1)
+            continue
+        m = re.match(r' (\S+)\s*$', line)
+        if m and not m.group(1).startswith('0x'):
+            pending = m.group(1)
+            continue
+        m = re.match(r' (\S+)?\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S.*)$', line)
+        if m and output is not None:
+            name = m.group(1) or pending
+            if name and name != '*fill*' and not name.startswith('*('):
+                inputs.append((output, name, int(m.group(2), 16), int(m.group(3), 16), m.group(4).strip()))
+        pending = None
+    return regions, inputs
+
+
+def category(output, section):
+    """Category of an input section."""
+    if output in OUTPUT_CATEGORIES:
+        return OUTPUT_CATEGORIES[output]
+    if section.startswith('.rodata'):
+        return 'rodata'
+    return 'text'
+
+
+def object_name(path):
+    """Object file of a map line, archive members as archive(member)."""
+    m = re.match(r'(.*?)\((.*)\)$', path)
+    if m:
+        return '%s(%s)' % (os.path.basename(m.group(1)), m.group(2))
+    return os.path.basename(path)
+
+
+def load_segments(elf):
+    """(vaddr, paddr, filesz) of the PT_LOAD segments: the load address of each section."""
+    import struct
+    _, phoff, _, _, _, phentsize, phnum = struct.unpack_from('<IIIIHHH', elf.data, 24)[:7]
+    segments = []
+    for i in range(phnum):
+        p_type, _, p_vaddr, p_paddr, p_filesz, _, _, _ = struct.unpack_from('<IIIIIIII', elf.data,
+                                                                            phoff + i * phentsize)
+        if p_type == 1:
+            segments.append((p_vaddr, p_paddr, p_filesz))
+    return segments
+
+
+def collect(elf_path, map_path):
+    """The figures of the report, as stored in a baseline."""
+    elf = Elf(elf_path)
+    regions, inputs = parse_map(map_path)
+    segments = load_segments(elf)
+
+    sections = collections.OrderedDict()
+    placement = []      # (address, size) of the allocated memory, at run time and at load time
+    for index, (_, sh_type, sh_flags, sh_addr, _, sh_size, _, _, _, _) in enumerate(elf.sections):
+        name = elf.section_names[index]
+        if not (sh_flags & SHF_ALLOC) or sh_size == 0:
+            continue
+        lma = sh_addr
+        if sh_type != SHT_NOBITS:
+            for vaddr, paddr, filesz in segments:
+                if vaddr <= sh_addr < vaddr + filesz:
+                    lma = paddr + (sh_addr - vaddr)
+        sections[name] = {'address': sh_addr, 'load': lma, 'size': sh_size,
+                          'content': sh_type != SHT_NOBITS}
+        if name in RESERVED:
+            continue
+        placement.append((sh_addr, sh_size))
+        if sh_type != SHT_NOBITS and lma != sh_addr:
+            placement.append((lma, sh_size))
+
+    used = collections.OrderedDict()
+    for name, origin, length in regions:
+        used[name.lower()] = {'origin': origin, 'length': length,
+                              'used': sum(size for address, size in placement if origin <= address < origin + length)}
+
+    categories = collections.Counter()
+    objects = collections.defaultdict(collections.Counter)
+    for output, section, _, size, path in inputs:
+        if output in RESERVED or size == 0:
+            continue
+        kind = category(output, section)
+        categories[kind] += size
+        objects[object_name(path)][kind] += size
+
+    symbols = {}
+    for _, size, name in elf.functions:
+        if size:
+            symbols[name] = {'kind': 'function', 'size': size}
+    for _, size, name in elf.objects:
+        symbols[name] = {'kind': 'object', 'size': size}
+
+    return {'regions': used, 'sections': sections, 'categories': dict(categories),
+            'objects': {name: dict(sizes) for name, sizes in objects.items()}, 'symbols': symbols}
+
+
+# ---- report
+
+def delta(value, base):
+    if base is None:
+        return ''
+    return '%+d' % (value - base) if value != base else ''
+
+
+def parse_size(text):
+    text = text.strip().upper()
+    return int(text[:-1], 0) * 1024 if text.endswith('K') else int(text, 0)
+
+
+def report(data, baseline, budgets, top):
+    base = baseline or {}
+    failures = []
+
+    print('%-10s %10s %8s %8s %8s %6s %8s %8s' % ('region', 'origin', 'length', 'used', 'free', 'used%',
+                                                   'budget', 'diff'))
+    for name, region in data['regions'].items():
+        budget = budgets.get(name)
+        old = base.get('regions', {}).get(name, {}).get('used')
+        print('%-10s 0x%08x %8d %8d %8d %5.1f%% %8s %8s' % (
+            name, region['origin'], region['length'], region['used'], region['length'] - region['used'],
+            100.0 * region['used'] / region['length'] if region['length'] else 0.0,
+            budget if budget is not None else '-', delta(region['used'], old)))
+        if region['used'] > region['length']:
+            failures.append('region %s overflowed: %d of %d bytes' % (name, region['used'], region['length']))
+        if budget is not None and region['used'] > budget:
+            failures.append('region %s over budget: %d of %d bytes' % (name, region['used'], budget))
+
+    print()
+    print('%-16s %10s %10s %8s %8s' % ('section', 'address', 'load', 'size', 'diff'))
+    for name, section in data['sections'].items():
+        old = base.get('sections', {}).get(name, {}).get('size')
+        print('%-16s 0x%08x 0x%08x %8d %8s' % (name, section['address'], section['load'], section['size'],
+                                               delta(section['size'], old)))
+
+    print()
+    print('%-10s %8s %8s %8s' % ('category', 'size', 'budget', 'diff'))
+    for name in CATEGORIES:
+        size = data['categories'].get(name, 0)
+        budget = budgets.get(name)
+        print('%-10s %8d %8s %8s' % (name, size, budget if budget is not None else '-',
+                                     delta(size, base.get('categories', {}).get(name, 0) if baseline else None)))
+        if budget is not None and size > budget:
+            failures.append('%s over budget: %d of %d bytes' % (name, size, budget))
+    for name in budgets:
+        if name not in data['regions'] and name not in CATEGORIES:
+            failures.append('budget of unknown region or category: %s' % name)
+
+    print()
+    print('%-40s %7s %7s %7s %7s %7s %7s %8s' % ('object', 'text', 'rodata', 'data', 'ram_code', 'bss', 'nvm',
+                                                  'diff'))
+    nvm = lambda sizes: sum(sizes.get(k, 0) for k in NVM_CATEGORIES)
+    old_objects = base.get('objects', {})
+    for name, sizes in sorted(data['objects'].items(), key=lambda item: -nvm(item[1])):
+        print('%-40s %7d %7d %7d %7d %7d %7d %8s' % (
+            name[-40:], sizes.get('text', 0), sizes.get('rodata', 0), sizes.get('data', 0), sizes.get('ram_code', 0),
+            sizes.get('bss', 0), nvm(sizes), delta(nvm(sizes), nvm(old_objects.get(name, {})) if baseline else None)))
+    for name in sorted(set(old_objects) - set(data['objects'])):
+        print('%-40s %7s %7s %7s %7s %7s %7s %8s' % (name[-40:], '-', '-', '-', '-', '-', '-',
+                                                '%+d' % -nvm(old_objects[name])))
+
+    print()
+    print('%-40s %-8s %7s %8s' % ('symbol', 'kind', 'size', 'diff'))
+    old_symbols = base.get('symbols', {})
+    ranked = sorted(data['symbols'].items(), key=lambda item: -item[1]['size'])
+    changed = {name for name, symbol in data['symbols'].items()
+               if baseline and symbol['size'] != old_symbols.get(name, {}).get('size', 0)}
+    for index, (name, symbol) in enumerate(ranked):
+        if index < top or name in changed:
+            print('%-40s %-8s %7d %8s' % (name[:40], symbol['kind'], symbol['size'],
+                                          delta(symbol['size'], old_symbols.get(name, {}).get('size', 0)
+                                                if baseline else None)))
+    for name in sorted(set(old_symbols) - set(data['symbols'])):
+        print('%-40s %-8s %7s %8s' % (name[:40], old_symbols[name]['kind'], '-',
+                                      '%+d' % -old_symbols[name]['size']))
+
+    if failures:
+        print()
+        for failure in failures:
+            print('error: ' + failure)
+    return not failures
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    parser.add_argument('--elf', required=True, help='NVM image, e.g. build/image/image_nvm.elf')
+    parser.add_argument('--map', required=True, help='linker map of the NVM image')
+    parser.add_argument('--baseline', help='report saved with --save to compare with (ignored if missing)')
+    parser.add_argument('--save', help='save the figures as a baseline')
+    parser.add_argument('--budget', action='append', default=[], help='NAME=BYTES, e.g. nvm=56K')
+    parser.add_argument('--top', type=int, default=20, help='number of the largest symbols listed')
+    args = parser.parse_args()
+
+    budgets = {}
+    for text in args.budget:
+        for item in text.split():
+            name, _, size = item.partition('=')
+            budgets[name.lower()] = parse_size(size)
+
+    data = collect(args.elf, args.map)
+    baseline = None
+    if args.baseline and os.path.exists(args.baseline):
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+    ok = report(data, baseline, budgets, args.top)
+    if args.save:
+        os.makedirs(os.path.dirname(os.path.abspath(args.save)), exist_ok=True)
+        with open(args.save, 'w') as f:
+            json.dump(data, f, indent=1, sort_keys=True)
+    sys.exit(0 if ok else 1)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,185 @@
+/* ============================================================================
+** Copyright (c) 2021 Infineon Technologies AG
+**               All rights reserved.
+**               www.infineon.com
+** ============================================================================
+**
+** ============================================================================
+** Redistribution and use of this software only permitted to the extent
+** expressly agreed with Infineon Technologies AG.
+** ============================================================================
+*
+*/
+
+/** @file     adc_capture.c
+ *  @brief    Timer triggered capture of the VCCHB voltage and the motor current
+ *
+ *  The comparator used by the stepwise motor operation delivers a single bit per query, and each query is done in
+ *  software after a fixed sleep of several milliseconds. This module lets the hardware do the timing instead: one
+ *  channel of the system timer issues an EV_ADC_TRIG_SH0_SH1 event on the event bus in each period, which triggers
+ *  both sample & hold stages of the sense unit. With "auto arm" enabled, the stages are armed again by hardware after
+ *  each conversion, so no CPU interaction is needed to keep the sampling going.
+ *  When SH1 (which is converted after SH0) has finished, the ADC interrupt is raised. The ROM handler serve_adc_irq()
+ *  forwards it to adc_capture_irq() (installed in the aparams), which copies both results into a ring buffer.
+ *
+ *  The ring buffer is a single producer (interrupt) / single consumer (main loop) queue: the interrupt only writes
+ *  "head", the main loop only writes "tail". Both indices are free running 16 bit counters which are written with a
+ *  single store, so no locking is needed. If the buffer is full, the newest sample is dropped and counted.
+ */
+
+// standard libs
+// included by core_cm0.h: #include <stdint.h>
+#include "core_cm0.h"
+#include <stdbool.h>
+
+// Smack ROM lib
+#include "rom_lib.h"
+#include "hal_api.h"
+
+// Smack stepwise project
+#include "settings.h"
+#include "power_domain.h"
+#include "adc_capture.h"
+
+
+#if (ADC_CAPTURE_BUFFER_SIZE & (ADC_CAPTURE_BUFFER_SIZE - 1)) != 0
+#error "ADC_CAPTURE_BUFFER_SIZE must be a power of 2"
+#endif
+
+
+static adc_sample_t adc_buffer[ADC_CAPTURE_BUFFER_SIZE];
+static volatile uint16_t adc_head;          // written by interrupt only
+static volatile uint16_t adc_tail;          // written by main loop only
+static volatile uint16_t adc_seq;
+static volatile uint32_t adc_overrun;
+static volatile bool adc_active;
+
+
+void adc_capture_start(const uint16_t period)
+{
+    const sys_tim_config_struct_t tim_cfg =
+    {
+        .enable        = true,
+        .start_control = sys_tim_event,
+        .stop_control  = sys_tim_event,
+        .en_start      = false,
+        .en_stop       = false,
+        .tim_mode      = sys_tim_continous,
+        .chain         = false,
+    };
+    uint8_t irq;
+
+    adc_head = 0;
+    adc_tail = 0;
+    adc_seq = 0;
+    adc_overrun = 0;
+
+    /* Power up the parts of the sense unit which are needed: ADC and both sample & hold stages, plus the current to
+     * voltage converter feeding SH1. The clock of the sense unit is not switched on by the power up.
+     */
+#if defined POWER_MANAGER_ENABLE && POWER_MANAGER_ENABLE
+    power_acquire(power_domain_sense);
+#else
+    switch_on_sense();
+#endif
+    HAL_SET32(SCUC_MODULE_EN, HAL_GET32(SCUC_MODULE_EN) | SCUC_MODULE_SENSE);
+    sense_ctrl_config(sense_power_up, sense_power_up, sense_power_up, sense_power_down, sense_power_up,
+                      sense_power_down, sense_power_down, sense_power_down, sense_disable);
+
+    sense_sh_config(sample_hold0, ADC_CAPTURE_VCCHB_AIN, i2v_sel_ain, sense_enable);
+    sense_sh_config(sample_hold1, STALL_I2V_AIN, i2v_sel_i2v, sense_enable);
+
+    /* SH0 and SH1 are sampled simultaneously and converted sequentially, so the event of SH1 tells that both results
+     * are available. Route it to the ADC interrupt.
+     */
+    irq = get_adc_irq();
+    HAL_SET32(SENSE_SH1_EVT_CFG, (HAL_GET32(SENSE_SH1_EVT_CFG) & 0xffff0000UL) | irq | SENSE_EVT_IRQ_EN);
+    adc_active = true;
+    NVIC_EnableIRQ((IRQn_Type)irq);
+
+    // the trigger timer runs continuously and issues the trigger event on every wraparound
+    sys_tim_chn_cfg(&tim_cfg, TIMER_ADC_TRIGGER);
+    set_sys_tim_chn_period(period, TIMER_ADC_TRIGGER);
+    sys_tim_chn_evnt_cfg(0, NO_INT, EV_ADC_TRIG_SH0_SH1, 0, TIMER_ADC_TRIGGER);
+    sys_tim_chn_control(sys_tim_start, TIMER_ADC_TRIGGER);
+}
+
+
+void adc_capture_stop(void)
+{
+    sys_tim_chn_control(sys_tim_stop, TIMER_ADC_TRIGGER);
+    sys_tim_chn_evnt_cfg(0, NO_INT, NO_ADC, 0, TIMER_ADC_TRIGGER);
+
+    adc_active = false;
+    HAL_SET32(SENSE_SH1_EVT_CFG, HAL_GET32(SENSE_SH1_EVT_CFG) & 0xffff0000UL);
+
+    sense_sh_config(sample_hold0, ADC_CAPTURE_VCCHB_AIN, i2v_sel_ain, sense_disable);
+    sense_sh_config(sample_hold1, STALL_I2V_AIN, i2v_sel_i2v, sense_disable);
+    HAL_SET32(SCUC_MODULE_EN, HAL_GET32(SCUC_MODULE_EN) & ~SCUC_MODULE_SENSE);
+#if defined POWER_MANAGER_ENABLE && POWER_MANAGER_ENABLE
+    power_release(power_domain_sense);
+#else
+    switch_off_sense();
+#endif
+}
+
+
+RAM_CODE bool adc_capture_read(adc_sample_t* sample)
+{
+    uint16_t tail = adc_tail;
+
+    if (tail == adc_head)
+    {
+        return false;
+    }
+
+    *sample = adc_buffer[tail & (ADC_CAPTURE_BUFFER_SIZE - 1)];
+
+    // the copy must be complete before the slot is handed back to the interrupt
+    __DMB();
+    adc_tail = tail + 1;
+
+    return true;
+}
+
+
+uint32_t adc_capture_overruns(void)
+{
+    return adc_overrun;
+}
+
+
+RAM_CODE void adc_capture_irq(void)
+{
+    adc_sample_t* slot;
+    uint16_t head;
+    uint32_t vcchb;
+
+    /* The ADC interrupt is also used by the blocking conversions of the ROM library (e.g. get_nfc_value()). Those
+     * only need the CPU to wake up from WFI, so there is nothing to do here unless our capture is running.
+     */
+    if (!adc_active || ((HAL_GET32(SENSE_SH1_STATUS) & SENSE_STATUS_DONE) == 0))
+    {
+        return;
+    }
+
+    head = adc_head;
+    adc_seq++;
+
+    if ((uint16_t)(head - adc_tail) >= ADC_CAPTURE_BUFFER_SIZE)
+    {
+        adc_overrun++;
+        return;
+    }
+
+    vcchb = HAL_GET32(SENSE_SH0_RESULT) & SENSE_RESULT_MASK;
+
+    slot = &adc_buffer[head & (ADC_CAPTURE_BUFFER_SIZE - 1)];
+    slot->vcchb = (uint16_t)((vcchb * (ADC_CAPTURE_VCCHB_SCALE)) >> 10);
+    slot->current = (uint16_t)(HAL_GET32(SENSE_SH1_RESULT) & SENSE_RESULT_MASK);
+    slot->seq = adc_seq;
+
+    // publish the sample only after it has been written completely
+    __DMB();
+    adc_head = head + 1;
+}
@@ -0,0 +1,110 @@
+/* ============================================================================
+** Copyright (c) 2021 Infineon Technologies AG
+**               All rights reserved.
+**               www.infineon.com
+** ============================================================================
+**
+** ============================================================================
+** Redistribution and use of this software only permitted to the extent
+** expressly agreed with Infineon Technologies AG.
+** ============================================================================
+*
+*/
+
+/** @file     bemf_estimate.c
+ *  @brief    Estimation of the motor movement while coasting from its back EMF
+ *
+ *  After the motor has been switched off, it keeps turning for a while from the kinetic energy of its rotating
+ *  parts. The fixed MOTOR_START_CORRECTION accounts for this movement with a constant, but the actual amount depends
+ *  on the speed at switch off, on the load and on the temperature.
+ *  While coasting, the motor acts as a generator with a voltage (back EMF) proportional to its speed. In the "off"
+ *  state, the top switch of one output is closed (MA when moving forward, MB when moving backward) and the other
+ *  output is open, so no current flows and the voltage between the outputs is the back EMF. Integrating it over
+ *  time gives the movement, expressed in the unit of the stepwise operation: the time the motor would have to run at
+ *  nominal speed (back EMF BEMF_NOMINAL) for the same movement.
+ *
+ *  The movement of a coasting phase is known only after it has ended, but the motor runtime of the next step has
+ *  to be planned when the motor is switched on. So the movement of the coasting phases measured so far is used as a
+ *  prediction, and the accumulated runtime is corrected by the difference when the measurement is done.
+ */
+
+// standard libs
+// included by core_cm0.h: #include <stdint.h>
+#include "core_cm0.h"
+#include <stdbool.h>
+
+// Smack stepwise project
+#include "settings.h"
+#include "voltage_measure.h"
+#include "filter.h"
+#include "bemf_estimate.h"
+
+
+#if defined ADC_CAPTURE_ENABLE && ADC_CAPTURE_ENABLE && defined BEMF_ESTIMATE_ENABLE && BEMF_ESTIMATE_ENABLE
+#error "BEMF_ESTIMATE_ENABLE needs the comparator path, which cannot be used together with ADC_CAPTURE_ENABLE"
+#endif
+
+static uint32_t bemf_prediction;    // expected movement of next coasting phase (ticks)
+static uint32_t bemf_travel;        // movement of current coasting phase so far (ticks)
+static uint32_t bemf_time;          // time of last sample
+static uint32_t bemf_last;          // speed at last sample (Q8, relative to nominal speed)
+static bool     bemf_measured;      // at least one coasting phase has been measured
+static shc_channel_t bemf_top;      // H bridge output connected to VCCHB while coasting
+static shc_channel_t bemf_bottom;   // open H bridge output
+
+
+void bemf_init(const uint32_t predicted, const shc_channel_t top)
+{
+    bemf_prediction = predicted;
+    bemf_measured = false;
+    bemf_top = top;
+    bemf_bottom = (top == shc_channel_ma) ? shc_channel_mb : shc_channel_ma;
+}
+
+
+RAM_CODE uint32_t bemf_predicted(void)
+{
+    return bemf_prediction;
+}
+
+
+RAM_CODE void bemf_start(const uint32_t now)
+{
+    bemf_travel = 0;
+    bemf_time = now;
+
+    // at switch off, the motor runs at about nominal speed; the first sample corrects this
+    bemf_last = 256;
+}
+
+
+RAM_CODE bool bemf_update(const uint32_t now)
+{
+    uint16_t hi, lo;
+    uint32_t speed;
+
+    hi = voltage_measure(bemf_top);
+    lo = voltage_measure(bemf_bottom);
+
+    // back EMF as a fraction of the back EMF at nominal speed (Q8); the motor does not reverse while coasting
+    speed = (hi > lo) ? filter_udiv((uint32_t)(hi - lo) << 8, BEMF_NOMINAL) : 0;
+
+    // trapezoidal integration of speed over time
+    bemf_travel += ((bemf_last + speed) * ((now - bemf_time) >> 1)) >> 8;
+    bemf_time = now;
+    bemf_last = speed;
+
+    return (hi > lo) && ((uint16_t)(hi - lo) > (BEMF_THRESHOLD));
+}
+
+
+RAM_CODE int32_t bemf_finish(void)
+{
+    int32_t correction = (int32_t)bemf_travel - (int32_t)bemf_prediction;
+
+    // the next prediction is the average of the measured phases (IIR, 1/2); the first measurement replaces the guess
+    bemf_prediction = bemf_measured ? ((bemf_prediction + bemf_travel) >> 1) : bemf_travel;
+    bemf_measured = true;
+
+    return correction;
+}
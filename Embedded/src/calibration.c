@@ -0,0 +1,271 @@
+/* ============================================================================
+** Copyright (c) 2021 Infineon Technologies AG
+**               All rights reserved.
+**               www.infineon.com
+** ============================================================================
+**
+** ============================================================================
+** Redistribution and use of this software only permitted to the extent
+** expressly agreed with Infineon Technologies AG.
+** ============================================================================
+*
+*/
+
+/** @file     calibration.c
+ *  @brief    Calibration of the motor start correction from measured steps
+ *
+ *  Each start of the motor adds some movement that does not depend on the runtime of the step: the motor coasts
+ *  after it has been switched off, and it loses some movement while spinning up. MOTOR_START_CORRECTION accounts for
+ *  this with a constant which has to be characterized on the bench, although it varies from motor to motor.
+ *  The calibration drives CALIBRATION_STEPS single steps with runtimes evenly spread between CALIBRATION_STEP_MIN
+ *  and CALIBRATION_STEP_MAX, each from a fully charged capacitor, and counts the encoder pulses of each step
+ *  including the coasting. The movement is modelled as pulses = slope * (runtime + correction), and the line is
+ *  fitted to the steps by least squares. The correction is its intercept with the runtime axis, in milliseconds.
+ *
+ *  The results of both directions are stored in an NVM page of their own (section .nvm.config, see
+ *  Linker_config.ld) and replace MOTOR_START_CORRECTION and MOTOR_START_CORRECTION_BACKWARD from then on. Flashing
+ *  the firmware again erases the page, so the motor has to be calibrated again afterwards.
+ *  The calibration is started by the NFC reader through DP_MOTION_COMMAND and reports its result in
+ *  calibration_status.
+ */
+
+// standard libs
+// included by core_cm0.h: #include <stdint.h>
+#include "core_cm0.h"
+#include <stdbool.h>
+
+// Smack ROM lib
+#include "rom_lib.h"
+
+// Smack NVM lib
+#include "sys_tim_lib.h"
+#include "shc_lib.h"
+
+// Smack stepwise project
+#include "settings.h"
+#include "smack_stepwise.h"
+#include "voltage_measure.h"
+#include "filter.h"
+#include "encoder.h"
+#include "step_end.h"
+#include "hb_switch.h"
+#include "power_domain.h"
+#include "calibration.h"
+
+
+#if defined CALIBRATION_ENABLE && CALIBRATION_ENABLE
+
+#if !(defined ENCODER_ENABLE && ENCODER_ENABLE)
+#error "CALIBRATION_ENABLE measures the movement with the encoder and needs ENCODER_ENABLE"
+#endif
+
+#if (CALIBRATION_STEPS < 2) || (CALIBRATION_STEPS > 8) || (CALIBRATION_STEP_MAX > 1000)
+#error "CALIBRATION_STEPS must be 2...8 and CALIBRATION_STEP_MAX at most 1000ms to keep the fit within 32 bits"
+#endif
+
+
+#define CALIBRATION_VALID   0x43414c31UL    // "CAL1", the page holds calibration results
+#define CALIBRATION_ERASED  0xffffffffUL    // erased NVM, direction not calibrated
+
+/**
+ * @brief calibration results stored in NVM
+ */
+typedef struct calibration_nvm_s
+{
+    uint32_t valid;                 //!< CALIBRATION_VALID if the page has been programmed by calibration_store()
+    uint32_t start_correction[2];   //!< start correction of each direction (milliseconds), CALIBRATION_ERASED if not calibrated
+} calibration_nvm_t;
+
+// NVM page holding the results; read through volatile, as it is changed by programming the NVM
+static const volatile calibration_nvm_t calibration_nvm __attribute__((section(".nvm.config"))) =
+{
+    CALIBRATION_ERASED, { CALIBRATION_ERASED, CALIBRATION_ERASED }
+};
+
+
+calibration_status_t calibration_status;
+
+
+/** @brief Store the start correction of a direction in NVM
+ *
+ *  The page is copied into the assembly buffer, changed there, and programmed. The ROM functions are used, as they
+ *  execute from ROM while the NVM is busy. Interrupts are disabled meanwhile, as their handlers are located in NVM.
+ *
+ *  @param direction  direction of the movement
+ *  @param correction start correction (milliseconds)
+ *  @return           true: programmed successfully
+ */
+static bool calibration_store(const motion_dir_t direction, const uint32_t correction)
+{
+    volatile calibration_nvm_t* page = (volatile calibration_nvm_t*)&calibration_nvm;
+    bool ok;
+
+    __disable_irq();
+    ok = (nvm_open_assembly_buffer((uint32_t)(uintptr_t)page) == 0);
+    if (ok)
+    {
+        page->valid = CALIBRATION_VALID;
+        page->start_correction[direction] = correction;
+        ok = (nvm_program_page() == 0);
+    }
+    nvm_config();
+    __enable_irq();
+
+    return ok && (calibration_nvm.start_correction[direction] == correction);
+}
+
+
+uint32_t calibration_start_correction(const motion_dir_t direction, const uint32_t fallback)
+{
+    if ((calibration_nvm.valid != CALIBRATION_VALID) || (calibration_nvm.start_correction[direction] == CALIBRATION_ERASED))
+    {
+        return fallback;
+    }
+
+    return calibration_nvm.start_correction[direction];
+}
+
+
+bool calibration_fit(const uint16_t* runtime, const uint16_t* pulses, const uint8_t count, uint32_t* correction)
+{
+    uint32_t sum_t = 0, sum_p = 0, max_p = 0;
+    int32_t sxx = 0, sxy = 0, x, y, c;
+    uint8_t i, shift = 0;
+
+    if (count < 2)
+    {
+        return false;
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        sum_t += runtime[i];
+        max_p = (pulses[i] > max_p) ? pulses[i] : max_p;
+    }
+
+    // the scale of the pulses only changes the slope, not the correction: reduce them to 11 bits to keep the sums in 32 bits
+    while ((max_p >> shift) >= 2048)
+    {
+        shift++;
+    }
+    for (i = 0; i < count; i++)
+    {
+        sum_p += (uint32_t)pulses[i] >> shift;
+    }
+
+    // sums of squares around the mean, scaled by count to stay in integers
+    for (i = 0; i < count; i++)
+    {
+        x = (int32_t)(count * runtime[i]) - (int32_t)sum_t;
+        y = (int32_t)(count * ((uint32_t)pulses[i] >> shift)) - (int32_t)sum_p;
+        sxx += x * x;
+        sxy += x * y;
+    }
+
+    // the movement must grow with the runtime
+    if ((sxx <= 0) || (sxy <= 0))
+    {
+        return false;
+    }
+
+    // only the ratio sxx / sxy is needed: reduce both to 16 bits for the product below
+    while ((sxx >= 65536) || (sxy >= 65536))
+    {
+        sxx >>= 1;
+        sxy >>= 1;
+    }
+    if ((sxx == 0) || (sxy == 0))
+    {
+        return false;
+    }
+
+    // correction = mean(p) / slope - mean(t), with slope = sxy / sxx; rounded, a negative correction is not used
+    c = (int32_t)sum_p * sxx - (int32_t)sum_t * sxy;
+    *correction = (c > 0) ? filter_udiv((uint32_t)c + (uint32_t)(count * sxy) / 2, (uint32_t)(count * sxy)) : 0;
+
+    return true;
+}
+
+
+void calibration_run(const motion_dir_t direction)
+{
+    const bool forward = (direction == motion_forward);
+    const shc_channel_t channel = forward ? shc_channel_ma : shc_channel_mb;
+    uint16_t runtime[CALIBRATION_STEPS], pulses[CALIBRATION_STEPS];
+    uint32_t start, moved, waited, correction;
+    uint8_t i;
+
+    calibration_status.result = calibration_result_none;
+
+    /* Same setup as for a movement: the top switch of the direction stays closed while the motor is off, so the
+     * comparator sees the VCCHB voltage.
+     */
+    hb_switch(false, false, false, false);
+    step_end_init();
+    hb_switch(forward, false, !forward, false);
+#if defined POWER_MANAGER_ENABLE && POWER_MANAGER_ENABLE
+    power_acquire(power_domain_timer);
+    power_acquire(power_domain_comparator);
+#else
+    shc_init();
+#endif
+    encoder_init();
+
+    for (i = 0; i < CALIBRATION_STEPS; i++)
+    {
+        runtime[i] = (uint16_t)((CALIBRATION_STEP_MIN) +
+                                filter_udiv(((CALIBRATION_STEP_MAX) - (CALIBRATION_STEP_MIN)) * i, (CALIBRATION_STEPS) - 1));
+
+        // each step starts from a fully charged capacitor
+        for (waited = 0; voltage_measure(channel) < (VOLTAGE_ON); waited += 10)
+        {
+            if (waited >= (CALIBRATION_CHARGE_TIMEOUT))
+            {
+                calibration_status.result = calibration_result_charge;
+                break;
+            }
+            sys_tim_singleshot_32(TIMER_SINGLE, ms2ticks(10), SYSTIM_IRQ);
+        }
+        if (calibration_status.result != calibration_result_none)
+        {
+            break;
+        }
+
+        // run the motor for the runtime of the step, then let it coast to a stop as in normal operation
+        start = encoder_pulses;
+        hb_switch(forward, !forward, !forward, forward);
+        sys_tim_singleshot_32(TIMER_SINGLE, ms2ticks((uint32_t)runtime[i]), SYSTIM_IRQ);
+        step_end(STEP_END_STRATEGY, forward);
+        sys_tim_singleshot_32(TIMER_SINGLE, ms2ticks(CALIBRATION_SETTLE), SYSTIM_IRQ);
+
+        moved = encoder_pulses - start;
+        pulses[i] = (moved > 0xffff) ? 0xffff : (uint16_t)moved;
+    }
+
+    hb_switch(false, false, false, false);
+    encoder_close();
+#if defined POWER_MANAGER_ENABLE && POWER_MANAGER_ENABLE
+    power_release(power_domain_comparator);
+    power_release(power_domain_timer);
+    power_minimal();
+#else
+    shc_close();
+    sys_tim_close();
+#endif
+
+    if (calibration_status.result != calibration_result_none)
+    {
+        return;
+    }
+
+    if (!calibration_fit(runtime, pulses, CALIBRATION_STEPS, &correction))
+    {
+        calibration_status.result = calibration_result_fit;
+        return;
+    }
+
+    calibration_status.correction = correction;
+    calibration_status.result = calibration_store(direction, correction) ? calibration_result_ok : calibration_result_nvm;
+}
+
+#endif
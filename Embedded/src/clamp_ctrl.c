@@ -0,0 +1,93 @@
+/* ============================================================================
+** Copyright (c) 2021 Infineon Technologies AG
+**               All rights reserved.
+**               www.infineon.com
+** ============================================================================
+**
+** ============================================================================
+** Redistribution and use of this software only permitted to the extent
+** expressly agreed with Infineon Technologies AG.
+** ============================================================================
+*
+*/
+
+/** @file     clamp_ctrl.c
+ *  @brief    Management of the clamping voltage of VCCHB during movements
+ *
+ *  The harvested voltage is clamped, and VOLTAGE_ON has to stay somewhat below the clamping voltage to be reached
+ *  at all. The energy stored in the HB cap grows with the square of its voltage, so a higher clamping voltage gives
+ *  considerably more energy per step: charging to 3.6V instead of 3.1V, down to 2.2V, stores about 70% more energy.
+ *  The clamping voltage has a few levels (vclamp_set()). During a movement, the highest level not exceeding the
+ *  rating of the HB cap (VCLAMP_CAP_MAX) is selected, and VOLTAGE_ON follows it with the margin configured at the
+ *  default level. The default level is restored after the movement, as the NFC communication is characterized with it.
+ */
+
+// standard libs
+// included by core_cm0.h: #include <stdint.h>
+#include "core_cm0.h"
+#include <stdbool.h>
+
+// Smack NVM lib
+#include "system_lib.h"
+
+// Smack stepwise project
+#include "settings.h"
+#include "filter.h"
+#include "clamp_ctrl.h"
+
+
+// clamping voltage of each level of vclamp_set() in millivolts
+static const uint16_t clamp_level_mv[] = { VCLAMP_LEVELS };
+
+#define CLAMP_LEVELS    (sizeof(clamp_level_mv) / sizeof(clamp_level_mv[0]))
+
+static uint8_t clamp_saved;     // level before the movement
+static bool    clamp_raised;    // the level has been changed by clamp_ctrl_raise()
+
+
+uint16_t clamp_ctrl_raise(const uint16_t voltage_on)
+{
+    uint32_t raise_mv;
+    uint8_t level, best;
+
+    clamp_saved = vclamp_get();
+    if (clamp_saved >= CLAMP_LEVELS)
+    {
+        clamp_raised = false;
+        return voltage_on;
+    }
+
+    // highest clamping voltage within the rating of the HB cap
+    best = clamp_saved;
+    for (level = 0; level < CLAMP_LEVELS; level++)
+    {
+        if ((clamp_level_mv[level] <= (VCLAMP_CAP_MAX)) && (clamp_level_mv[level] > clamp_level_mv[best]))
+        {
+            best = level;
+        }
+    }
+
+    clamp_raised = (best != clamp_saved);
+    if (!clamp_raised)
+    {
+        return voltage_on;
+    }
+
+    vclamp_set(best);
+
+    /* keep the margin between VOLTAGE_ON and the clamping voltage; the levels are in millivolts, the threshold is on
+     * the scale of the comparator: 1000mV ~ 1024 digits, digits = mV * 128 / 125
+     */
+    raise_mv = (uint32_t)clamp_level_mv[best] - clamp_level_mv[clamp_saved];
+    return (uint16_t)(voltage_on + filter_udiv(raise_mv * 128U, 125));
+}
+
+
+void clamp_ctrl_restore(void)
+{
+    if (clamp_raised)
+    {
+        vclamp_set(clamp_saved);
+        clamp_raised = false;
+    }
+}
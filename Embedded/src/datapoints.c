@@ -0,0 +1,83 @@
+/* ============================================================================
+** Copyright (c) 2021 Infineon Technologies AG
+**               All rights reserved.
+**               www.infineon.com
+** ============================================================================
+**
+** ============================================================================
+** Redistribution and use of this software only permitted to the extent
+** expressly agreed with Infineon Technologies AG.
+** ============================================================================
+*
+*/
+
+/** @file     datapoints.c
+ *  @brief    Data points exchanged with the NFC reader
+ *
+ *  The Smack data exchange library lets the NFC reader read and write variables of the firmware by their data point
+ *  ID. The library needs a table of all data points, sorted by ascending ID, which is defined here. The values are
+ *  read directly from the variables of the modules providing them, so there is no need to copy values around.
+ *  Data points of features disabled in settings.h are left out of the table.
+ */
+
+// standard libs
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// Smack NVM lib
+#include "smack_exchange.h"
+
+// Smack stepwise project
+#include "settings.h"
+#include "version.h"
+#include "smack_stepwise.h"
+#include "datapoints.h"
+#include "field_estimate.h"
+#include "calibration.h"
+#include "energy_account.h"
+#include "power_domain.h"
+
+
+static const data_point_entry_t datapoint_table[] =
+{
+    { DP_FW_VERSION,             data_point_array,  sizeof(Version_t),          (void*)&version,                NULL, NULL },
+    { DP_STEPWISE_END,           data_point_uint8,  sizeof(uint8_t),            &stepwise_status.end,           NULL, NULL },
+    { DP_STEPWISE_RUNTIME,       data_point_uint32, sizeof(uint32_t),           &stepwise_status.runtime,       NULL, NULL },
+#if defined ENCODER_ENABLE && ENCODER_ENABLE
+    { DP_STEPWISE_PULSES,        data_point_uint32, sizeof(uint32_t),           &stepwise_status.pulses,        NULL, NULL },
+#endif
+    { DP_STEPWISE_DIRECTION,     data_point_uint8,  sizeof(uint8_t),            &stepwise_status.direction,     NULL, NULL },
+    { DP_MOTION_COMMAND,         data_point_uint8 | data_point_write, sizeof(uint8_t), (void*)&motion_command, NULL, NULL },
+#if defined CALIBRATION_ENABLE && CALIBRATION_ENABLE
+    { DP_CALIBRATION_RESULT,     data_point_uint8,  sizeof(uint8_t),            &calibration_status.result,     NULL, NULL },
+    { DP_CALIBRATION_CORRECTION, data_point_uint32, sizeof(uint32_t),           &calibration_status.correction, NULL, NULL },
+#endif
+#if defined ENERGY_ACCOUNT_ENABLE && ENERGY_ACCOUNT_ENABLE
+    { DP_ENERGY_STEP_HARVESTED,  data_point_uint32, sizeof(uint32_t),           &energy_log.step_harvested,     NULL, NULL },
+    { DP_ENERGY_STEP_MOTOR,      data_point_uint32, sizeof(uint32_t),           &energy_log.step_motor,         NULL, NULL },
+    { DP_ENERGY_HARVESTED,       data_point_uint32, sizeof(uint32_t),           &energy_log.harvested,          NULL, NULL },
+    { DP_ENERGY_MOTOR,           data_point_uint32, sizeof(uint32_t),           &energy_log.motor,              NULL, NULL },
+    { DP_ENERGY_LOSSES,          data_point_uint32, sizeof(uint32_t),           &energy_log.losses,             NULL, NULL },
+    { DP_ENERGY_POWER,           data_point_uint32, sizeof(uint32_t),           &energy_log.power,              NULL, NULL },
+    { DP_ENERGY_EFFICIENCY,      data_point_uint16, sizeof(uint16_t),           &energy_log.efficiency,         NULL, NULL },
+#endif
+#if defined POWER_MANAGER_ENABLE && POWER_MANAGER_ENABLE
+    { DP_POWER_OFF_MS,           data_point_array,  sizeof(power_log.off_ms),   power_log.off_ms,               NULL, NULL },
+    { DP_POWER_SAVED_UJ,         data_point_array,  sizeof(power_log.saved_uj), power_log.saved_uj,             NULL, NULL },
+#endif
+#if defined FIELD_ESTIMATE_ENABLE && FIELD_ESTIMATE_ENABLE
+    { DP_FIELD_RSSI,             data_point_uint16, sizeof(uint16_t),           &field_prediction.rssi,         NULL, NULL },
+    { DP_FIELD_VDD_CA,           data_point_uint16, sizeof(uint16_t),           &field_prediction.vdd_ca,       NULL, NULL },
+    { DP_FIELD_POWER,            data_point_uint32, sizeof(uint32_t),           &field_prediction.power,        NULL, NULL },
+    { DP_FIELD_STEPS,            data_point_uint16, sizeof(uint16_t),           &field_prediction.steps,        NULL, NULL },
+    { DP_FIELD_TIME,             data_point_uint32, sizeof(uint32_t),           &field_prediction.time,         NULL, NULL },
+    { DP_FIELD_MODE,             data_point_uint8,  sizeof(uint8_t),            &field_prediction.mode,         NULL, NULL },
+#endif
+};
+
+
+void datapoints_init(void)
+{
+    smack_exchange_init(datapoint_table, sizeof(datapoint_table) / sizeof(datapoint_table[0]));
+}
@@ -0,0 +1,67 @@
+/* ============================================================================
+** Copyright (c) 2021 Infineon Technologies AG
+**               All rights reserved.
+**               www.infineon.com
+** ============================================================================
+**
+** ============================================================================
+** Redistribution and use of this software only permitted to the extent
+** expressly agreed with Infineon Technologies AG.
+** ============================================================================
+*
+*/
+
+/** @file     encoder.c
+ *  @brief    Counting of the pulses of a motor encoder through the GPIO event unit
+ *
+ *  Geared motors may have a hall sensor which issues a number of pulses per revolution. Counting these pulses gives
+ *  the actual movement, independent of load, supply voltage and temperature, so a movement can end at a pulse count
+ *  instead of at the accumulated motor runtime.
+ *  The encoder output is connected to a GPIO which feeds the GPIO event unit (alternate input function). The event is
+ *  raised on event bus interrupt 6; the ROM handler acknowledges the event bus interrupt and, as configured in the
+ *  aparams (evbus_handler6_source and gpio_evnt_hand_addr), calls encoder_irq(). At the maximum motor speed, the
+ *  pulses come at a rate of a few kHz, so the handler does nothing but increment the counter.
+ */
+
+// standard libs
+// included by core_cm0.h: #include <stdint.h>
+#include "core_cm0.h"
+#include <stdbool.h>
+
+// Smack ROM lib
+#include "rom_lib.h"
+
+// Smack stepwise project
+#include "settings.h"
+#include "encoder.h"
+
+
+#define ENCODER_IRQ         Event_Bus6_IRQn     // event bus interrupt of the GPIO event unit (GPIO_EVNT_IRQ)
+
+
+volatile uint32_t encoder_pulses;
+
+
+void encoder_init(void)
+{
+    // input without pull resistors, the hall sensor drives the line; route it to the GPIO event unit
+    single_gpio_iocfg(false, true, false, false, false, ENCODER_GPIO);
+    set_singlegpio_alt(ENCODER_GPIO, ENCODER_ALT_IN, 0);
+
+    encoder_pulses = 0;
+    NVIC_ClearPendingIRQ(ENCODER_IRQ);
+    NVIC_EnableIRQ(ENCODER_IRQ);
+}
+
+
+void encoder_close(void)
+{
+    NVIC_DisableIRQ(ENCODER_IRQ);
+}
+
+
+RAM_CODE void encoder_irq(void)
+{
+    // the only writer of the counter, the main loop only reads it
+    encoder_pulses++;
+}
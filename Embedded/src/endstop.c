@@ -0,0 +1,99 @@
+/* ============================================================================
+** Copyright (c) 2021 Infineon Technologies AG
+**               All rights reserved.
+**               www.infineon.com
+** ============================================================================
+**
+** ============================================================================
+** Redistribution and use of this software only permitted to the extent
+** expressly agreed with Infineon Technologies AG.
+** ============================================================================
+*
+*/
+
+/** @file     endstop.c
+ *  @brief    End stop switches on GPIOs, terminating the movement by interrupt
+ *
+ *  Many mechanisms have a microswitch at each end of their travel. The control loop of the stepwise operation only
+ *  looks at its inputs every few milliseconds, and the total motor runtime has to include a safety margin to be sure
+ *  the end is reached. With an end stop switch, the movement can end exactly when the mechanism arrives.
+ *  The GPIOs of the switches are routed through the high priority interrupt matrix (see aparams: hp_irq13_cfg and
+ *  hp_irq13_col_cfg for the forward, hp_irq14_cfg and hp_irq14_col_cfg for the backward direction). Only the switch
+ *  in the direction of the movement is enabled. The ROM handler serve_gpinN_irq() forwards the interrupt to
+ *  endstop_irq(), which switches the motor off right away, without waiting for the control loop. The control loop
+ *  then sees endstop_reached() and ends the movement.
+ *  The interrupt is disabled after it has fired, as the switch stays closed while the mechanism is at its end stop.
+ *  The level of the input is checked as well, in case the switch is already closed when the movement starts.
+ */
+
+// standard libs
+// included by core_cm0.h: #include <stdint.h>
+#include "core_cm0.h"
+#include <stdbool.h>
+
+// Smack ROM lib
+#include "rom_lib.h"
+
+// Smack stepwise project
+#include "settings.h"
+#include "endstop.h"
+#include "hb_switch.h"
+
+
+#if ((ENDSTOP_GPIO_FORWARD) > 7) || ((ENDSTOP_GPIO_BACKWARD) > 7)
+#error "ENDSTOP_GPIO_FORWARD and ENDSTOP_GPIO_BACKWARD must be one of GPIO0..GPIO7, which have an interrupt"
+#endif
+#if (ENDSTOP_GPIO_FORWARD) == (ENDSTOP_GPIO_BACKWARD)
+#error "ENDSTOP_GPIO_FORWARD and ENDSTOP_GPIO_BACKWARD must be different GPIOs"
+#endif
+
+#define ENDSTOP_IRQ_FORWARD     HPrio_Matrix4_IRQn  // HP matrix interrupt configured in hp_irq13_cfg
+#define ENDSTOP_IRQ_BACKWARD    HPrio_Matrix5_IRQn  // HP matrix interrupt configured in hp_irq14_cfg
+
+
+static volatile bool endstop_hit;
+static uint8_t endstop_gpio;        // GPIO of the switch in the direction of the movement
+static IRQn_Type endstop_irqn;      // its interrupt
+static bool endstop_forward;        // direction of the movement; selects the top switch to keep closed
+
+
+void endstop_init(const motion_dir_t direction)
+{
+    endstop_forward = (direction == motion_forward);
+    endstop_gpio = endstop_forward ? (ENDSTOP_GPIO_FORWARD) : (ENDSTOP_GPIO_BACKWARD);
+    endstop_irqn = endstop_forward ? ENDSTOP_IRQ_FORWARD : ENDSTOP_IRQ_BACKWARD;
+
+    // input with pull down: the switch connects the GPIO to VDD when the end stop is reached
+    single_gpio_iocfg(false, true, false, false, true, endstop_gpio);
+
+    // apply the column configuration of the HP matrix from the aparams
+    config_irq_hp_matrix();
+
+    endstop_hit = false;
+    NVIC_ClearPendingIRQ(endstop_irqn);
+    NVIC_EnableIRQ(endstop_irqn);
+}
+
+
+void endstop_close(void)
+{
+    NVIC_DisableIRQ(endstop_irqn);
+}
+
+
+RAM_CODE bool endstop_reached(void)
+{
+    return endstop_hit || (get_singlegpio_in(endstop_gpio) != 0);
+}
+
+
+RAM_CODE void endstop_irq(void)
+{
+    if (get_singlegpio_in(endstop_gpio) != 0)
+    {
+        // motor off, keep the top switch closed like in the "off" state of the control loop
+        hb_switch(endstop_forward, false, !endstop_forward, false);
+        endstop_hit = true;
+        NVIC_DisableIRQ(endstop_irqn);
+    }
+}
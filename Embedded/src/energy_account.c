@@ -0,0 +1,137 @@
+/* ============================================================================
+** Copyright (c) 2021 Infineon Technologies AG
+**               All rights reserved.
+**               www.infineon.com
+** ============================================================================
+**
+** ============================================================================
+** Redistribution and use of this software only permitted to the extent
+** expressly agreed with Infineon Technologies AG.
+** ============================================================================
+*
+*/
+
+/** @file     energy_account.c
+ *  @brief    Accounting of harvested and consumed energy per step and per movement
+ *
+ *  The energy stored in the HB cap at a voltage V is E = C/2 * V^2. The control loop reads the VCCHB voltage at each
+ *  switching of the motor, so the energy flowing in and out of the capacitor is known for each phase:
+ *  - During a charge phase, the motor is off, and the energy gained by the capacitor is the harvested energy. Its
+ *    duration gives the harvested power.
+ *  - During an on phase, the field keeps delivering this power, so the motor receives the energy lost by the
+ *    capacitor plus the energy harvested meanwhile.
+ *  - While the capacitor is held at the clamping voltage (DELAY_ADDITIONAL_CHARGE), the harvested energy is dumped.
+ *  At the end of the movement, the energy neither delivered to the motor nor left in the capacitor is reported as
+ *  losses, e.g. clamped energy and the error of the estimation, and the efficiency is the ratio of motor energy to
+ *  harvested energy.
+ *
+ *  Units: voltages in millivolts, capacitance in microfarads (VCCHB_CAPACITANCE_UF), energy in microjoules, power in
+ *  microwatts, times in milliseconds. All divisions are done by the hardware divider.
+ */
+
+// standard libs
+// included by core_cm0.h: #include <stdint.h>
+#include "core_cm0.h"
+#include <stdbool.h>
+
+// Smack stepwise project
+#include "settings.h"
+#include "voltage_measure.h"
+#include "filter.h"
+#include "energy_account.h"
+
+
+energy_log_t energy_log;
+
+static uint32_t energy_stored;      // energy in the HB cap at the last switching of the motor (uJ)
+
+
+/** @brief Energy stored in the HB cap
+ *  @param v     voltage (scale of comparator thresholds)
+ *  @return      energy in microjoules
+ */
+RAM_CODE static uint32_t energy_cap(const uint16_t v)
+{
+    uint32_t mv = voltage_to_mv(v);
+
+    // E[uJ] = C[uF] / 2 * V^2[mV^2] / 10^6; scale the square first to stay within 32 bits
+    return filter_udiv((VCCHB_CAPACITANCE_UF) * filter_udiv(mv * mv, 1000), 2000);
+}
+
+
+/** @brief Energy harvested with a constant power over a period of time
+ *  @param ms    duration in milliseconds
+ *  @return      energy in microjoules
+ */
+RAM_CODE static uint32_t energy_harvested(const uint32_t ms)
+{
+    if ((ms == 0) || (energy_log.power == 0))
+    {
+        return 0;
+    }
+
+    // E[uJ] = P[uW] * t[ms] / 1000; for long periods, divide first to stay within 32 bits
+    if (energy_log.power <= filter_udiv(0xffffffffUL, ms))
+    {
+        return filter_udiv(energy_log.power * ms, 1000);
+    }
+
+    return filter_udiv(energy_log.power, 1000) * ms;
+}
+
+
+void energy_init(void)
+{
+    energy_log.step_harvested = 0;
+    energy_log.step_motor = 0;
+    energy_log.harvested = 0;
+    energy_log.motor = 0;
+    energy_log.losses = 0;
+    energy_log.power = 0;
+    energy_log.efficiency = 0;
+    energy_stored = 0;
+}
+
+
+RAM_CODE void energy_charged(const uint16_t v_hi, const uint32_t charge_ms, const uint32_t clamp_ms)
+{
+    uint32_t stored = energy_cap(v_hi);
+    uint32_t gained = (stored > energy_stored) ? (stored - energy_stored) : 0;
+
+    // the power is only known from a measured charge phase; otherwise the previous measurement is kept
+    if (charge_ms != 0)
+    {
+        energy_log.power = filter_udiv(gained * 1000U, charge_ms);
+    }
+
+    // a new step starts with the charge phase
+    energy_log.step_harvested = gained + energy_harvested(clamp_ms);
+    energy_log.step_motor = 0;
+    energy_log.harvested += energy_log.step_harvested;
+    energy_stored = stored;
+}
+
+
+RAM_CODE void energy_discharged(const uint16_t v_lo, const uint32_t on_ms)
+{
+    uint32_t stored = energy_cap(v_lo);
+    uint32_t gained = energy_harvested(on_ms);
+
+    energy_log.step_motor = ((energy_stored > stored) ? (energy_stored - stored) : 0) + gained;
+    energy_log.step_harvested += gained;
+    energy_log.motor += energy_log.step_motor;
+    energy_log.harvested += gained;
+    energy_stored = stored;
+}
+
+
+void energy_finish(void)
+{
+    uint32_t used = energy_log.motor + energy_stored;
+
+    energy_log.losses = (energy_log.harvested > used) ? (energy_log.harvested - used) : 0;
+
+    // per mille; the motor energy of a movement stays far below 4 J, so the product fits into 32 bits
+    energy_log.efficiency = (energy_log.harvested != 0) ?
+                            (uint16_t)filter_udiv(energy_log.motor * 1000U, energy_log.harvested) : 0;
+}
@@ -0,0 +1,180 @@
+/* ============================================================================
+** Copyright (c) 2021 Infineon Technologies AG
+**               All rights reserved.
+**               www.infineon.com
+** ============================================================================
+**
+** ============================================================================
+** Redistribution and use of this software only permitted to the extent
+** expressly agreed with Infineon Technologies AG.
+** ============================================================================
+*
+*/
+
+/** @file     field_estimate.c
+ *  @brief    Estimation of the harvested power and prediction of the time to complete a movement
+ *
+ *  The energy stored in the HB cap between two voltages is E = C/2 * (V1^2 - V2^2). During a charge phase the motor
+ *  is off, so the time needed to charge the cap from the "off" to the "on" voltage gives the harvested power:
+ *  P = E / t_charge. During the "on" phase the cap is drained by the motor while harvesting goes on, so the motor
+ *  runs for t_on = E / (P_motor - P) per step.
+ *
+ *  Before the first charge phase has been measured, the harvested power is estimated from the RSSI reading of the
+ *  NFC receiver, using a factor "power per RSSI digit" (FIELD_POWER_PER_RSSI_Q8). Each measured charge phase
+ *  replaces the estimate by the measured power, and refines the factor to be used for the next movement.
+ *
+ *  Units: voltages in millivolts, capacitance in microfarads, energy in microjoules, power in microwatts, times in
+ *  milliseconds. All divisions are done by the hardware divider.
+ */
+
+// standard libs
+// included by core_cm0.h: #include <stdint.h>
+#include "core_cm0.h"
+#include <stdbool.h>
+
+// Smack ROM lib
+#include "rom_lib.h"
+
+// Smack stepwise project
+#include "settings.h"
+#include "smack_stepwise.h"
+#include "voltage_measure.h"
+#include "filter.h"
+#include "power_domain.h"
+#include "field_estimate.h"
+
+
+field_prediction_t field_prediction;
+
+// harvested power per RSSI digit in microwatts (Q8); kept over movements while the device is powered
+static uint32_t power_per_rssi = FIELD_POWER_PER_RSSI_Q8;
+
+
+/** @brief Energy stored in the HB cap between two voltages
+ *  @param v_lo  lower voltage (scale of comparator thresholds)
+ *  @param v_hi  upper voltage (scale of comparator thresholds)
+ *  @return      energy in microjoules
+ */
+RAM_CODE static uint32_t field_step_energy(const uint16_t v_lo, const uint16_t v_hi)
+{
+    uint32_t lo = voltage_to_mv(v_lo);
+    uint32_t hi = voltage_to_mv(v_hi);
+    uint32_t dv2;
+
+    if (hi <= lo)
+    {
+        return 0;
+    }
+
+    // E[uJ] = C[uF] / 2 * (hi^2 - lo^2)[mV^2] / 10^6; scale the squares first to stay within 32 bits
+    dv2 = filter_udiv(hi * hi - lo * lo, 1000);
+    return filter_udiv((VCCHB_CAPACITANCE_UF) * dv2, 2000);
+}
+
+
+/** @brief Predict steps and time to completion from the current power estimate
+ *  @param params    parameters of the movement
+ *  @param remaining motor runtime still needed in milliseconds
+ */
+RAM_CODE static void field_predict(const stepwise_params_t* params, const uint32_t remaining)
+{
+    uint32_t energy, t_on, t_charge, steps;
+    uint32_t power = field_prediction.power;
+
+    field_prediction.mode = ((power * 100U) >= ((MOTOR_POWER_UW) * (FIELD_CONTINUOUS_PERCENT))) ?
+                            field_mode_continuous : field_mode_bang_bang;
+
+    if (power >= (MOTOR_POWER_UW))
+    {
+        // the field delivers what the motor needs: one single step
+        field_prediction.steps = 1;
+        field_prediction.time = remaining;
+        return;
+    }
+
+    energy = field_step_energy(params->voltage_off, params->voltage_on);
+    if ((power == 0) || (energy == 0))
+    {
+        // no prediction possible
+        field_prediction.steps = 0xffff;
+        field_prediction.time = 0xffffffff;
+        return;
+    }
+
+    t_on = filter_udiv(energy * 1000U, (MOTOR_POWER_UW) - power);
+    t_charge = filter_udiv(energy * 1000U, power);
+
+    // each start of the motor accounts for start_correction in addition to the runtime of the step
+    steps = filter_udiv(remaining + t_on + params->start_correction - 1U, t_on + params->start_correction);
+    if (steps > 0xffff)
+    {
+        steps = 0xffff;
+    }
+
+    field_prediction.steps = (uint16_t)steps;
+    field_prediction.time = steps * (t_on + t_charge);
+}
+
+
+/** @brief Read RSSI and VDD_CA of the NFC receiver with the sense unit
+ *
+ *  The sense unit is requested for the readings, as it may be switched off (see power_domain.c). Without the power
+ *  domain manager there is no reference count, and the sense unit is left on: during the movement the comparator
+ *  converts with it, and shc_close() switches it off at the end of the movement.
+ */
+RAM_CODE static void field_read_nfc(void)
+{
+#if defined POWER_MANAGER_ENABLE && POWER_MANAGER_ENABLE
+    power_acquire(power_domain_sense);
+#else
+    switch_on_sense();
+#endif
+    field_prediction.rssi = get_nfc_value(nfc_sel_rssi);
+    field_prediction.vdd_ca = get_nfc_value(nfc_sel_vdd_ca);
+#if defined POWER_MANAGER_ENABLE && POWER_MANAGER_ENABLE
+    power_release(power_domain_sense);
+#endif
+}
+
+
+void field_estimate_init(const stepwise_params_t* params)
+{
+    field_read_nfc();
+
+    field_prediction.power = (field_prediction.rssi * power_per_rssi) >> 8;
+    field_predict(params, params->total_runtime);
+}
+
+
+RAM_CODE void field_estimate_charged(const stepwise_params_t* params, const uint16_t v_lo, const uint16_t v_hi,
+                                     const uint32_t charge_ms, const uint32_t remaining)
+{
+    uint32_t energy = field_step_energy(v_lo, v_hi);
+
+    if ((charge_ms == 0) || (energy == 0))
+    {
+        return;
+    }
+
+    /* The sense unit is shared with the comparator, but may be used in between two comparisons. While the timer
+     * triggered ADC capture is running, the sense unit is not available, and the RSSI reading of the start is kept.
+     */
+#if !(defined ADC_CAPTURE_ENABLE && ADC_CAPTURE_ENABLE)
+    field_read_nfc();
+#endif
+
+    // measured harvested power replaces the estimate; the factor for the RSSI based estimate follows (IIR, 1/2)
+    field_prediction.power = filter_udiv(energy * 1000U, charge_ms);
+    if (field_prediction.rssi != 0)
+    {
+        power_per_rssi = (power_per_rssi + filter_udiv(field_prediction.power << 8, field_prediction.rssi)) >> 1;
+    }
+
+    field_predict(params, remaining);
+}
+
+
+RAM_CODE bool field_estimate_continuous(void)
+{
+    return field_prediction.mode == field_mode_continuous;
+}
@@ -0,0 +1,201 @@
+/* ============================================================================
+** Copyright (c) 2021 Infineon Technologies AG
+**               All rights reserved.
+**               www.infineon.com
+** ============================================================================
+**
+** ============================================================================
+** Redistribution and use of this software only permitted to the extent
+** expressly agreed with Infineon Technologies AG.
+** ============================================================================
+*
+*/
+
+/** @file     filter.c
+ *  @brief    Fixed point filters for comparator decisions and ADC readings
+ *
+ *  The decisions of the stepwise motor operation are based on single readings of the VCCHB voltage. When the motor
+ *  is switched on, its inrush current causes a short dip of the voltage which may end a step prematurely. The
+ *  filters in this module help to suppress such noise:
+ *  - debounce: a binary decision must be seen on a number of consecutive samples before it is accepted
+ *  - moving median: removes single spikes without adding an offset
+ *  - first order IIR low pass: smooths noise, coefficient is a power of 2, so no multiplication is needed
+ *  - slope: change of a signal per millisecond over a window of samples, e.g. to estimate the discharge rate
+ *
+ *  All filters use integer arithmetic only. The Cortex-M0 core has no divide instruction, so the divisions of the
+ *  project are done by the hardware divider of Smack (calc_div(), through filter_div() and filter_udiv()) rather than
+ *  the division routines of the compiler library.
+ *  If FILTER_HOST_REFERENCE is defined, the C division operator is used instead, and this file can be compiled on a
+ *  host as a reference. calc_div() rounds towards zero like the C operator, so the results are bit exact.
+ */
+
+// standard libs
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifndef FILTER_HOST_REFERENCE
+// Smack ROM lib
+#include "rom_lib.h"
+#include "pmu.h"
+#elif !defined WAIT_ABOUT_1MS
+// system timer ticks per millisecond, as defined by pmu.h of the ROM library
+#define WAIT_ABOUT_1MS      0x8000
+#endif
+
+// Smack stepwise project
+#include "settings.h"
+#include "filter.h"
+
+
+RAM_CODE int32_t filter_div(const int32_t num, const int32_t den)
+{
+#ifdef FILTER_HOST_REFERENCE
+    return num / den;
+#else
+    return (int32_t)calc_div((uint32_t)num, (uint32_t)den, div_s_s, division);
+#endif
+}
+
+
+RAM_CODE uint32_t filter_udiv(const uint32_t num, const uint32_t den)
+{
+#ifdef FILTER_HOST_REFERENCE
+    return num / den;
+#else
+    return calc_div(num, den, div_u_u, division);
+#endif
+}
+
+
+RAM_CODE void filter_debounce_init(filter_debounce_t* f, const bool state, const uint8_t limit)
+{
+    f->state = state;
+    f->count = 0;
+    f->limit = (limit == 0) ? 1 : limit;
+}
+
+
+RAM_CODE bool filter_debounce(filter_debounce_t* f, const bool in)
+{
+    if (in == f->state)
+    {
+        f->count = 0;
+    }
+    else if (++f->count >= f->limit)
+    {
+        f->state = in;
+        f->count = 0;
+    }
+
+    return f->state;
+}
+
+
+void filter_median_init(filter_median_t* f, const uint8_t window)
+{
+    uint8_t w = window | 1U;
+
+    f->window = (w > FILTER_MEDIAN_MAX) ? FILTER_MEDIAN_MAX : w;
+    f->fill = 0;
+    f->idx = 0;
+}
+
+
+RAM_CODE uint16_t filter_median(filter_median_t* f, const uint16_t in)
+{
+    uint16_t sorted[FILTER_MEDIAN_MAX];
+    uint16_t v;
+    uint8_t i, j;
+
+    f->buf[f->idx] = in;
+    f->idx = (f->idx + 1U >= f->window) ? 0 : f->idx + 1U;
+    if (f->fill < f->window)
+    {
+        f->fill++;
+    }
+
+    // insertion sort of a copy; the window is small, so this is cheaper than maintaining a sorted list
+    for (i = 0; i < f->fill; i++)
+    {
+        v = f->buf[i];
+        for (j = i; (j > 0) && (sorted[j - 1U] > v); j--)
+        {
+            sorted[j] = sorted[j - 1U];
+        }
+        sorted[j] = v;
+    }
+
+    return sorted[f->fill >> 1];
+}
+
+
+void filter_iir_init(filter_iir_t* f, const uint8_t shift)
+{
+    f->y = 0;
+    f->shift = shift;
+    f->valid = false;
+}
+
+
+uint16_t filter_iir(filter_iir_t* f, const uint16_t in)
+{
+    int32_t x = (int32_t)in << 8;
+
+    if (!f->valid)
+    {
+        f->y = x;
+        f->valid = true;
+    }
+    else
+    {
+        // arithmetic shift of the difference; the state keeps 8 fractional bits to avoid a dead band
+        f->y += (x - f->y) >> f->shift;
+    }
+
+    return (uint16_t)((f->y + 0x80) >> 8);
+}
+
+
+void filter_slope_init(filter_slope_t* f, const uint8_t window)
+{
+    f->window = (window < 2) ? 2 : ((window > FILTER_SLOPE_MAX) ? FILTER_SLOPE_MAX : window);
+    f->fill = 0;
+    f->idx = 0;
+}
+
+
+int32_t filter_slope(filter_slope_t* f, const uint16_t in, const uint32_t time)
+{
+    uint8_t oldest, newest;
+    uint32_t dt;
+    int32_t dv;
+
+    newest = f->idx;
+    f->value[newest] = in;
+    f->time[newest] = time;
+    f->idx = (f->idx + 1U >= f->window) ? 0 : f->idx + 1U;
+    if (f->fill < f->window)
+    {
+        f->fill++;
+    }
+
+    if (f->fill < 2)
+    {
+        return 0;
+    }
+
+    // the oldest sample is the one to be overwritten next, unless the window is not filled yet
+    oldest = (f->fill < f->window) ? 0 : f->idx;
+
+    /* slope = dv / dt_ms in Q8: the time distance is scaled to milliseconds in Q8 first (the timer ticks are much
+     * finer than needed), so the numerator dv * 2^16 fits into 32 bits for the full ADC range.
+     */
+    dt = filter_udiv(f->time[newest] - f->time[oldest], (WAIT_ABOUT_1MS) >> 8);
+    if (dt == 0)
+    {
+        return 0;
+    }
+    dv = (int32_t)f->value[newest] - (int32_t)f->value[oldest];
+
+    return filter_div(dv * 65536, (int32_t)dt);
+}
@@ -0,0 +1,99 @@
+/* ============================================================================
+** Copyright (c) 2021 Infineon Technologies AG
+**               All rights reserved.
+**               www.infineon.com
+** ============================================================================
+**
+** ============================================================================
+** Redistribution and use of this software only permitted to the extent
+** expressly agreed with Infineon Technologies AG.
+** ============================================================================
+*
+*/
+
+/** @file     low_power.c
+ *  @brief    Power saving mode during long charge phases
+ *
+ *  Between two checks of the VCCHB voltage, the control loop sleeps with WFI, but the clocks and the peripherals
+ *  keep running and draw power from the field which would otherwise charge the HB cap. In a weak field, the charge
+ *  phases take long, and most of this time may be spent in the power saving mode of the PMU instead. The standby
+ *  timer, clocked by the slow clock, wakes the device up again.
+ *
+ *  Usually the CPU continues behind request_power_saving_mode(). In case the wake up goes through a reset instead,
+ *  the movement in progress is recorded in RAM which is not initialized at start up (section .noinit), and
+ *  _nvm_start() continues it with the remaining runtime (see low_power_resume()).
+ */
+
+// standard libs
+// included by core_cm0.h: #include <stdint.h>
+#include "core_cm0.h"
+#include <stdbool.h>
+
+// Smack ROM lib
+#include "rom_lib.h"
+
+// Smack stepwise project
+#include "settings.h"
+#include "smack_stepwise.h"
+#include "filter.h"
+#include "low_power.h"
+
+
+#if defined ADC_CAPTURE_ENABLE && ADC_CAPTURE_ENABLE && defined LOW_POWER_ENABLE && LOW_POWER_ENABLE
+#error "LOW_POWER_ENABLE cannot be used together with ADC_CAPTURE_ENABLE, the capture needs the system timer"
+#endif
+
+
+#define LOW_POWER_VALID     0x534c5031UL    // "SLP1", a movement has been interrupted by the power saving mode
+
+/**
+ * @brief movement in progress while in power saving mode
+ */
+typedef struct low_power_record_s
+{
+    uint32_t valid;             //!< LOW_POWER_VALID while sleeping
+    uint32_t direction;         //!< direction of the movement (motion_dir_t)
+    uint32_t runtime;           //!< motor runtime done so far, milliseconds
+    uint32_t check;             //!< inverted copy of runtime, to reject random RAM contents after power up
+} low_power_record_t;
+
+static low_power_record_t low_power_record __attribute__((section(".noinit")));
+
+
+RAM_CODE uint32_t low_power_sleep(const uint32_t ms, const motion_dir_t direction, const uint32_t runtime)
+{
+    uint32_t slept;
+
+    low_power_record.direction = (uint32_t)direction;
+    low_power_record.runtime = runtime;
+    low_power_record.check = ~runtime;
+    low_power_record.valid = LOW_POWER_VALID;
+
+    config_stbtm(true, ms * (STANDBY_TICKS_PER_MS));
+    request_power_saving_mode((LOW_POWER_WAKE_BY_NFC) != 0, true, false, wakeup_rising);
+
+    // still running: the movement continues here rather than after a reset
+    low_power_record.valid = 0;
+    config_stbtm(false, 0);
+
+    slept = filter_udiv(get_standby_time(), STANDBY_TICKS_PER_MS);
+    return (slept < ms) ? slept : ms;
+}
+
+
+bool low_power_resume(motion_dir_t* direction, uint32_t* runtime)
+{
+    bool resume = (low_power_record.valid == LOW_POWER_VALID) &&
+                  (low_power_record.check == ~low_power_record.runtime) &&
+                  (low_power_record.direction <= (uint32_t)motion_backward) &&
+                  (get_wakeup_source() == wakeup_stb_tim);
+
+    low_power_record.valid = 0;
+    if (resume)
+    {
+        *direction = (motion_dir_t)low_power_record.direction;
+        *runtime = low_power_record.runtime;
+    }
+
+    return resume;
+}
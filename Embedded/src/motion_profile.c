@@ -0,0 +1,221 @@
+/* ============================================================================
+** Copyright (c) 2021 Infineon Technologies AG
+**               All rights reserved.
+**               www.infineon.com
+** ============================================================================
+**
+** ============================================================================
+** Redistribution and use of this software only permitted to the extent
+** expressly agreed with Infineon Technologies AG.
+** ============================================================================
+*
+*/
+
+/** @file     motion_profile.c
+ *  @brief    Motion profiles made of segments (ramp, cruise, dwell) with software PWM
+ *
+ *  Switching the motor to the full VCCHB voltage at the start of each step causes a high inrush current, and switching
+ *  it off at full speed makes it overshoot. A motion profile describes the movement as a sequence of segments
+ *  instead: the motor is started with a reduced duty and ramped up, runs at full duty in the middle of the movement,
+ *  and is ramped down towards its end. Dwell segments keep the motor off for a while, e.g. to let a latch settle.
+ *  The progress of a drive segment is the motor runtime weighted with the duty, so the durations of the segments use
+ *  the same unit as TOTAL_MOTOR_RUNTIME. A segment may span many charge cycles of the VCCHB capacitor: the profile
+ *  keeps its position while the control loop waits for the capacitor, and continues where it stopped.
+ *
+ *  The duty is realized by software PWM: within each PWM period, the low side switch of the direction is opened for
+ *  the "off" part and closed for the "on" part. The top switch stays closed, so the winding current freewheels back
+ *  into the capacitor.
+ */
+
+// standard libs
+// included by core_cm0.h: #include <stdint.h>
+#include "core_cm0.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+// Smack ROM lib
+#include "rom_lib.h"
+
+// Smack NVM lib
+#include "sys_tim_lib.h"
+
+// Smack stepwise project
+#include "settings.h"
+#include "filter.h"
+#include "motion_profile.h"
+#include "hb_switch.h"
+
+
+static const motion_segment_t* profile_segments;
+static uint8_t  profile_count;
+static uint8_t  profile_index;      // current segment
+static uint32_t profile_progress;   // motor runtime at full duty in the current drive segment (ticks)
+static uint32_t profile_pulses;     // encoder pulses at the start of the current segment
+static uint32_t profile_dwell_start;
+static bool     profile_dwelling;   // the current dwell segment has been started
+
+
+/** @brief Continue with the next segment
+ *  @param pulses     encoder pulses counted so far
+ */
+RAM_CODE static void motion_profile_next(const uint32_t pulses)
+{
+    profile_index++;
+    profile_progress = 0;
+    profile_pulses = pulses;
+    profile_dwelling = false;
+}
+
+
+void motion_profile_start(const motion_segment_t* segments, const uint8_t count, const uint32_t pulses)
+{
+    profile_segments = segments;
+    profile_count = count;
+    profile_index = 0;
+    profile_progress = 0;
+    profile_pulses = pulses;
+    profile_dwelling = false;
+}
+
+
+RAM_CODE bool motion_profile_done(void)
+{
+    return profile_index >= profile_count;
+}
+
+
+RAM_CODE bool motion_profile_dwell(void)
+{
+    return !motion_profile_done() &&
+           (profile_segments[profile_index].duty_from == 0) && (profile_segments[profile_index].duty_to == 0);
+}
+
+
+RAM_CODE uint8_t motion_profile_duty(void)
+{
+    const motion_segment_t* segment;
+    uint32_t position;
+    int32_t duty;
+
+    if (motion_profile_done())
+    {
+        return 0;
+    }
+
+    segment = &profile_segments[profile_index];
+    if (segment->duration == 0)
+    {
+        return segment->duty_to;
+    }
+
+    // linear interpolation between duty_from and duty_to by the position within the segment (milliseconds)
+    position = filter_udiv(profile_progress, ms2ticks(1));
+    if (position > segment->duration)
+    {
+        position = segment->duration;
+    }
+
+    duty = (int32_t)segment->duty_from +
+           filter_div(((int32_t)segment->duty_to - (int32_t)segment->duty_from) * (int32_t)position,
+                      (int32_t)segment->duration);
+
+    // a drive segment ramping from or to 0 must still make progress
+    return (duty > 0) ? (uint8_t)duty : 1;
+}
+
+
+RAM_CODE void motion_profile_advance(const uint32_t ticks, const uint32_t pulses)
+{
+    const motion_segment_t* segment;
+
+    if (motion_profile_done() || motion_profile_dwell())
+    {
+        return;
+    }
+
+    segment = &profile_segments[profile_index];
+    profile_progress += ticks;
+
+    if ((profile_progress >= ms2ticks((uint32_t)segment->duration)) ||
+        (((segment->stop & motion_stop_pulses) != 0) && ((pulses - profile_pulses) >= segment->pulses)))
+    {
+        motion_profile_next(pulses);
+    }
+}
+
+
+RAM_CODE bool motion_profile_wait(const uint32_t now, const uint32_t pulses)
+{
+    if (!motion_profile_dwell())
+    {
+        return false;
+    }
+
+    if (!profile_dwelling)
+    {
+        profile_dwelling = true;
+        profile_dwell_start = now;
+    }
+
+    if ((now - profile_dwell_start) >= ms2ticks((uint32_t)profile_segments[profile_index].duration))
+    {
+        motion_profile_next(pulses);
+    }
+
+    return motion_profile_dwell();
+}
+
+
+RAM_CODE bool motion_profile_stall(const uint32_t pulses)
+{
+    if (motion_profile_done() || ((profile_segments[profile_index].stop & motion_stop_stall) == 0))
+    {
+        return false;
+    }
+
+    motion_profile_next(pulses);
+    return true;
+}
+
+
+RAM_CODE void motion_pwm(const uint8_t duty, const bool forward, const uint32_t duration, bool (*stop)(void))
+{
+    uint32_t on, off, elapsed;
+
+    if (duty == 0)
+    {
+        hb_switch(forward, false, !forward, false);
+        sys_tim_singleshot_32(TIMER_SINGLE, duration, SYSTIM_IRQ);
+        return;
+    }
+
+    // the motor may have been switched off by an interrupt during the previous period, keep it off then
+    if ((stop != NULL) && stop())
+    {
+        return;
+    }
+
+    if (duty >= 100)
+    {
+        hb_switch(forward, !forward, !forward, forward);
+        sys_tim_singleshot_32(TIMER_SINGLE, duration, SYSTIM_IRQ);
+        return;
+    }
+
+    on = filter_udiv((MOTION_PWM_PERIOD) * (uint32_t)duty, 100);
+    off = (MOTION_PWM_PERIOD) - on;
+
+    for (elapsed = 0; elapsed < duration; elapsed += (MOTION_PWM_PERIOD))
+    {
+        // "off" part first, so that the motor is on at the end of the period
+        hb_switch(forward, false, !forward, false);
+        sys_tim_singleshot_32(TIMER_SINGLE, off, SYSTIM_IRQ);
+        // leave the H bridge open, e.g. the end stop interrupt has switched the motor off meanwhile
+        if ((stop != NULL) && stop())
+        {
+            return;
+        }
+        hb_switch(forward, !forward, !forward, forward);
+        sys_tim_singleshot_32(TIMER_SINGLE, on, SYSTIM_IRQ);
+    }
+}
@@ -0,0 +1,234 @@
+/* ============================================================================
+** Copyright (c) 2021 Infineon Technologies AG
+**               All rights reserved.
+**               www.infineon.com
+** ============================================================================
+**
+** ============================================================================
+** Redistribution and use of this software only permitted to the extent
+** expressly agreed with Infineon Technologies AG.
+** ============================================================================
+*
+*/
+
+/** @file     power_domain.c
+ *  @brief    Reference counted switching of the peripheral blocks
+ *
+ *  The peripheral blocks stay in whatever state the ROM or the last user left them, and each block which is on draws
+ *  some power from the field that could go into the HB cap. The modules request the blocks they need with
+ *  power_acquire() and hand them back with power_release(). Switching off is deferred to power_minimal(), which the
+ *  control loop calls before each motor on phase, so that a block used again shortly is not cycled needlessly.
+ *  The comparator of the NVM library converts the H bridge pin with the sense unit: shc_init() switches the sense
+ *  unit on, shc_close() switches it off. So the comparator domain holds the sense domain while it is in use, and the
+ *  sense unit stays on during the movement. It is switched off while the control loop sleeps with the comparator
+ *  released (LOW_POWER_ENABLE), unless the stall detection or the ADC capture holds it.
+ *  The NVM stays on during the movement, also with RAM_CODE_ENABLE: the ROM dispatches the interrupts through the
+ *  handler addresses in the aparams, which are in the NVM.
+ *
+ *  The time each block spends switched off is measured with the clock of the control loop, and the energy saved is
+ *  estimated from it with the power consumption of the block (POWER_DOMAIN_UW in settings.h).
+ *  UART, SSP and AES are not managed: the libraries offer no functions to switch them off.
+ */
+
+// standard libs
+// included by core_cm0.h: #include <stdint.h>
+#include "core_cm0.h"
+#include <stdbool.h>
+
+// Smack ROM lib
+#include "rom_lib.h"
+
+// Smack NVM lib
+#include "nvm_lib.h"
+#include "sys_tim_lib.h"
+#include "shc_lib.h"
+
+// Smack stepwise project
+#include "settings.h"
+#include "filter.h"
+#include "power_domain.h"
+
+
+// power consumption of each domain in microwatts
+static const uint32_t power_uw[power_domain_count] RAM_CONST = { POWER_DOMAIN_UW };
+
+power_log_t power_log;
+
+static uint8_t  power_count[power_domain_count];    // number of users of each domain
+static bool     power_on[power_domain_count];       // domain switched on (or in unknown state)
+static bool     power_measuring;                    // the clock is running, and power_last is valid
+static uint32_t power_last;                         // time of last update of the savings
+
+
+/** @brief Switch a domain on or off
+ *  @param domain    domain to switch
+ *  @param on        true: switch on
+ */
+RAM_CODE static void power_switch(const power_domain_t domain, const bool on)
+{
+    switch (domain)
+    {
+        case power_domain_nvm:
+            if (on)
+            {
+                switch_on_nvm_lib();
+            }
+            else
+            {
+                switch_off_nvm_lib();
+            }
+            break;
+
+        case power_domain_sense:
+            if (on)
+            {
+                switch_on_sense();
+            }
+            else
+            {
+                switch_off_sense();
+            }
+            break;
+
+        case power_domain_comparator:
+            if (on)
+            {
+                shc_init();
+            }
+            else
+            {
+                // shc_close() switches off the sense unit as well, which may still be held by others
+                shc_close();
+                if (power_count[power_domain_sense] != 0)
+                {
+                    switch_on_sense();
+                }
+                else
+                {
+                    power_on[power_domain_sense] = false;
+                }
+            }
+            break;
+
+        case power_domain_timer:
+            // the timers are started by the timer functions
+            if (!on)
+            {
+                sys_tim_close();
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    power_on[domain] = on;
+}
+
+
+/** @brief Add the time since the last update to the domains switched off
+ */
+RAM_CODE static void power_account(void)
+{
+    uint32_t now = sys_tim_cyclic_cascaded_get_combined(TIMER_CLOCK);
+    uint32_t ms;
+    uint8_t d;
+
+    if (power_measuring)
+    {
+        ms = filter_udiv(now - power_last, ms2ticks(1));
+        for (d = 0; d < power_domain_count; d++)
+        {
+            if (!power_on[d])
+            {
+                power_log.off_ms[d] += ms;
+                power_log.saved_uj[d] += filter_udiv(ms * power_uw[d], 1000);
+            }
+        }
+    }
+
+    // the clock of the control loop only runs while the timer domain is in use
+    power_measuring = (power_count[power_domain_timer] != 0);
+    power_last = now;
+}
+
+
+void power_init(void)
+{
+    uint8_t d;
+
+    for (d = 0; d < power_domain_count; d++)
+    {
+        power_count[d] = 0;
+        power_on[d] = true;
+    }
+    power_measuring = false;
+
+    // the firmware is executed from the NVM, and the interrupts are dispatched through the aparams in the NVM
+    power_acquire(power_domain_nvm);
+
+    /* The state left by the ROM is not known: switch the other blocks off, so that the first power_acquire() of each
+     * switches it on (e.g. shc_init() for the comparator).
+     */
+    power_minimal();
+}
+
+
+RAM_CODE void power_acquire(const power_domain_t domain)
+{
+    // the comparator converts with the sense unit
+    if (domain == power_domain_comparator)
+    {
+        power_acquire(power_domain_sense);
+    }
+    if (!power_on[domain])
+    {
+        if (domain != power_domain_timer)
+        {
+            power_account();
+        }
+        power_switch(domain, true);
+    }
+    if (power_count[domain] < 0xff)
+    {
+        power_count[domain]++;
+    }
+
+    // the clock restarts with the timer domain
+    if (domain == power_domain_timer)
+    {
+        power_measuring = false;
+    }
+}
+
+
+RAM_CODE void power_release(const power_domain_t domain)
+{
+    if (power_count[domain] != 0)
+    {
+        power_count[domain]--;
+        if (domain == power_domain_comparator)
+        {
+            power_release(power_domain_sense);
+        }
+    }
+}
+
+
+RAM_CODE void power_minimal(void)
+{
+    uint8_t d;
+
+    if (power_count[power_domain_timer] != 0)
+    {
+        power_account();
+    }
+
+    for (d = 0; d < power_domain_count; d++)
+    {
+        if ((power_count[d] == 0) && power_on[d])
+        {
+            power_switch((power_domain_t)d, false);
+        }
+    }
+}
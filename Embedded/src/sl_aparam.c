@@ -25,7 +25,25 @@
 #include "cmsis_compiler.h"
 #include "aparam.h"
 #include "nvm_params.h"
+#include "settings.h"
 #include "smack_stepwise.h"
+#include "adc_capture.h"
+#include "endstop.h"
+#include "encoder.h"
+#include "handlers.h"
+#include "smack_exchange.h"
+
+
+#if defined ENDSTOP_ENABLE && ENDSTOP_ENABLE
+// the end stop GPIOs are routed to HP matrix interrupts 13 (forward) and 14 (backward), which dispatch to the handler
+// of the GPIO
+#define ENDSTOP_IRQ_HAND_FORWARD    (GPIO0_IRQ_HAND << (ENDSTOP_GPIO_FORWARD))
+#define ENDSTOP_IRQ_HAND_BACKWARD   (GPIO0_IRQ_HAND << (ENDSTOP_GPIO_BACKWARD))
+#define ENDSTOP_HAND_ADDR(n)        ((((ENDSTOP_GPIO_FORWARD) == (n)) || ((ENDSTOP_GPIO_BACKWARD) == (n))) ? \
+                                     (param_func_ptr_t)endstop_irq : 0xffffffff)
+#else
+#define ENDSTOP_HAND_ADDR(n)        0xffffffff
+#endif
 
 
 /**
@@ -59,7 +77,7 @@ Aparams_t const aparams __attribute__ ((section (".nvm.APARAMS"))) =
 
     .app_prog =                                                /**< [0x447:0x408] (32 * 16) absolute address App function 0 through 15 */
     {
-        0xffffffff,
+        (param_func_ptr_t)smack_exchange_handler,              // data point exchange with NFC reader (see datapoints.c)
         0xffffffff,
         0xffffffff,
         0xffffffff,
@@ -146,7 +164,11 @@ Aparams_t const aparams __attribute__ ((section (".nvm.APARAMS"))) =
     0xffffffff,
 
     .evbus_handler6_source =                                   /**< [0x4c3:0x4c0] (32)  0x00 + custom source of evbus6 irq           */
+#if defined ENCODER_ENABLE && ENCODER_ENABLE
+    GPIO_EVNT_HAND,
+#else
     0xffffffff,
+#endif
 
     .evbus_handler7_source =                                   /**< [0x4c7:0x4c4] (32)  0x00 + custom source of evbus7 irq           */
     0xffffffff,
@@ -167,10 +189,18 @@ Aparams_t const aparams __attribute__ ((section (".nvm.APARAMS"))) =
     0xffffffff,
 
     .hp_irq13_cfg =                                            /**< [0x4df:0x4dc] (32)  0x00 + irq source of matrix irq              */
+#if defined ENDSTOP_ENABLE && ENDSTOP_ENABLE
+    ENDSTOP_IRQ_HAND_FORWARD,
+#else
     0xffffffff,
+#endif
 
     .hp_irq14_cfg =                                            /**< [0x4e3:0x4e0] (32)  0x00 + irq source of matrix irq              */
+#if defined ENDSTOP_ENABLE && ENDSTOP_ENABLE
+    ENDSTOP_IRQ_HAND_BACKWARD,
+#else
     0xffffffff,
+#endif
 
     .hp_irq9_col_cfg =                                         /**< [0x4e7:0x4e4] (32)  0x00 + column config register                */
     0xffffffff,
@@ -185,10 +215,18 @@ Aparams_t const aparams __attribute__ ((section (".nvm.APARAMS"))) =
     0xffffffff,
 
     .hp_irq13_col_cfg =                                        /**< [0x4f7:0x4f4] (32)  0x00 + column config register                */
+#if defined ENDSTOP_ENABLE && ENDSTOP_ENABLE
+    ENDSTOP_IRQ_HAND_FORWARD,
+#else
     0xffffffff,
+#endif
 
     .hp_irq14_col_cfg =                                        /**< [0x4fb:0x4f8] (32)  0x00 + column config register                */
+#if defined ENDSTOP_ENABLE && ENDSTOP_ENABLE
+    ENDSTOP_IRQ_HAND_BACKWARD,
+#else
     0xffffffff,
+#endif
 
     .rfu1 =                                                    /**< [0x4ff:0x4fc] (32)  0x00 + column config register                */
     {
@@ -196,7 +234,11 @@ Aparams_t const aparams __attribute__ ((section (".nvm.APARAMS"))) =
     },
 
     .sense_adc_hand_addr =                                     /**< [0x503:0x500] (32)  absolute address of custom handler           */
+#if defined ADC_CAPTURE_ENABLE && ADC_CAPTURE_ENABLE
+    (param_func_ptr_t)adc_capture_irq,
+#else
     0xffffffff,
+#endif
 
     .timer0_hand_addr =                                        /**< [0x507:0x504] (32)  absolute address of custom handler           */
     0xffffffff,
@@ -211,7 +253,11 @@ Aparams_t const aparams __attribute__ ((section (".nvm.APARAMS"))) =
     0xffffffff,
 
     .gpio_evnt_hand_addr =                                     /**< [0x517:0x514] (32)  absolute address of custom handler           */
+#if defined ENCODER_ENABLE && ENCODER_ENABLE
+    (param_func_ptr_t)encoder_irq,
+#else
     0xffffffff,
+#endif
 
     .gpio_evnt_gen_hand_addr =                                 /**< [0x51b:0x518] (32)  absolute address of custom handler           */
     0xffffffff,
@@ -232,28 +278,28 @@ Aparams_t const aparams __attribute__ ((section (".nvm.APARAMS"))) =
     0xffffffff,
 
     .gpio0_hand_addr =                                         /**< [0x533:0x530] (32)  absolute address of custom handler           */
-    0xffffffff,
+    ENDSTOP_HAND_ADDR(0),
 
     .gpio1_hand_addr =                                         /**< [0x537:0x534] (32)  absolute address of custom handler           */
-    0xffffffff,
+    ENDSTOP_HAND_ADDR(1),
 
     .gpio2_hand_addr =                                         /**< [0x53b:0x538] (32)  absolute address of custom handler           */
-    0xffffffff,
+    ENDSTOP_HAND_ADDR(2),
 
     .gpio3_hand_addr =                                         /**< [0x53f:0x53c] (32)  absolute address of custom handler           */
-    0xffffffff,
+    ENDSTOP_HAND_ADDR(3),
 
     .gpio4_hand_addr =                                         /**< [0x543:0x540] (32)  absolute address of custom handler           */
-    0xffffffff,
+    ENDSTOP_HAND_ADDR(4),
 
     .gpio5_hand_addr =                                         /**< [0x547:0x544] (32)  absolute address of custom handler           */
-    0xffffffff,
+    ENDSTOP_HAND_ADDR(5),
 
     .gpio6_hand_addr =                                         /**< [0x54b:0x548] (32)  absolute address of custom handler           */
-    0xffffffff,
+    ENDSTOP_HAND_ADDR(6),
 
     .gpio7_hand_addr =                                         /**< [0x54f:0x54c] (32)  absolute address of custom handler           */
-    0xffffffff,
+    ENDSTOP_HAND_ADDR(7),
 
     .aes_hand_addr =                                           /**< [0x553:0x550] (32)  absolute address of custom handler           */
     0xffffffff,
@@ -33,6 +33,7 @@
 // included by core_cm0.h: #include <stdint.h>
 #include "core_cm0.h"
 #include <stdbool.h>
+#include <stddef.h>
 
 // Smack ROM lib
 #include "rom_lib.h"
@@ -44,21 +45,33 @@
 // Smack stepwise project
 #include "settings.h"
 #include "smack_stepwise.h"
+#include "voltage_measure.h"
+#include "filter.h"
+#if defined TEMP_COMP_ENABLE && TEMP_COMP_ENABLE
+#include "temp_comp.h"
+#endif
+#include "field_estimate.h"
+#include "stall_detect.h"
+#include "bemf_estimate.h"
+#include "endstop.h"
+#include "encoder.h"
+#include "step_end.h"
+#include "hb_switch.h"
+#include "motion_profile.h"
+#include "calibration.h"
+#include "energy_account.h"
+#include "low_power.h"
+#include "clamp_ctrl.h"
+#include "power_domain.h"
+#include "datapoints.h"
+#if defined ADC_CAPTURE_ENABLE && ADC_CAPTURE_ENABLE
+#include "adc_capture.h"
+#endif
 
 
-//#undef wait_about_1ms
-//#define wait_about_1ms  (XTAL / 1000U)          // calculated from oscillator; more exact than rough estimate
-#define ms2ticks(ms)    ((ms) * WAIT_ABOUT_1MS)
-
-/** The functions which drive the motor are using timers in a different manner to estimate if the operationis completed.
- *  The timer channels to be used are defined here.
+/* The timer channels and the conversion of milliseconds to timer ticks are defined in settings.h, as they are shared
+ * with other modules of the project.
  */
-#define TIMER_SINGLE    1       // timer # used for single shot delays
-#define TIMER_CLOCK     5       // timer # configured together with the preceeding timer as a free running 32 bit timer to be used for timing measurements
-
-// interrupt number used in system timer calls
-#define SYSTIM_IRQ      9
-
 
 
 /** _nvm_start() is the main() routine of the application code:
@@ -80,7 +93,39 @@
 // prototypes
 void _nvm_start(void);
 
-static void drive_motor_voltage_controlled(void);
+// most recent reading of the VCCHB voltage (scale of the comparator thresholds, see voltage_measure.h)
+static uint16_t vcchb;
+static filter_median_t vcchb_median;
+
+#if defined ADC_CAPTURE_ENABLE && ADC_CAPTURE_ENABLE
+// most recent reading of the motor current (raw result of I2V path)
+static uint16_t motor_current;
+#endif
+
+// parameters of the current movement
+static stepwise_params_t params;
+
+// comparator input connected to VCCHB through the closed top switch of the H bridge (depends on direction)
+static shc_channel_t vcchb_channel;
+
+// result of the last movement
+stepwise_status_t stepwise_status;
+
+// pending motion command, written by the NFC reader
+volatile uint8_t motion_command;
+
+static void drive_motor_voltage_controlled(const motion_dir_t direction, const stepwise_params_t* profile);
+static uint16_t vcchb_read(void);
+#if defined BEMF_ESTIMATE_ENABLE && BEMF_ESTIMATE_ENABLE
+static uint32_t runtime_correct(const uint32_t runtime, const int32_t correction);
+#endif
+#if defined MOTION_PROFILE_ENABLE && MOTION_PROFILE_ENABLE
+static uint32_t pulses_counted(void);
+
+// motion profiles of both directions
+static const motion_segment_t profile_forward[] RAM_CONST = { MOTION_PROFILE_FORWARD };
+static const motion_segment_t profile_backward[] RAM_CONST = { MOTION_PROFILE_BACKWARD };
+#endif
 
 
 /** @brief main function
@@ -89,24 +134,122 @@ static void drive_motor_voltage_controlled(void);
  */
 void _nvm_start(void)
 {
+    stepwise_params_t profile;
+    uint8_t command;
+#if defined LOW_POWER_ENABLE && LOW_POWER_ENABLE
+    motion_dir_t resume_direction;
+    uint32_t resume_runtime;
+#endif
 
     // ******************* Test of hb_ctrl *********************
 
     set_hb_eventctrl(false);
 
-    drive_motor_voltage_controlled();
+    // publish the data points to the NFC reader
+    datapoints_init();
+
+#if defined POWER_MANAGER_ENABLE && POWER_MANAGER_ENABLE
+    power_init();
+#endif
+
+    // perform the movement configured for power up, if any
+    motion_command = MOTION_STARTUP_COMMAND;
 
+    /* If the power saving mode during a movement has ended with a reset, the movement is continued with the runtime
+     * still missing instead.
+     */
+#if defined LOW_POWER_ENABLE && LOW_POWER_ENABLE
+    if (low_power_resume(&resume_direction, &resume_runtime))
+    {
+        motion_command = motion_cmd_none;
+        motion_profile_default(resume_direction, &profile);
+        profile.total_runtime = (resume_runtime < profile.total_runtime) ? (profile.total_runtime - resume_runtime) : 0;
+        motion_run(resume_direction, &profile);
+    }
+#endif
 
-    // background task is just an endless loop - should never run.
+    /* Background task: execute the motion commands written by the NFC reader through the data point
+     * DP_MOTION_COMMAND. Between the commands, the CPU sleeps; the NFC communication wakes it up.
+     */
     while (true)
     {
-        asm("WFI");
+        // the data point exchange writes the command from its interrupt; a command written in between is not lost
+        __disable_irq();
+        command = motion_command;
+        motion_command = motion_cmd_none;
+        __enable_irq();
+
+        if ((command == motion_cmd_forward) || (command == motion_cmd_backward))
+        {
+            const motion_dir_t direction = (command == motion_cmd_forward) ? motion_forward : motion_backward;
+
+            motion_profile_default(direction, &profile);
+            motion_run(direction, &profile);
+        }
+#if defined CALIBRATION_ENABLE && CALIBRATION_ENABLE
+        else if ((command == motion_cmd_calibrate_forward) || (command == motion_cmd_calibrate_backward))
+        {
+            calibration_run((command == motion_cmd_calibrate_forward) ? motion_forward : motion_backward);
+        }
+#endif
+
+        __WFI();
     }
 
 }
 
 #if STEPWISE_METHOD == STEPWISE_VOLTAGE_CONTROLLED
 
+void motion_profile_default(const motion_dir_t direction, stepwise_params_t* profile)
+{
+    profile->voltage_on = VOLTAGE_ON;
+    profile->voltage_off = VOLTAGE_OFF;
+#if defined DELAY_ADDITIONAL_CHARGE
+    profile->additional_charge = DELAY_ADDITIONAL_CHARGE;
+#else
+    profile->additional_charge = 0;
+#endif
+    profile->poll_period = POLL_PERIOD;
+
+    if (direction == motion_forward)
+    {
+#ifdef MOTOR_START_CORRECTION
+        profile->start_correction = MOTOR_START_CORRECTION;
+#else
+        profile->start_correction = 0;
+#endif
+        profile->total_runtime = TOTAL_MOTOR_RUNTIME;
+        profile->target_pulses = ENCODER_TARGET_PULSES;
+    }
+    else
+    {
+        profile->start_correction = MOTOR_START_CORRECTION_BACKWARD;
+        profile->total_runtime = TOTAL_MOTOR_RUNTIME_BACKWARD;
+        profile->target_pulses = ENCODER_TARGET_PULSES_BACKWARD;
+    }
+
+    // a calibrated start correction replaces the one from settings.h
+#if defined CALIBRATION_ENABLE && CALIBRATION_ENABLE
+    profile->start_correction = calibration_start_correction(direction, profile->start_correction);
+#endif
+
+#if defined MOTION_PROFILE_ENABLE && MOTION_PROFILE_ENABLE
+    profile->segments = (direction == motion_forward) ? profile_forward : profile_backward;
+    profile->segment_count = (direction == motion_forward) ? (uint8_t)(sizeof(profile_forward) / sizeof(profile_forward[0])) :
+                                                             (uint8_t)(sizeof(profile_backward) / sizeof(profile_backward[0]));
+#else
+    profile->segments = NULL;
+    profile->segment_count = 0;
+#endif
+}
+
+
+void motion_run(const motion_dir_t direction, const stepwise_params_t* profile)
+{
+    drive_motor_voltage_controlled(direction, profile);
+}
+
+
 /** @brief Stepwise motor operation with observation of capacitor state
  *
  *  This function charges an external capacitor on the VCCHB pin to store energy for motor operation until
@@ -138,18 +281,89 @@ void _nvm_start(void)
  *                   _/
  *            0-  __/
  *
+ *  The motor is driven forward through HS1 and LS2, or backward through HS2 and LS1. In both cases, the top switch
+ *  stays closed in the "off" state, and the comparator observes the H bridge output behind it (MA or MB).
+ *
+ *  @param direction  direction of the movement
+ *  @param profile    parameters of the movement
  */
-static void drive_motor_voltage_controlled(void)
+RAM_CODE static void drive_motor_voltage_controlled(const motion_dir_t direction, const stepwise_params_t* profile)
 {
-    uint32_t total_on, timestamp_on, timestamp_off, target_off;
-    bool state, run, cmp;
+    const bool forward = (direction == motion_forward);
+    uint32_t total_on, timestamp_on, timestamp_off, target_off = 0, correction;
+    bool state, run, cmp, stall, endstop, arrived, pause, final;
+    filter_debounce_t voltage_ok;
+#if defined FIELD_ESTIMATE_ENABLE && FIELD_ESTIMATE_ENABLE
+    uint16_t vcchb_off = 0;
+    uint32_t remaining;
+#endif
+    uint16_t voltage_restart;
+#if defined ENERGY_ACCOUNT_ENABLE && ENERGY_ACCOUNT_ENABLE
+    uint32_t charge_ms;
+#endif
+#if defined LOW_POWER_ENABLE && LOW_POWER_ENABLE
+    uint32_t charge_last = 0, elapsed, slept, clock;
+#endif
+#if defined BEMF_ESTIMATE_ENABLE && BEMF_ESTIMATE_ENABLE
+    bool coasting = false;
+#endif
+#if defined MOTION_PROFILE_ENABLE && MOTION_PROFILE_ENABLE
+    bool profiled;
+    uint8_t duty = 0;
+    uint32_t timestamp_acc = 0, now;
+#endif
 
     /* Set initial state:
      * - remember that motor is switched off (state = false)
-     * - ensure that H bridge is switched off (set_hb_switch())
+     * - ensure that H bridge is switched off (hb_switch())
      */
-    set_hb_switch(false, false, false, false);
+    hb_switch(false, false, false, false);
     state = false;
+    stall = false;
+    endstop = false;
+    arrived = false;
+    pause = false;
+    stepwise_status.end = stepwise_end_none;
+    stepwise_status.runtime = 0;
+    stepwise_status.pulses = 0;
+    stepwise_status.direction = (uint8_t)direction;
+
+    /* Take the parameters of the movement from the profile. If configured, the parameters are adjusted to the
+     * temperature of the device. The temperature sensor is part of the sense unit, so this has to be done before
+     * the comparator is initialized.
+     */
+    params = *profile;
+#if defined TEMP_COMP_ENABLE && TEMP_COMP_ENABLE
+    temp_comp_apply(&params, temp_comp_read());
+#endif
+
+    /* If configured, the clamping voltage is raised for the movement, and the capacitor is charged to a higher
+     * voltage before each step.
+     */
+#if defined VCLAMP_ENABLE && VCLAMP_ENABLE
+    params.voltage_on = clamp_ctrl_raise(params.voltage_on);
+#endif
+
+    /* If configured, sample the field strength and predict the time needed for the movement. The prediction is
+     * updated after each charge phase and published as data points.
+     */
+#if defined FIELD_ESTIMATE_ENABLE && FIELD_ESTIMATE_ENABLE
+    field_estimate_init(&params);
+#endif
+
+    /* If configured, the energy flowing in and out of the VCCHB capacitor is accounted for each step and published
+     * as data points.
+     */
+#if defined ENERGY_ACCOUNT_ENABLE && ENERGY_ACCOUNT_ENABLE
+    energy_init();
+#endif
+
+    /* If configured, the movement while coasting is measured from the back EMF of the motor. The start correction
+     * is only used as the prediction for the first step.
+     */
+#if defined BEMF_ESTIMATE_ENABLE && BEMF_ESTIMATE_ENABLE
+    bemf_init(ms2ticks(params.start_correction), forward ? shc_channel_ma : shc_channel_mb);
+#endif
 
     /* The duration of each step of motor operation as well as the recharge steps are adjusted dynamically
      * and not known yet. To judge the motor movement that was performed we keep track of the time that the
@@ -161,6 +375,9 @@ static void drive_motor_voltage_controlled(void)
      * and the results will be used to calculate time distances between those queries.
      */
     // start free running timer as a clock for time measurements; use ticks as a basis as on all other timers
+#if defined POWER_MANAGER_ENABLE && POWER_MANAGER_ENABLE
+    power_acquire(power_domain_timer);
+#endif
     sys_tim_cyclic_cascaded(TIMER_CLOCK, 0xffff, 0xffff);
 
     /* As in the simple timer example above, we assume that the capacitor on the VCCHB pin is empty when the device
@@ -179,8 +396,11 @@ static void drive_motor_voltage_controlled(void)
      * be selected as an input for comparison. Care must be taken about the low side switches inside the H bridge.
      * Both low side switches shall be switched off unless motor operation is intended, and if the motor shall be
      * operated, the comparator input must be selected upon the H bridge settings needed for the motor operation.
+     * Moving backward, the top switch HS2 is used, and the voltage is observed on the MB pin.
      */
-    set_hb_switch(true, false, false, false);
+    vcchb_channel = forward ? shc_channel_ma : shc_channel_mb;
+    step_end_init();
+    hb_switch(forward, false, !forward, false);
 
     // todo: time delay after on voltage, total motor runtime
 
@@ -192,12 +412,56 @@ static void drive_motor_voltage_controlled(void)
      */
     total_on = 0;
     timestamp_on = 0;
+    timestamp_off = 0;
     run = true;
 
+    /* Single readings of the VCCHB voltage may be disturbed, e.g. by the inrush current when the motor is switched on.
+     * The readings pass a moving median, and the decision to switch off the motor may be debounced (see settings.h).
+     */
+    filter_median_init(&vcchb_median, FILTER_VCCHB_MEDIAN);
+    filter_debounce_init(&voltage_ok, true, FILTER_OFF_DEBOUNCE);
+
     /* The comaprator circuitry requires initialization through shc_init(). This function must be called before we can
      * call shc_compare().
+     * If configured, the VCCHB voltage is sampled by the ADC instead, triggered by a system timer channel. The comparator
+     * must not be used then, as it shares the analog routing with the sense unit.
      */
+#if defined ADC_CAPTURE_ENABLE && ADC_CAPTURE_ENABLE
+    adc_capture_start(ADC_CAPTURE_PERIOD);
+#elif defined POWER_MANAGER_ENABLE && POWER_MANAGER_ENABLE
+    power_acquire(power_domain_comparator);
+#else
     shc_init();
+#endif
+
+    /* If configured, the motor current is observed to detect a stalled motor. The current is sampled through SH1 of
+     * the sense unit, or taken from the ADC capture if that is running anyway.
+     */
+#if defined STALL_DETECT_ENABLE && STALL_DETECT_ENABLE && !(defined ADC_CAPTURE_ENABLE && ADC_CAPTURE_ENABLE)
+    stall_detect_init();
+#endif
+
+    /* If configured, the interrupt of the end stop switch is enabled. It switches the motor off by itself, the loop
+     * below only has to notice.
+     */
+#if defined ENDSTOP_ENABLE && ENDSTOP_ENABLE
+    endstop_init(direction);
+#endif
+
+    /* If configured, the pulses of the motor encoder are counted. With a target number of pulses, the movement ends
+     * when the target has been reached, rather than at the total motor runtime.
+     */
+#if defined ENCODER_ENABLE && ENCODER_ENABLE
+    encoder_init();
+#endif
+
+    /* If the profile has segments, the motor is driven with the duty of the segments by software PWM, and the
+     * runtime is weighted with the duty. The movement ends after the last segment.
+     */
+#if defined MOTION_PROFILE_ENABLE && MOTION_PROFILE_ENABLE
+    profiled = (params.segments != NULL) && (params.segment_count != 0);
+    motion_profile_start(params.segments, params.segment_count, pulses_counted());
+#endif
 
     /* The following loop implements a two point regulation. It waits in the "off" until the VCCHB capacitor is fully
      * charged (e.g. upper threshold reached), then it switches to the "on" state.
@@ -215,9 +479,42 @@ static void drive_motor_voltage_controlled(void)
              * the capacitor on the VCCHB pin, if it drops below a threshold that may be insufficiant for proper motor
              * operation.
              */
-            cmp = shc_compare(shc_channel_ma, VOLTAGE_OFF);
+            cmp = filter_debounce(&voltage_ok, vcchb_read() >= params.voltage_off);
+
+            /* A motor running against an end stop draws a high current for a longer time. There is no point in
+             * continuing the movement then.
+             */
+#if defined STALL_DETECT_ENABLE && STALL_DETECT_ENABLE
+#if defined ADC_CAPTURE_ENABLE && ADC_CAPTURE_ENABLE
+            stall = stall_detect(motor_current,
+                                 filter_udiv(sys_tim_cyclic_cascaded_get_combined(TIMER_CLOCK) - timestamp_on, ms2ticks(1)));
+#else
+            stall = stall_detect(stall_detect_sample(),
+                                 filter_udiv(sys_tim_cyclic_cascaded_get_combined(TIMER_CLOCK) - timestamp_on, ms2ticks(1)));
+#endif
+#if defined MOTION_PROFILE_ENABLE && MOTION_PROFILE_ENABLE
+            // a segment of the profile may end on a stall, e.g. when ramping down into the end stop
+            if (stall && profiled && motion_profile_stall(pulses_counted()))
+            {
+                stall = false;
+                stall_detect_start();
+            }
+#endif
+#endif
+#if defined ENDSTOP_ENABLE && ENDSTOP_ENABLE
+            endstop = endstop_reached();
+#endif
+#if defined ENCODER_ENABLE && ENCODER_ENABLE
+            arrived = (params.target_pulses != 0) && (encoder_pulses >= params.target_pulses);
+#endif
+#if defined MOTION_PROFILE_ENABLE && MOTION_PROFILE_ENABLE
+            // the motor is switched off in a dwell segment and after the last segment
+            pause = profiled && (motion_profile_done() || motion_profile_dwell());
+            // after the last segment, the motor is stopped like at the end of the movement
+            arrived = arrived || (profiled && motion_profile_done());
+#endif
 
-            if (!cmp || ((int32_t)(sys_tim_cyclic_cascaded_get_combined(TIMER_CLOCK) - target_off) > 0))
+            if (!cmp || stall || endstop || arrived || pause || ((int32_t)(sys_tim_cyclic_cascaded_get_combined(TIMER_CLOCK) - target_off) > 0))
             {
                 /* Now the voltage of the capacitor has dropped below the threshold where the motor will operate properly.
                  * The capacitor on the VCCHB pin needs to be recharged to sotre energy for the next step of motor movement.
@@ -226,23 +523,80 @@ static void drive_motor_voltage_controlled(void)
                  */
 
                 /* First, we remember the time when the motor is switched off in order to calculate the motor runtime. Then
-                 * we switch off the motor and remember the new state.
+                 * we switch off the motor and remember the new state. The motor may be switched off differently at the
+                 * end of the last step, e.g. braked to stop precisely (see STEP_END_STRATEGY in settings.h).
                  */
                 timestamp_off = sys_tim_cyclic_cascaded_get_combined(TIMER_CLOCK);
-                set_hb_switch(true, false, false, false);
+                final = endstop || arrived || stall ||
+                        ((total_on + (timestamp_off - timestamp_on)) >= ms2ticks(params.total_runtime));
+                step_end(final ? STEP_END_FINAL_STRATEGY : STEP_END_STRATEGY, forward);
                 state = false;
+#if defined FIELD_ESTIMATE_ENABLE && FIELD_ESTIMATE_ENABLE
+                vcchb_off = vcchb;
+#endif
+#if defined ENERGY_ACCOUNT_ENABLE && ENERGY_ACCOUNT_ENABLE
+                energy_discharged(vcchb, filter_udiv(timestamp_off - timestamp_on, ms2ticks(1)));
+#endif
+#if defined BEMF_ESTIMATE_ENABLE && BEMF_ESTIMATE_ENABLE
+                /* The back EMF is only seen with the winding open. The freewheel and brake strategies short it first,
+                 * and the movement while shorted cannot be measured, so the prediction is kept after such a step.
+                 */
+                if ((final ? STEP_END_FINAL_STRATEGY : STEP_END_STRATEGY) == step_end_coast)
+                {
+                    bemf_start(sys_tim_cyclic_cascaded_get_combined(TIMER_CLOCK));
+                    coasting = true;
+                }
+#endif
 
                 /* We also remembered the time when we switched on the motor. Here, we can calculate the difference, e.g. the
                  * motor runtime in this step, and sum it up in "total_on".
                  * Remember that we started a cascaded timer pair from the system timer block to act as a free running 32 bit
                  * in background. We can calculate time differences simply be "now - then".
                  */
+#if defined MOTION_PROFILE_ENABLE && MOTION_PROFILE_ENABLE
+                if (profiled)
+                {
+                    correction = filter_udiv((timestamp_off - timestamp_acc) * duty, 100);
+                    total_on += correction;
+                    motion_profile_advance(correction, pulses_counted());
+                }
+                else
+#endif
                 total_on += timestamp_off - timestamp_on;
 
                 /* If total motor runtime was reached (e.g. movement done), leave loop.
+                 * Leave as well if the motor has stalled or the end stop switch has been reached: the mechanism has
+                 * reached its end stop.
                  */
-                if (total_on >= ms2ticks(TOTAL_MOTOR_RUNTIME))
+                if (endstop)
+                {
+                    stepwise_status.end = stepwise_end_endstop;
+                    run = false;
+                    break;
+                }
+#if defined MOTION_PROFILE_ENABLE && MOTION_PROFILE_ENABLE
+                if (profiled && motion_profile_done())
+                {
+                    stepwise_status.end = stepwise_end_profile;
+                    run = false;
+                    break;
+                }
+#endif
+                if (arrived)
+                {
+                    stepwise_status.end = stepwise_end_pulses;
+                    run = false;
+                    break;
+                }
+                if (total_on >= ms2ticks(params.total_runtime))
                 {
+                    stepwise_status.end = stepwise_end_time;
+                    run = false;
+                    break;
+                }
+                if (stall)
+                {
+                    stepwise_status.end = stepwise_end_stall;
                     run = false;
                     break;
                 }
@@ -250,31 +604,181 @@ static void drive_motor_voltage_controlled(void)
         }
         else
         {
+            /* The end stop or the target number of encoder pulses may also be reached while the motor is coasting.
+             */
+#if defined ENDSTOP_ENABLE && ENDSTOP_ENABLE
+            if (endstop_reached())
+            {
+                stepwise_status.end = stepwise_end_endstop;
+                run = false;
+                break;
+            }
+#endif
+#if defined ENCODER_ENABLE && ENCODER_ENABLE
+            if ((params.target_pulses != 0) && (encoder_pulses >= params.target_pulses))
+            {
+                stepwise_status.end = stepwise_end_pulses;
+                run = false;
+                break;
+            }
+#endif
+
+            /* While the motor is coasting, its back EMF is integrated. When it has come to a stop, the movement
+             * predicted at the start of the step is replaced by the measured one, which may complete the movement.
+             */
+#if defined BEMF_ESTIMATE_ENABLE && BEMF_ESTIMATE_ENABLE
+            if (coasting && !bemf_update(sys_tim_cyclic_cascaded_get_combined(TIMER_CLOCK)))
+            {
+                coasting = false;
+                total_on = runtime_correct(total_on, bemf_finish());
+                if (total_on >= ms2ticks(params.total_runtime))
+                {
+                    stepwise_status.end = stepwise_end_time;
+                    run = false;
+                    break;
+                }
+            }
+#endif
+
             /* This is the branch for the "off" state. We observe the voltage on the VCCHB capacitor for reaching a "full"
              * threshold. Due to possible variances between comparator and clamping circuit, we actually have to compare
              * against a threshold that is somwhat lower than the "full charged" voltage. the remainder of the charging phase
              * then is realized as a timer based charging step.
              */
-            cmp = shc_compare(shc_channel_ma, VOLTAGE_ON);
+            /* In continuous drive, selected by the field strength estimation if the harvested power is close to the
+             * power drawn by the motor, the motor is restarted as soon as the voltage has recovered a bit.
+             */
+            voltage_restart = params.voltage_on;
+#if defined FIELD_ESTIMATE_ENABLE && FIELD_ESTIMATE_ENABLE
+            if (field_estimate_continuous())
+            {
+                voltage_restart = params.voltage_off + (FIELD_CONTINUOUS_HYSTERESIS);
+            }
+#endif
+            cmp = vcchb_read() >= voltage_restart;
+
+            /* In a dwell segment of the motion profile, the motor stays off for the duration of the segment; the
+             * capacitor is charged meanwhile. The profile may end with a dwell.
+             */
+#if defined MOTION_PROFILE_ENABLE && MOTION_PROFILE_ENABLE
+            if (profiled && motion_profile_wait(sys_tim_cyclic_cascaded_get_combined(TIMER_CLOCK), pulses_counted()))
+            {
+                cmp = false;
+            }
+            if (profiled && motion_profile_done())
+            {
+                stepwise_status.end = stepwise_end_profile;
+                run = false;
+                break;
+            }
+#endif
+
+            /* In a weak field, the charge phases take long. If the previous charge phase has taken long enough, the
+             * device sleeps in the power saving mode for most of the time this one is expected to take. The system
+             * timer may stop meanwhile, so the time slept is added to the duration of the charge phase. The H bridge
+             * and the comparator are set up again afterwards. Not done while the motor is still coasting.
+             */
+#if defined LOW_POWER_ENABLE && LOW_POWER_ENABLE
+#if defined BEMF_ESTIMATE_ENABLE && BEMF_ESTIMATE_ENABLE
+            if (!cmp && !coasting && (charge_last != 0))
+#else
+            if (!cmp && (charge_last != 0))
+#endif
+            {
+                clock = sys_tim_cyclic_cascaded_get_combined(TIMER_CLOCK);
+                elapsed = filter_udiv(clock - timestamp_off, ms2ticks(1));
+                if (charge_last >= elapsed + (LOW_POWER_MIN_SLEEP))
+                {
+#if defined POWER_MANAGER_ENABLE && POWER_MANAGER_ENABLE
+                    power_release(power_domain_comparator);
+                    power_minimal();
+#else
+                    shc_close();
+#endif
+                    slept = low_power_sleep(filter_udiv((charge_last - elapsed) * (LOW_POWER_SLEEP_PERCENT), 100),
+                                            direction, filter_udiv(total_on, ms2ticks(1)));
+                    clock = sys_tim_cyclic_cascaded_get_combined(TIMER_CLOCK) - clock;
+                    if (ms2ticks(slept) > clock)
+                    {
+                        timestamp_off -= ms2ticks(slept) - clock;
+                    }
+                    hb_switch(forward, false, !forward, false);
+#if defined POWER_MANAGER_ENABLE && POWER_MANAGER_ENABLE
+                    power_acquire(power_domain_comparator);
+#else
+                    shc_init();
+#endif
+                }
+            }
+#endif
 
             if (cmp)
             {
                 /* The comparator reported that the capacitor on the VCCHB pin is almost full, and we may continue with the
                  * next step of motor movement.
                  *
-                 * First, if configured, charge for some additional time to ensure that the capacitor is really full.
+                 * The duration of this charge phase tells how much power is harvested from the field. Update the
+                 * prediction of the time needed to complete the movement (not possible for the initial charge).
                  */
-#if defined DELAY_ADDITIONAL_CHARGE && DELAY_ADDITIONAL_CHARGE
-                sys_tim_singleshot_32(TIMER_SINGLE, ms2ticks(DELAY_ADDITIONAL_CHARGE), SYSTIM_IRQ);
+#if defined FIELD_ESTIMATE_ENABLE && FIELD_ESTIMATE_ENABLE
+                if (timestamp_off != 0)
+                {
+                    remaining = filter_udiv(total_on, ms2ticks(1));
+                    remaining = (remaining < params.total_runtime) ? (params.total_runtime - remaining) : 0;
+                    field_estimate_charged(&params, vcchb_off, vcchb,
+                                           filter_udiv(sys_tim_cyclic_cascaded_get_combined(TIMER_CLOCK) - timestamp_off, ms2ticks(1)),
+                                           remaining);
+                }
+#endif
+#if defined ENERGY_ACCOUNT_ENABLE && ENERGY_ACCOUNT_ENABLE
+                charge_ms = (timestamp_off != 0) ?
+                            filter_udiv(sys_tim_cyclic_cascaded_get_combined(TIMER_CLOCK) - timestamp_off, ms2ticks(1)) : 0;
+#endif
+#if defined LOW_POWER_ENABLE && LOW_POWER_ENABLE
+                charge_last = ((timestamp_off != 0) && (voltage_restart == params.voltage_on)) ?
+                              filter_udiv(sys_tim_cyclic_cascaded_get_combined(TIMER_CLOCK) - timestamp_off, ms2ticks(1)) : 0;
+#endif
+
+                /* First, if configured, charge for some additional time to ensure that the capacitor is really full.
+                 * This is skipped in continuous drive. The energy harvested meanwhile is dumped by the clamp.
+                 */
+                if ((voltage_restart == params.voltage_on) && (params.additional_charge != 0))
+                {
+                    sys_tim_singleshot_32(TIMER_SINGLE, ms2ticks((uint32_t)params.additional_charge), SYSTIM_IRQ);
+                }
+#if defined ENERGY_ACCOUNT_ENABLE && ENERGY_ACCOUNT_ENABLE
+                energy_charged(vcchb, charge_ms, (voltage_restart == params.voltage_on) ? params.additional_charge : 0);
 #endif
 
                 /* When the motor is switched on, for a short period it draws a higher startup current, e.g. builds up
                  * some kinetic energy in its rotating parts that will result in some further movement after the motor
                  * has been switched off. To account for this additional movement, you may configure a correction value
                  * that add a "motor on" time equivalent for this further movement to the "total_on" variable.
+                 * With the back EMF estimation, the movement predicted from the previous steps is added instead; if the
+                 * motor is still coasting, the measurement of the previous step ends here.
                  */
-#ifdef MOTOR_START_CORRECTION
-                total_on += ms2ticks(MOTOR_START_CORRECTION);
+#if defined BEMF_ESTIMATE_ENABLE && BEMF_ESTIMATE_ENABLE
+                if (coasting)
+                {
+                    coasting = false;
+                    total_on = runtime_correct(total_on, bemf_finish());
+                }
+                correction = bemf_predicted();
+#else
+                correction = ms2ticks(params.start_correction);
+#endif
+                total_on += correction;
+#if defined MOTION_PROFILE_ENABLE && MOTION_PROFILE_ENABLE
+                if (profiled)
+                {
+                    motion_profile_advance(correction, pulses_counted());
+                }
+#endif
+
+                /* Switch off the peripheral blocks not needed, so that the motor gets as much of the energy as possible.
+                 */
+#if defined POWER_MANAGER_ENABLE && POWER_MANAGER_ENABLE
+                power_minimal();
 #endif
 
                 /* Remember the time when we started the motor. Needed later to calculate the runtime during the next motor
@@ -287,12 +791,21 @@ static void drive_motor_voltage_controlled(void)
                  * only need to compare the current time against this target in the "on" state rather than performing some
                  * calculations on every check then.
                  */
-                target_off = timestamp_on + (ms2ticks(TOTAL_MOTOR_RUNTIME) - total_on);
+                target_off = timestamp_on + (ms2ticks(params.total_runtime) - total_on);
 
-                /* Actually start the motor and remember the state
+                /* Actually start the motor and remember the state. With a motion profile, the motor is started by the
+                 * software PWM at the end of the loop.
                  */
-                set_hb_switch(true, false, false, true);
+#if defined MOTION_PROFILE_ENABLE && MOTION_PROFILE_ENABLE
+                timestamp_acc = timestamp_on;
+                if (!profiled)
+#endif
+                hb_switch(forward, !forward, !forward, forward);
                 state = true;
+                filter_debounce_init(&voltage_ok, true, FILTER_OFF_DEBOUNCE);
+#if defined STALL_DETECT_ENABLE && STALL_DETECT_ENABLE
+                stall_detect_start();
+#endif
             }
         }
 
@@ -302,22 +815,144 @@ static void drive_motor_voltage_controlled(void)
          * interrupt. If other interrupts are active, the actual delay may be shorter than requested. The NVM library provides
          * other delay functions which are also using WFI to reduce power consumption but check the timer status in order to
          * produce a fixed delay, e. g. sys_tim_singleshot_32().
+         * While the motor is coasting, the back EMF is sampled at a higher rate.
+         * With a motion profile, the motor is driven by the software PWM during this period instead. Afterwards, the
+         * runtime weighted with the duty is added to the total and to the progress of the profile.
          */
-        single_shot_systick(ms2ticks(10));
+#if defined MOTION_PROFILE_ENABLE && MOTION_PROFILE_ENABLE
+        if (state && profiled)
+        {
+            duty = motion_profile_duty();
+#if defined ENDSTOP_ENABLE && ENDSTOP_ENABLE
+            motion_pwm(duty, forward, ms2ticks((uint32_t)params.poll_period), endstop_reached);
+#else
+            motion_pwm(duty, forward, ms2ticks((uint32_t)params.poll_period), NULL);
+#endif
+
+            now = sys_tim_cyclic_cascaded_get_combined(TIMER_CLOCK);
+            correction = filter_udiv((now - timestamp_acc) * duty, 100);
+            total_on += correction;
+            motion_profile_advance(correction, pulses_counted());
+            timestamp_acc = now;
+            target_off = now + (ms2ticks(params.total_runtime) - total_on);
+            continue;
+        }
+#endif
+#if defined BEMF_ESTIMATE_ENABLE && BEMF_ESTIMATE_ENABLE
+        single_shot_systick(coasting ? ms2ticks(BEMF_SAMPLE_PERIOD) : ms2ticks((uint32_t)params.poll_period));
+#else
+        single_shot_systick(ms2ticks((uint32_t)params.poll_period));
+#endif
     }
 
-    /* Motor operation done -> ensure that H bridge is switched off
+    /* Motor operation done -> ensure that H bridge is switched off, and restore the clamping voltage for the NFC
+     * communication
      */
-    set_hb_switch(false, false, false, false);
+    hb_switch(false, false, false, false);
+#if defined VCLAMP_ENABLE && VCLAMP_ENABLE
+    clamp_ctrl_restore();
+#endif
 
     /* Switch off the peripherals used in this function in order to conserve some power:
      * - switch off the comparator module (e.g. reset analog paths, stop clocks)
      * - switch off system timer in two steps: halt running timer, then stop module
      */
+    stepwise_status.runtime = filter_udiv(total_on, ms2ticks(1));
+#if defined ENERGY_ACCOUNT_ENABLE && ENERGY_ACCOUNT_ENABLE
+    energy_finish();
+#endif
+
+#if defined ENDSTOP_ENABLE && ENDSTOP_ENABLE
+    endstop_close();
+#endif
+#if defined ENCODER_ENABLE && ENCODER_ENABLE
+    encoder_close();
+    stepwise_status.pulses = encoder_pulses;
+#endif
+#if defined STALL_DETECT_ENABLE && STALL_DETECT_ENABLE && !(defined ADC_CAPTURE_ENABLE && ADC_CAPTURE_ENABLE)
+    stall_detect_close();
+#endif
+#if defined ADC_CAPTURE_ENABLE && ADC_CAPTURE_ENABLE
+    adc_capture_stop();
+#elif defined POWER_MANAGER_ENABLE && POWER_MANAGER_ENABLE
+    power_release(power_domain_comparator);
+#else
     shc_close();
+#endif
     sys_tim_cyclic_cascaded_stop(TIMER_CLOCK);
+#if defined POWER_MANAGER_ENABLE && POWER_MANAGER_ENABLE
+    power_release(power_domain_timer);
+    power_minimal();
+#else
     sys_tim_close();
+#endif
+}
+
+
+/** @brief Read the VCCHB voltage
+ *
+ *  By default, the voltage of the MA (MB when moving backward) pin is measured with the conversion behind the
+ *  comparator (see voltage_measure.c). The top switch of the H bridge on that side must be closed to see the VCCHB
+ *  voltage on the pin (see above). Comparing the result against a threshold gives the same decision as shc_compare(), but the actual
+ *  voltage is known to the control loop as well.
+ *  With the timer triggered ADC capture, all samples captured since the last call are consumed, and the most recent
+ *  one is used, also for the motor current. As the ADC interrupt also terminates the sleep at the end of each loop,
+ *  the control loop follows the sample rate of the capture rather than the fixed sleep period.
+ *  All readings pass the moving median before they are used.
+ *
+ *  @return           VCCHB voltage
+ */
+RAM_CODE static uint16_t vcchb_read(void)
+{
+#if defined ADC_CAPTURE_ENABLE && ADC_CAPTURE_ENABLE
+    adc_sample_t sample;
+
+    while (adc_capture_read(&sample))
+    {
+        vcchb = filter_median(&vcchb_median, sample.vcchb);
+        motor_current = sample.current;
+    }
+#else
+    vcchb = filter_median(&vcchb_median, voltage_measure(vcchb_channel));
+#endif
+
+    return vcchb;
+}
+
+
+#if defined BEMF_ESTIMATE_ENABLE && BEMF_ESTIMATE_ENABLE
+/** @brief Correct the accumulated motor runtime by the difference between measured and predicted coasting
+ *
+ *  @param runtime    accumulated motor runtime (ticks)
+ *  @param correction measured minus predicted movement (ticks), see bemf_finish()
+ *  @return           corrected motor runtime, not below zero
+ */
+RAM_CODE static uint32_t runtime_correct(const uint32_t runtime, const int32_t correction)
+{
+    if ((correction < 0) && ((uint32_t)(-correction) > runtime))
+    {
+        return 0;
+    }
+
+    return runtime + (uint32_t)correction;
+}
+#endif
+
+
+#if defined MOTION_PROFILE_ENABLE && MOTION_PROFILE_ENABLE
+/** @brief Number of encoder pulses counted in the current movement, for the stop conditions of the motion profile
+ *
+ *  @return           encoder pulses, 0 without encoder
+ */
+RAM_CODE static uint32_t pulses_counted(void)
+{
+#if defined ENCODER_ENABLE && ENCODER_ENABLE
+    return encoder_pulses;
+#else
+    return 0;
+#endif
 }
+#endif
 
 #endif
 
@@ -0,0 +1,97 @@
+/* ============================================================================
+** Copyright (c) 2021 Infineon Technologies AG
+**               All rights reserved.
+**               www.infineon.com
+** ============================================================================
+**
+** ============================================================================
+** Redistribution and use of this software only permitted to the extent
+** expressly agreed with Infineon Technologies AG.
+** ============================================================================
+*
+*/
+
+/** @file     stall_detect.c
+ *  @brief    Detection of a stalled motor from its current
+ *
+ *  The stepwise motor operation ends when the accumulated motor runtime is reached. If the mechanism hits its end
+ *  stop early (e.g. the bolt is already in its end position), the motor keeps running against the stop and burns the
+ *  stored energy of the remaining steps.
+ *  A blocked DC motor draws its maximum current, as there is no back EMF. This module samples the motor current
+ *  through the I2V converter of the sense unit and reports a stall if the current stays above a threshold for a
+ *  number of consecutive samples. Right after switching on, the motor draws a similar current to accelerate, so
+ *  samples within a blanking time after each start are ignored.
+ */
+
+// standard libs
+// included by core_cm0.h: #include <stdint.h>
+#include "core_cm0.h"
+#include <stdbool.h>
+
+// Smack ROM lib
+#include "rom_lib.h"
+
+// Smack stepwise project
+#include "settings.h"
+#include "filter.h"
+#include "power_domain.h"
+#include "stall_detect.h"
+
+
+static filter_debounce_t stall;
+
+
+void stall_detect_init(void)
+{
+#if defined POWER_MANAGER_ENABLE && POWER_MANAGER_ENABLE
+    power_acquire(power_domain_sense);
+#else
+    switch_on_sense();
+#endif
+    sense_sh_config(sample_hold1, STALL_I2V_AIN, i2v_sel_i2v, sense_disable);
+    filter_debounce_init(&stall, false, STALL_CONFIRM_SAMPLES);
+}
+
+
+void stall_detect_close(void)
+{
+#if defined POWER_MANAGER_ENABLE && POWER_MANAGER_ENABLE
+    power_release(power_domain_sense);
+#else
+    switch_off_sense();
+#endif
+}
+
+
+RAM_CODE uint16_t stall_detect_sample(void)
+{
+    /* The ADC of the sense unit is shared with the VCCHB readings of the control loop (get_nfc_value_ext() of the
+     * voltage measurement and shc_compare()) and with the RSSI readings of the field estimation, which select their
+     * own inputs. So SH1 is set up again before each conversion. This is safe: all of these conversions are started
+     * from the control loop and complete before the call returns, none from an interrupt (with the timer triggered
+     * ADC capture, the current is taken from the capture instead), so no conversion is in progress here. The sense unit
+     * itself stays on, as it is held from stall_detect_init() to stall_detect_close() and power_minimal() only
+     * switches off unused domains.
+     */
+    sense_sh_config(sample_hold1, STALL_I2V_AIN, i2v_sel_i2v, sense_disable);
+
+    // sense_sh() powers up ADC, SH1 and the I2V converter as needed; the result of SH1 is reported in sh_result[1]
+    return sense_sh(false, true, false).sh_result[1];
+}
+
+
+RAM_CODE void stall_detect_start(void)
+{
+    filter_debounce_init(&stall, false, STALL_CONFIRM_SAMPLES);
+}
+
+
+RAM_CODE bool stall_detect(const uint16_t current, const uint32_t on_ms)
+{
+    if (on_ms < (STALL_BLANKING_TIME))
+    {
+        return false;
+    }
+
+    return filter_debounce(&stall, current >= (STALL_CURRENT_THRESHOLD));
+}
@@ -0,0 +1,120 @@
+/* ============================================================================
+** Copyright (c) 2021 Infineon Technologies AG
+**               All rights reserved.
+**               www.infineon.com
+** ============================================================================
+**
+** ============================================================================
+** Redistribution and use of this software only permitted to the extent
+** expressly agreed with Infineon Technologies AG.
+** ============================================================================
+*
+*/
+
+/** @file     step_end.c
+ *  @brief    Switching of the H bridge at the end of each step: coast, freewheel or brake
+ *
+ *  By default, the motor is switched off by opening the low side switch only. The current of the winding decays
+ *  through the body diodes, and the motor coasts until friction has stopped it. This overshoot varies with speed and
+ *  load and has to be covered by MOTOR_START_CORRECTION.
+ *  Shorting the winding through both low side or both high side switches lets the current recirculate, and the back
+ *  EMF drives a current which brakes the motor. Held for a short time (freewheel), this takes the inductive energy
+ *  out gently; held until the motor has stopped (brake), it cuts the overshoot down to a small, repeatable amount.
+ *  During freewheel and brake, the VCCHB voltage cannot be observed, so the H bridge returns to the "off" state of
+ *  the control loop (top switch closed) afterwards.
+ *
+ *  The slope control and the current limit of the H bridge may be configured separately for the motor running and
+ *  for braking. set_hb_config() of the ROM library only sets the bits of ccset and acl_delay, so they are cleared
+ *  here before a new configuration is applied.
+ */
+
+// standard libs
+// included by core_cm0.h: #include <stdint.h>
+#include "core_cm0.h"
+#include <stdbool.h>
+
+// Smack ROM lib
+#include "rom_lib.h"
+#include "hal_api.h"
+
+// Smack NVM lib
+#include "sys_tim_lib.h"
+
+// Smack stepwise project
+#include "settings.h"
+#include "step_end.h"
+#include "hb_switch.h"
+
+
+#if defined HB_CONFIG_ENABLE && HB_CONFIG_ENABLE
+/** Configuration register of the H bridge, as written by set_hb_config()
+ */
+#define HB_CONFIG_REG       ((volatile uint32_t*)0x40000000UL)
+#define HB_CONFIG_ACL_DELAY 0x07UL          // acl_delay, only ever set by set_hb_config()
+#define HB_CONFIG_CCSET     0x60UL          // ccset, only ever set by set_hb_config()
+
+static const hb_config_struct_t hb_config_run RAM_CONST = HB_CONFIG_RUN;
+static const hb_config_struct_t hb_config_brake RAM_CONST = HB_CONFIG_BRAKE;
+
+
+/** @brief Apply a configuration of the H bridge
+ *  @param config     configuration to apply
+ */
+RAM_CODE static void step_end_config(const hb_config_struct_t* config)
+{
+    HAL_SET32(HB_CONFIG_REG, HAL_GET32(HB_CONFIG_REG) & ~(HB_CONFIG_ACL_DELAY | HB_CONFIG_CCSET));
+    set_hb_config(config);
+}
+#endif
+
+
+void step_end_init(void)
+{
+#if defined HB_CONFIG_ENABLE && HB_CONFIG_ENABLE
+    step_end_config(&hb_config_run);
+#endif
+}
+
+
+RAM_CODE void step_end(const step_end_t strategy, const bool forward)
+{
+    /* Switches are never closed in the same call as the opposite switch of their half bridge is opened: the running
+     * motor is driven by HS1 + LS2 (forward) or HS2 + LS1 (backward), so first the switch which is not part of the
+     * freewheel path is opened, then the other switch of its half bridge is closed.
+     */
+    switch (strategy)
+    {
+    case step_end_freewheel_low:
+        hb_switch(false, !forward, false, forward);
+        hb_switch(false, true, false, true);
+        sys_tim_singleshot_32(TIMER_SINGLE, ms2ticks(STEP_END_FREEWHEEL_TIME), SYSTIM_IRQ);
+        hb_switch(false, false, false, false);
+        break;
+
+    case step_end_freewheel_high:
+        hb_switch(forward, false, !forward, false);
+        hb_switch(true, false, true, false);
+        sys_tim_singleshot_32(TIMER_SINGLE, ms2ticks(STEP_END_FREEWHEEL_TIME), SYSTIM_IRQ);
+        break;
+
+    case step_end_brake:
+#if defined HB_CONFIG_ENABLE && HB_CONFIG_ENABLE
+        step_end_config(&hb_config_brake);
+#endif
+        hb_switch(false, !forward, false, forward);
+        hb_switch(false, true, false, true);
+        sys_tim_singleshot_32(TIMER_SINGLE, ms2ticks(STEP_END_BRAKE_TIME), SYSTIM_IRQ);
+        hb_switch(false, false, false, false);
+#if defined HB_CONFIG_ENABLE && HB_CONFIG_ENABLE
+        step_end_config(&hb_config_run);
+#endif
+        break;
+
+    case step_end_coast:
+    default:
+        break;
+    }
+
+    // "off" state of the control loop: the top switch of the direction stays closed to observe VCCHB
+    hb_switch(forward, false, !forward, false);
+}
@@ -0,0 +1,148 @@
+/* ============================================================================
+** Copyright (c) 2021 Infineon Technologies AG
+**               All rights reserved.
+**               www.infineon.com
+** ============================================================================
+**
+** ============================================================================
+** Redistribution and use of this software only permitted to the extent
+** expressly agreed with Infineon Technologies AG.
+** ============================================================================
+*
+*/
+
+/** @file     temp_comp.c
+ *  @brief    Temperature compensation of the stepwise motor parameters
+ *
+ *  A cold device needs more energy per movement than a warm one: the ESR of the HB cap and the viscosity of the
+ *  grease are higher, while the lower resistance of the motor winding draws the cap down faster. With fixed
+ *  parameters, a device tuned at room temperature stops early in winter and overshoots in summer.
+ *  At the start of a movement, the on-chip temperature sensor is sampled once, and the parameters are interpolated
+ *  linearly between the lines of a table (TEMP_COMP_TABLE in settings.h). All calculations are done in fixed point
+ *  with 8 fractional bits.
+ */
+
+// standard libs
+// included by core_cm0.h: #include <stdint.h>
+#include "core_cm0.h"
+#include <stdbool.h>
+
+// Smack ROM lib
+#include "rom_lib.h"
+
+// Smack stepwise project
+#include "settings.h"
+#include "smack_stepwise.h"
+#include "filter.h"
+#include "power_domain.h"
+#include "temp_comp.h"
+
+
+/** one line of the compensation table
+ */
+typedef struct temp_comp_point_s
+{
+    int16_t  temp;              // degC
+    uint16_t voltage_off;
+    uint16_t start_correction;
+    uint16_t total_runtime;
+} temp_comp_point_t;
+
+static const temp_comp_point_t temp_comp_table[] =
+{
+    TEMP_COMP_TABLE
+};
+
+#define TEMP_COMP_POINTS    (sizeof(temp_comp_table) / sizeof(temp_comp_table[0]))
+
+
+int32_t temp_comp_read(void)
+{
+    sh_result_t result;
+    int32_t raw;
+
+#if defined POWER_MANAGER_ENABLE && POWER_MANAGER_ENABLE
+    power_acquire(power_domain_sense);
+#else
+    switch_on_sense();
+#endif
+
+    /* sense_sh() powers up the ADC and the sample & hold stages SH0/SH1 only, the temperature sensor and its sample &
+     * hold stage (SHTS) have to be powered up before (the ROM has no sense_sh_ts()). The comparator is not initialized
+     * yet (see smack_stepwise.c), so the sense unit has no other user, and everything else is left powered down.
+     * The temperature is reported in sh_result[0].
+     */
+    sense_ctrl_config(sense_power_up, sense_power_down, sense_power_down, sense_power_down, sense_power_down,
+                      sense_power_down, sense_power_up, sense_power_up, sense_disable);
+    result = sense_sh(false, false, true);
+    sense_ctrl_config(sense_power_down, sense_power_down, sense_power_down, sense_power_down, sense_power_down,
+                      sense_power_down, sense_power_down, sense_power_down, sense_disable);
+
+#if defined POWER_MANAGER_ENABLE && POWER_MANAGER_ENABLE
+    power_release(power_domain_sense);
+#else
+    switch_off_sense();
+#endif
+
+    raw = (int32_t)result.sh_result[0] - (TEMP_SENSE_RAW_25C);
+
+    // temp = 25 + raw / slope; the slope is Q8, the result as well: raw * 2^16 / slope_q8
+    return (25 << 8) + filter_div(raw * 65536, TEMP_SENSE_SLOPE_Q8);
+}
+
+
+/** @brief Linear interpolation between two values
+ *  @param y0    value at the lower temperature
+ *  @param y1    value at the upper temperature
+ *  @param frac  position between lower and upper temperature (Q8, 0...256)
+ */
+static uint16_t temp_comp_interpolate(const uint16_t y0, const uint16_t y1, const int32_t frac)
+{
+    return (uint16_t)((int32_t)y0 + filter_div(((int32_t)y1 - (int32_t)y0) * frac, 256));
+}
+
+
+void temp_comp_apply(stepwise_params_t* params, const int32_t temp)
+{
+    const temp_comp_point_t* lo;
+    const temp_comp_point_t* hi;
+    int32_t frac;
+    uint32_t i;
+
+    // find the pair of lines enclosing the temperature; outside of the table, the first or last line is used
+    lo = &temp_comp_table[0];
+    hi = lo;
+    for (i = 0; i < TEMP_COMP_POINTS; i++)
+    {
+        hi = &temp_comp_table[i];
+        if (temp < ((int32_t)hi->temp << 8))
+        {
+            break;
+        }
+        lo = hi;
+    }
+
+    if ((lo == hi) || (temp <= ((int32_t)lo->temp << 8)))
+    {
+        frac = 0;
+    }
+    else
+    {
+        frac = filter_div(temp - ((int32_t)lo->temp << 8), (int32_t)hi->temp - (int32_t)lo->temp);
+    }
+
+    /* The table is characterized for the forward profile (TOTAL_MOTOR_RUNTIME, MOTOR_START_CORRECTION). Other
+     * profiles are scaled by the same ratio, so the forward profile gets the values of the table.
+     */
+    params->voltage_off      = temp_comp_interpolate(lo->voltage_off, hi->voltage_off, frac);
+#if defined MOTOR_START_CORRECTION && MOTOR_START_CORRECTION
+    params->start_correction = filter_udiv(params->start_correction *
+                                           temp_comp_interpolate(lo->start_correction, hi->start_correction, frac),
+                                           MOTOR_START_CORRECTION);
+#else
+    params->start_correction = temp_comp_interpolate(lo->start_correction, hi->start_correction, frac);
+#endif
+    params->total_runtime    = filter_udiv(params->total_runtime *
+                                           temp_comp_interpolate(lo->total_runtime, hi->total_runtime, frac),
+                                           TOTAL_MOTOR_RUNTIME);
+}
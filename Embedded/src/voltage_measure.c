@@ -0,0 +1,56 @@
+/* ============================================================================
+** Copyright (c) 2021 Infineon Technologies AG
+**               All rights reserved.
+**               www.infineon.com
+** ============================================================================
+**
+** ============================================================================
+** Redistribution and use of this software only permitted to the extent
+** expressly agreed with Infineon Technologies AG.
+** ============================================================================
+*
+*/
+
+/** @file     voltage_measure.c
+ *  @brief    Measurement of the H bridge pin voltages
+ *
+ *  shc_compare() only tells on which side of a threshold a voltage is. A successive approximation over the
+ *  threshold would need about 10 calls for a millivolt result. But shc_compare() is not backed by an analog
+ *  comparator: the Smack NVM library implements it by a conversion of the selected H bridge pin with the sense
+ *  unit ADC (get_nfc_value_ext()), and then compares the result against the threshold in software. Every step of a
+ *  successive approximation would therefore cost a full conversion.
+ *  This module calls the conversion directly. One conversion gives the same value a binary search would converge
+ *  to, at the cost of a single comparator query.
+ */
+
+// standard libs
+// included by core_cm0.h: #include <stdint.h>
+#include "core_cm0.h"
+#include <stdbool.h>
+
+// Smack NVM lib
+#include "shc_lib.h"
+
+// Smack stepwise project
+#include "settings.h"
+#include "voltage_measure.h"
+
+
+/** Conversion routine of the NVM library used by shc_compare(). It is declared in the sense library header of the
+ *  SDK which is not part of this project. The channel numbers of shc_channel_t are the ones of the sense library
+ *  (hbridge_ma = 3, hbridge_mb = 4).
+ */
+extern uint16_t get_nfc_value_ext(const shc_channel_t channel);
+
+
+RAM_CODE uint16_t voltage_measure(const shc_channel_t channel)
+{
+    return get_nfc_value_ext(channel);
+}
+
+
+RAM_CODE uint16_t voltage_to_mv(const uint16_t digits)
+{
+    // 1000mV ~ 1024 digits: mV = digits * 1000 / 1024 = digits * 125 / 128
+    return (uint16_t)(((uint32_t)digits * 125U) >> 7);
+}